@@ -0,0 +1,378 @@
+#include "Regression.h"
+
+#include "Synthetic.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include <libs/json.hpp>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace diannex
+{
+    // Compiler phases that are checked, as named in the --timings_json report
+    enum class RegressionPhase
+    {
+        Lex,
+        Parse,
+        Bytecode,
+        Binary, // including compression, as both happen in Binary::Write
+
+        Count
+    };
+
+    static const char* const phaseNames[] = { "lex", "parse", "bytecode", "binary" };
+
+    struct RegressionProject
+    {
+        const char* name;
+        SyntheticOptions options;
+    };
+
+    struct RegressionResult
+    {
+        uint64_t bytes = 0;
+        uint64_t lines = 0;
+        std::string fingerprint;
+        uint64_t dxbBytes = 0;
+        double medians[(int)RegressionPhase::Count] = {}; // milliseconds
+    };
+
+    // The representative projects. Changing these invalidates the baseline.
+    static std::vector<RegressionProject> regressionProjects()
+    {
+        std::vector<RegressionProject> res;
+
+        SyntheticOptions options;
+        res.push_back({ "dialogue", options });
+
+        options = SyntheticOptions();
+        options.interpolation = 0.9;
+        options.macros = 16;
+        res.push_back({ "interpolation", options });
+
+        options = SyntheticOptions();
+        options.lines = 5;
+        options.choiceDepth = 4;
+        res.push_back({ "choices", options });
+
+        options = SyntheticOptions();
+        options.files = 300;
+        options.scenes = 2;
+        options.lines = 10;
+        options.includes = 4;
+        res.push_back({ "many_files", options });
+
+        return res;
+    }
+
+    static std::string fingerprint(const SyntheticProject& project)
+    {
+        // FNV-1a over every file, so a changed generator is noticed
+        uint64_t h = 0xcbf29ce484222325ULL;
+        for (const SyntheticFile& file : project.files)
+        {
+            for (const std::string* str : { &file.path, &file.source })
+            {
+                for (char c : *str)
+                {
+                    h ^= (uint8_t)c;
+                    h *= 0x100000001b3ULL;
+                }
+                h ^= 0xff;
+                h *= 0x100000001b3ULL;
+            }
+        }
+        std::stringstream ss;
+        ss << std::setfill('0') << std::setw(16) << std::hex << h;
+        return ss.str();
+    }
+
+    static std::string quote(const std::string& str)
+    {
+        return "\"" + str + "\"";
+    }
+
+    static double median(std::vector<double> values)
+    {
+        std::sort(values.begin(), values.end());
+        size_t mid = values.size() / 2;
+        return (values.size() % 2 == 0) ? (values[mid - 1] + values[mid]) / 2 : values[mid];
+    }
+
+    // Compiles a written project once, reading back the phase times it reports
+    static bool compileOnce(const RegressionOptions& options, const fs::path& directory, const SyntheticProject& project,
+                            double (&times)[(int)RegressionPhase::Count])
+    {
+        const std::string timingsPath = (directory / "timings.json").string();
+        std::string command = quote(options.compiler) + " -p " + quote((directory / (project.project.name + ".json")).string()) +
+                              " -j " + std::to_string(options.jobs) + " --timings_json " + quote(timingsPath);
+#ifdef _WIN32
+        command = "\"" + command + " > NUL 2>&1\"";
+#else
+        command += " > /dev/null 2>&1";
+#endif
+        if (std::system(command.c_str()) != 0)
+            return false;
+
+        nlohmann::json timings;
+        try
+        {
+            std::ifstream s(timingsPath, std::ios::in);
+            s >> timings;
+            for (int i = 0; i < (int)RegressionPhase::Count; i++)
+                times[i] = timings["phases"][phaseNames[i]]["wall_ms"].get<double>();
+            times[(int)RegressionPhase::Binary] += timings["phases"]["compression"]["wall_ms"].get<double>();
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+        return true;
+    }
+
+    static bool measure(const RegressionOptions& options, const RegressionProject& regressionProject, RegressionResult& result)
+    {
+        SyntheticProject project = Synthetic::Generate(regressionProject.options);
+        result.bytes = project.bytes;
+        result.lines = project.lines;
+        result.fingerprint = fingerprint(project);
+
+        const fs::path directory = fs::temp_directory_path() / (std::string("diannex_regression_") + regressionProject.name);
+        std::error_code ec;
+        fs::remove_all(directory, ec);
+        if (!Synthetic::Write(project, directory.string()))
+        {
+            std::cout << "Failed to write project '" << regressionProject.name << "' to '" << directory.string() << "'." << std::endl;
+            return false;
+        }
+
+        // The first run only warms up the file system cache
+        std::vector<double> times[(int)RegressionPhase::Count];
+        for (uint32_t run = 0; run <= options.runs; run++)
+        {
+            double runTimes[(int)RegressionPhase::Count];
+            if (!compileOnce(options, directory, project, runTimes))
+            {
+                std::cout << "Failed to compile project '" << regressionProject.name << "' with '" << options.compiler << "'." << std::endl;
+                fs::remove_all(directory, ec);
+                return false;
+            }
+            for (int i = 0; run != 0 && i < (int)RegressionPhase::Count; i++)
+                times[i].push_back(runTimes[i]);
+        }
+        for (int i = 0; i < (int)RegressionPhase::Count; i++)
+            result.medians[i] = median(times[i]);
+
+        result.dxbBytes = fs::file_size(directory / project.project.options.binaryOutputDir / (project.project.name + ".dxb"), ec);
+        fs::remove_all(directory, ec);
+        return true;
+    }
+
+    // Source megabytes compiled per second
+    static double throughput(uint64_t bytes, double ms)
+    {
+        return bytes / (1024.0 * 1024.0) / (std::max(ms, 1e-6) / 1000.0);
+    }
+
+    static nlohmann::json resultJson(const RegressionResult& result)
+    {
+        nlohmann::json res = {
+            { "fingerprint", result.fingerprint },
+            { "source_bytes", result.bytes },
+            { "source_lines", result.lines },
+            { "dxb_bytes", result.dxbBytes }
+        };
+        for (int i = 0; i < (int)RegressionPhase::Count; i++)
+        {
+            res["phases"][phaseNames[i]] = {
+                { "median_ms", result.medians[i] },
+                { "mb_per_s", throughput(result.bytes, result.medians[i]) }
+            };
+        }
+        return res;
+    }
+
+    // Timings are only comparable on the machine they were taken on, so baselines record where that was
+    static std::string hostName()
+    {
+#ifdef _WIN32
+        const char* name = std::getenv("COMPUTERNAME");
+        return (name != nullptr) ? name : "";
+#else
+        char name[256] = {};
+        if (gethostname(name, sizeof(name) - 1) != 0)
+            return "";
+        return name;
+#endif
+    }
+
+    // Baselines in a directory are kept per host, named after it
+    static std::string baselinePath(const std::string& path)
+    {
+        std::error_code ec;
+        if (!fs::is_directory(path, ec))
+            return path;
+
+        std::string name = hostName();
+        for (char& c : name)
+        {
+            if (!std::isalnum((unsigned char)c) && c != '-' && c != '_' && c != '.')
+                c = '_';
+        }
+        return (fs::path(path) / ((name.empty() ? "unknown" : name) + ".json")).string();
+    }
+
+    // Checks that a baseline has everything compare reads, with the right types
+    static bool validBaseline(const nlohmann::json& baseline)
+    {
+        if (!baseline.is_object() || !baseline.contains("projects") || !baseline["projects"].is_object())
+            return false;
+        if (baseline.contains("host") && !baseline["host"].is_string())
+            return false;
+        for (auto& project : baseline["projects"])
+        {
+            if (!project.is_object() || !project.contains("fingerprint") || !project["fingerprint"].is_string() ||
+                !project.contains("dxb_bytes") || !project["dxb_bytes"].is_number_integer() ||
+                !project.contains("phases") || !project["phases"].is_object())
+                return false;
+            for (const char* phase : phaseNames)
+            {
+                const nlohmann::json& phases = project["phases"];
+                if (!phases.contains(phase) || !phases[phase].is_object() || !phases[phase].contains("mb_per_s") || !phases[phase]["mb_per_s"].is_number())
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    // Prints the comparison for one project. Returns false if it regressed.
+    static bool compare(const RegressionOptions& options, const char* name, const RegressionResult& result, const nlohmann::json& baseline)
+    {
+        std::cout << std::endl << name << " (" << result.lines << " lines):" << std::endl;
+        if (baseline.is_null())
+        {
+            std::cout << "  Not in the baseline; run with --update_baseline to add it." << std::endl;
+            return false;
+        }
+        if (baseline["fingerprint"].get<std::string>() != result.fingerprint)
+        {
+            std::cout << "  The generated project differs from the one in the baseline; run with --update_baseline." << std::endl;
+            return false;
+        }
+
+        bool ok = true;
+        std::cout << "  " << std::left << std::setw(12) << "phase" << std::right << std::setw(14) << "baseline MB/s"
+                  << std::setw(14) << "current MB/s" << std::setw(10) << "change" << std::endl;
+        for (int i = 0; i < (int)RegressionPhase::Count; i++)
+        {
+            double before = baseline["phases"][phaseNames[i]]["mb_per_s"].get<double>();
+            double after = throughput(result.bytes, result.medians[i]);
+            double change = (after - before) / before;
+            bool regressed = change < -options.threshold;
+            std::cout << "  " << std::left << std::setw(12) << phaseNames[i] << std::right << std::setw(14) << before
+                      << std::setw(14) << after << std::setw(9) << std::showpos << change * 100 << std::noshowpos << '%'
+                      << (regressed ? "  REGRESSED" : "") << std::endl;
+            if (regressed)
+                ok = false;
+        }
+
+        int64_t sizeBefore = baseline["dxb_bytes"].get<int64_t>();
+        int64_t sizeDelta = (int64_t)result.dxbBytes - sizeBefore;
+        std::cout << "  .dxb size: " << result.dxbBytes << " bytes (" << std::showpos << sizeDelta << " bytes, "
+                  << (sizeBefore == 0 ? 0.0 : sizeDelta * 100.0 / sizeBefore) << '%' << std::noshowpos << ")" << std::endl;
+        return ok;
+    }
+
+    int Regression::Run(const RegressionOptions& options)
+    {
+        const std::string path = baselinePath(options.baseline);
+        nlohmann::json baseline;
+        if (!options.update)
+        {
+            try
+            {
+                std::ifstream s(path, std::ios::in);
+                s >> baseline;
+            }
+            catch (const std::exception& e)
+            {
+                std::cout << "Failed to load baseline '" << path << "': " << e.what() << std::endl;
+                std::cout << "Record one on this machine first, with --update_baseline (the perf_baseline target)." << std::endl;
+                return 1;
+            }
+
+            if (!validBaseline(baseline))
+            {
+                std::cout << "The baseline '" << path << "' is malformed; re-record it with --update_baseline (the perf_baseline target)." << std::endl;
+                return 1;
+            }
+
+            std::string host = baseline.contains("host") ? baseline["host"].get<std::string>() : "";
+            if (host != hostName())
+            {
+                std::cout << "The baseline '" << path << "' was recorded on " << (host.empty() ? "an unknown host" : "'" + host + "'")
+                          << ", not on this one; its timings aren't comparable." << std::endl;
+                std::cout << "Record one on this machine first, with --update_baseline (the perf_baseline target)." << std::endl;
+                return 1;
+            }
+        }
+
+        std::cout << std::fixed << std::setprecision(2);
+        nlohmann::json updated = { { "host", hostName() }, { "runs", options.runs }, { "jobs", options.jobs } };
+        bool ok = true;
+        for (const RegressionProject& project : regressionProjects())
+        {
+            RegressionResult result;
+            if (!measure(options, project, result))
+                return 1;
+
+            if (options.update)
+            {
+                updated["projects"][project.name] = resultJson(result);
+                std::cout << project.name << ": ";
+                for (int i = 0; i < (int)RegressionPhase::Count; i++)
+                    std::cout << (i == 0 ? "" : ", ") << phaseNames[i] << " " << throughput(result.bytes, result.medians[i]) << " MB/s";
+                std::cout << ", .dxb " << result.dxbBytes << " bytes" << std::endl;
+            }
+            else
+            {
+                const nlohmann::json& projects = baseline["projects"];
+                if (!compare(options, project.name, result, projects.contains(project.name) ? projects[project.name] : nlohmann::json()))
+                    ok = false;
+            }
+        }
+
+        if (options.update)
+        {
+            std::ofstream s(path, std::ios::out | std::ios::trunc);
+            if (!s.is_open())
+            {
+                std::cout << "Failed to write baseline '" << path << "'." << std::endl;
+                return 1;
+            }
+            s << updated.dump(4) << std::endl;
+            std::cout << std::endl << "Wrote baseline to '" << path << "'." << std::endl;
+            return 0;
+        }
+
+        if (!ok)
+        {
+            std::cout << std::endl << "Performance regressed by more than " << options.threshold * 100 << "% against the baseline." << std::endl;
+            return 1;
+        }
+        std::cout << std::endl << "No regressions beyond " << options.threshold * 100 << "%." << std::endl;
+        return 0;
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef DIANNEX_BENCH_REGRESSION_H
+#define DIANNEX_BENCH_REGRESSION_H
+
+#include <cstdint>
+#include <string>
+
+namespace diannex
+{
+    struct RegressionOptions
+    {
+        std::string compiler; // path to the diannex executable
+        std::string baseline; // path to the baseline JSON file, or to a directory of them named after their hosts
+        bool update = false; // if set, the baseline is rewritten instead of checked
+        uint32_t runs = 5;
+        uint32_t jobs = 1; // passed to the compiler; 1 keeps timings steady
+        double threshold = 0.1; // largest allowed throughput loss, as a fraction of the baseline
+    };
+
+    // Compiles a fixed set of generated projects end to end, and compares per-phase
+    // throughput and output sizes against a checked-in baseline recorded on the same host
+    class Regression
+    {
+    public:
+        // Returns the process exit code: 0 if nothing regressed
+        static int Run(const RegressionOptions& options);
+    private:
+        Regression();
+    };
+}
+
+#endif // DIANNEX_BENCH_REGRESSION_H
@@ -0,0 +1,248 @@
+#include "Synthetic.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include <libs/json.hpp>
+
+namespace fs = std::filesystem;
+
+namespace diannex
+{
+    // Small deterministic generator (splitmix64), as standard distributions differ between libraries
+    class SyntheticRandom
+    {
+    public:
+        SyntheticRandom(uint64_t seed) : state(seed) {}
+
+        uint64_t Next()
+        {
+            uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31);
+        }
+
+        uint32_t Below(uint32_t max)
+        {
+            return (max == 0) ? 0 : (uint32_t)(Next() % max);
+        }
+
+        bool Chance(double probability)
+        {
+            return (Next() >> 11) * (1.0 / 9007199254740992.0) < probability;
+        }
+    private:
+        uint64_t state;
+    };
+
+    static const char* const words[] = {
+        "the", "lantern", "flickers", "as", "you", "step", "into", "old", "library", "and",
+        "somewhere", "a", "clock", "is", "ticking", "quietly", "behind", "shelves", "of", "dust"
+    };
+
+    // State shared by everything generated for a project
+    struct SyntheticState
+    {
+        const SyntheticOptions& options;
+        SyntheticRandom random;
+        int32_t stringId = 0; // every translated string gets an ID, so the translation converters can match them up
+    };
+
+    static void indent(std::stringstream& ss, int depth)
+    {
+        for (int i = 0; i < depth; i++)
+            ss << "    ";
+    }
+
+    static void stringId(std::stringstream& ss, SyntheticState& state)
+    {
+        ss << '&' << std::setfill('0') << std::setw(8) << std::hex << state.stringId++ << std::dec;
+    }
+
+    static void textLine(std::stringstream& ss, SyntheticState& state, int depth, uint32_t n)
+    {
+        indent(ss, depth);
+        if (state.options.macros != 0 && state.random.Below(8) == 0)
+        {
+            ss << "MACRO" << state.random.Below(state.options.macros) << "\n";
+            return;
+        }
+
+        ss << '"';
+        uint32_t count = 6 + state.random.Below(10);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            if (i != 0)
+                ss << ' ';
+            ss << words[state.random.Below(sizeof(words) / sizeof(words[0]))];
+        }
+        if (state.random.Chance(state.options.interpolation))
+            ss << ", ${$count + " << n << "}";
+        ss << ".\"";
+        stringId(ss, state);
+        ss << "\n";
+    }
+
+    static void choiceTree(std::stringstream& ss, SyntheticState& state, int depth, uint32_t level)
+    {
+        indent(ss, depth);
+        ss << "choice \"Which way, level " << level << "?\"";
+        stringId(ss, state);
+        ss << "\n";
+        indent(ss, depth);
+        ss << "{\n";
+        for (int option = 0; option < 2; option++)
+        {
+            indent(ss, depth + 1);
+            ss << "\"Option " << (char)('a' + option) << '"';
+            stringId(ss, state);
+            ss << (option == 1 ? " 50%" : "") << "\n";
+            indent(ss, depth + 1);
+            ss << "{\n";
+            if (level > 1)
+                choiceTree(ss, state, depth + 2, level - 1);
+            else
+            {
+                textLine(ss, state, depth + 2, level);
+                indent(ss, depth + 2);
+                ss << "$picked = " << option << "\n";
+            }
+            indent(ss, depth + 1);
+            ss << "}\n";
+        }
+        indent(ss, depth);
+        ss << "}\n";
+    }
+
+    static uint32_t countLines(const std::string& str)
+    {
+        return (uint32_t)std::count(str.begin(), str.end(), '\n');
+    }
+
+    SyntheticProject Synthetic::Generate(const SyntheticOptions& options)
+    {
+        SyntheticProject res;
+        SyntheticState state { options, SyntheticRandom(options.seed) };
+
+        ProjectFormat& project = res.project;
+        project.name = "synthetic";
+        project.options.interpolationEnabled = true;
+        project.options.binaryOutputDir = "./out";
+        project.options.translationPrivate = false;
+        project.options.translationPrivateOutDir = "./translations";
+        project.options.translationPublic = false;
+        project.options.compression = true;
+        project.options.addStringIds = false;
+        project.options.useStringIds = true;
+        for (uint32_t i = 0; i < options.macros; i++)
+            project.options.macros["MACRO" + std::to_string(i)] = "$count += " + std::to_string(i);
+
+        // Main files share a pool of included files
+        uint32_t includeFiles = (options.includes == 0) ? 0 : std::max(options.includes, options.files / 4);
+
+        for (uint32_t f = 0; f < options.files; f++)
+        {
+            std::stringstream ss;
+            for (uint32_t i = 0; i < options.includes; i++)
+                ss << "#include \"include/i" << (f + i) % includeFiles << ".dx\"\n";
+
+            ss << "def strings" << f << "\n{\n";
+            for (uint32_t i = 0; i < options.scenes; i++)
+            {
+                ss << "    label" << i << " = \"Label " << i << " of file " << f << '"';
+                stringId(ss, state);
+                ss << "\n";
+            }
+            ss << "}\n";
+
+            for (uint32_t n = 0; n < options.namespaces; n++)
+            {
+                ss << "namespace file" << f << "_" << n << "\n{\n";
+                for (uint32_t s = 0; s < options.scenes; s++)
+                {
+                    ss << "    scene scene" << s << "\n    {\n";
+                    for (uint32_t l = 0; l < options.lines; l++)
+                    {
+                        textLine(ss, state, 2, l);
+                        if (state.random.Below(6) == 0)
+                            ss << "        helper(" << l << ")\n";
+                    }
+                    if (options.choiceDepth != 0)
+                        choiceTree(ss, state, 2, options.choiceDepth);
+                    ss << "    }\n";
+                }
+                ss << "    func helper(a)\n    {\n        $count += $a\n        return $a * 2\n    }\n";
+                ss << "}\n";
+            }
+
+            res.files.push_back({ "file" + std::to_string(f) + ".dx", ss.str(), 0 });
+            project.options.files.push_back(res.files.back().path);
+        }
+
+        for (uint32_t i = 0; i < includeFiles; i++)
+        {
+            std::stringstream ss;
+            ss << "namespace include" << i << "\n{\n    scene shared\n    {\n";
+            for (uint32_t l = 0; l < options.lines; l++)
+                textLine(ss, state, 2, l);
+            ss << "    }\n}\n";
+            res.files.push_back({ "include/i" + std::to_string(i) + ".dx", ss.str(), 0 });
+        }
+
+        for (SyntheticFile& file : res.files)
+        {
+            file.lines = countLines(file.source);
+            res.bytes += file.source.size();
+            res.lines += file.lines;
+        }
+        return res;
+    }
+
+    bool Synthetic::Write(const SyntheticProject& project, const std::string& directory)
+    {
+        std::error_code ec;
+        fs::create_directories(fs::path(directory) / "include", ec);
+        if (ec)
+            return false;
+
+        for (const SyntheticFile& file : project.files)
+        {
+            std::ofstream s((fs::path(directory) / file.path).string(), std::ios::out | std::ios::binary | std::ios::trunc);
+            if (!s.is_open())
+                return false;
+            s << file.source;
+        }
+
+        nlohmann::json macros = nlohmann::json::array();
+        std::vector<std::pair<std::string, std::string>> sorted(project.project.options.macros.begin(), project.project.options.macros.end());
+        std::sort(sorted.begin(), sorted.end());
+        for (auto& macro : sorted)
+            macros.push_back(macro.first + "=" + macro.second);
+
+        const ProjectOptions& options = project.project.options;
+        nlohmann::json json = {
+            { "name", project.project.name },
+            { "options", {
+                { "files", options.files },
+                { "interpolation_enabled", options.interpolationEnabled },
+                { "binary_outdir", options.binaryOutputDir },
+                { "translation_private", true },
+                { "translation_private_outdir", options.translationPrivateOutDir },
+                { "translation_public", true },
+                { "compression", options.compression },
+                { "use_string_ids", options.useStringIds },
+                { "macros", macros }
+            }}
+        };
+
+        std::ofstream s((fs::path(directory) / (project.project.name + ".json")).string(), std::ios::out | std::ios::trunc);
+        if (!s.is_open())
+            return false;
+        s << json.dump(4) << std::endl;
+        return true;
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef DIANNEX_BENCH_SYNTHETIC_H
+#define DIANNEX_BENCH_SYNTHETIC_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Project.h"
+
+namespace diannex
+{
+    // Shape of a generated project
+    struct SyntheticOptions
+    {
+        uint32_t files = 50;
+        uint32_t namespaces = 2; // per file
+        uint32_t scenes = 10; // per namespace
+        uint32_t lines = 20; // text lines per scene
+        uint32_t choiceDepth = 2; // nesting of the choice tree at the end of each scene; 0 for none
+        double interpolation = 0.25; // fraction of text lines with an interpolated expression
+        uint32_t macros = 4; // project macros, used in place of some text lines
+        uint32_t includes = 2; // #include directives per file
+        uint32_t seed = 1;
+    };
+
+    struct SyntheticFile
+    {
+        std::string path; // relative to the project directory
+        std::string source;
+        uint32_t lines;
+    };
+
+    struct SyntheticProject
+    {
+        ProjectFormat project;
+        std::vector<SyntheticFile> files; // main files first, then the files they include
+        uint64_t bytes = 0;
+        uint64_t lines = 0;
+    };
+
+    // Generates dialogue projects of configurable size, for benchmarking.
+    // The same options always produce the same project, on every platform.
+    class Synthetic
+    {
+    public:
+        static SyntheticProject Generate(const SyntheticOptions& options);
+
+        // Writes the sources and a project file named after the project to a directory
+        static bool Write(const SyntheticProject& project, const std::string& directory);
+    private:
+        Synthetic();
+    };
+}
+
+#endif // DIANNEX_BENCH_SYNTHETIC_H
@@ -0,0 +1,344 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#include <libs/cxxopts.hpp>
+
+#include "Binary.h"
+#include "Bytecode.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "Symbols.h"
+#include "Timings.h"
+#include "Translation.h"
+
+#include "Regression.h"
+#include "Synthetic.h"
+
+namespace fs = std::filesystem;
+using namespace diannex;
+
+enum class StageType
+{
+    Lex,
+    Parse,
+    Bytecode,
+    Binary,
+    TranslationPrivate,
+    TranslationPublic,
+    PrivateToPublic,
+    PublicToPrivate,
+    Upgrade,
+    ToBinary,
+
+    Count
+};
+
+static const char* const stageNames[] = {
+    "lex", "parse", "bytecode", "binary",
+    "translation private", "translation public", "private to public", "public to private", "upgrade", "to binary"
+};
+
+struct Stage
+{
+    std::vector<double> times; // milliseconds
+    uint64_t bytes = 0; // input size the throughput is reported against
+    uint64_t lines = 0;
+};
+
+static double median(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    size_t mid = values.size() / 2;
+    return (values.size() % 2 == 0) ? (values[mid - 1] + values[mid]) / 2 : values[mid];
+}
+
+static uint64_t fileSize(const fs::path& path)
+{
+    std::error_code ec;
+    uint64_t size = fs::file_size(path, ec);
+    return ec ? 0 : size;
+}
+
+static uint64_t fileLines(const fs::path& path)
+{
+    std::ifstream s(path, std::ios::in | std::ios::binary);
+    return std::count(std::istreambuf_iterator<char>(s), std::istreambuf_iterator<char>(), '\n');
+}
+
+// Runs one pass over the whole project, adding the time of each stage. Returns false on compile errors.
+static bool runIteration(SyntheticProject& synthetic, const fs::path& workDirectory, std::vector<Stage>& stages)
+{
+    ProjectFormat* project = &synthetic.project;
+    size_t fileCount = synthetic.files.size();
+    SymbolTable symbols; // fresh for each pass, as for a one-off compile
+    SymbolScope symbolScope(&symbols);
+    auto timed = [&](StageType stage, auto func)
+    {
+        Timings::Timer timer;
+        func();
+        stages[(int)stage].times.push_back(timer.Stop().wall);
+    };
+
+    std::vector<TokenList> tokens(fileCount);
+    timed(StageType::Lex, [&]()
+    {
+        MacroCache macroCache(project);
+        for (size_t i = 0; i < fileCount; i++)
+        {
+            CompileContext ctx;
+            ctx.project = project;
+            ctx.currentFile = synthetic.files[i].path;
+            ctx.macroCache = &macroCache;
+            Lexer::LexString(synthetic.files[i].source, &ctx, tokens[i]);
+        }
+    });
+
+    std::vector<ParseResult*> parsed(fileCount);
+    timed(StageType::Parse, [&]()
+    {
+        for (size_t i = 0; i < fileCount; i++)
+        {
+            CompileContext ctx;
+            ctx.project = project;
+            ctx.currentFile = synthetic.files[i].path;
+            parsed[i] = Parser::ParseTokens(&ctx, &tokens[i]);
+        }
+    });
+
+    bool failed = false;
+    for (size_t i = 0; i < fileCount; i++)
+    {
+        if (!parsed[i]->errors.empty())
+        {
+            std::cout << "Failed to parse generated file '" << synthetic.files[i].path << "'." << std::endl;
+            failed = true;
+        }
+    }
+
+    std::vector<CompileContext*> shards(fileCount);
+    std::vector<BytecodeResult*> results(fileCount);
+    if (!failed)
+    {
+        timed(StageType::Bytecode, [&]()
+        {
+            for (size_t i = 0; i < fileCount; i++)
+            {
+                shards[i] = new CompileContext();
+                shards[i]->project = project;
+                shards[i]->currentFile = synthetic.files[i].path;
+                results[i] = Bytecode::Generate(parsed[i], shards[i]);
+            }
+        });
+    }
+
+    CompileContext context;
+    context.project = project;
+    for (size_t i = 0; i < fileCount; i++)
+    {
+        if (parsed[i] != nullptr)
+            context.parseList.push_back(std::make_pair(synthetic.files[i].path, parsed[i]));
+        if (shards[i] == nullptr)
+            continue;
+        if (!results[i]->errors.empty())
+        {
+            std::cout << "Failed to generate bytecode for generated file '" << synthetic.files[i].path << "'." << std::endl;
+            failed = true;
+        }
+        context.currentFile = synthetic.files[i].path;
+        Bytecode::Merge(shards[i], &context, results[i]);
+        delete shards[i];
+        delete results[i];
+    }
+    if (failed)
+        return false;
+
+    BinaryMemoryWriter bw;
+    timed(StageType::Binary, [&]()
+    {
+        Binary::Write(&bw, &context);
+    });
+
+    // The translation converters only work on files
+    const std::string privatePath = (workDirectory / "private.dxt").string();
+    const std::string publicPath = (workDirectory / "public.dxt").string();
+    timed(StageType::TranslationPrivate, [&]()
+    {
+        std::ofstream s(privatePath, std::ios::binary | std::ios::out | std::ios::trunc);
+        Translation::GeneratePrivateFile(s, &context);
+    });
+    timed(StageType::TranslationPublic, [&]()
+    {
+        std::ofstream s(publicPath, std::ios::binary | std::ios::out | std::ios::trunc);
+        Translation::GeneratePublicFile(s, &context);
+    });
+    timed(StageType::PrivateToPublic, [&]()
+    {
+        std::ifstream in(privatePath, std::ios::binary | std::ios::in);
+        std::ofstream out((workDirectory / "converted_public.dxt").string(), std::ios::binary | std::ios::out | std::ios::trunc);
+        Translation::ConvertPrivateToPublic(in, out);
+    });
+    timed(StageType::PublicToPrivate, [&]()
+    {
+        std::ifstream in(publicPath, std::ios::binary | std::ios::in);
+        std::ifstream match(privatePath, std::ios::binary | std::ios::in);
+        std::ofstream out((workDirectory / "converted_private.dxt").string(), std::ios::binary | std::ios::out | std::ios::trunc);
+        Translation::ConvertPublicToPrivate(in, match, out);
+    });
+    timed(StageType::Upgrade, [&]()
+    {
+        std::ifstream in(privatePath, std::ios::binary | std::ios::in);
+        std::ifstream newer(privatePath, std::ios::binary | std::ios::in);
+        std::ofstream out((workDirectory / "upgraded.dxt").string(), std::ios::binary | std::ios::out | std::ios::trunc);
+        Translation::UpgradeFileToNewer(in, true, newer, out);
+    });
+    timed(StageType::ToBinary, [&]()
+    {
+        std::ifstream in(privatePath, std::ios::binary | std::ios::in);
+        BinaryFileWriter out((workDirectory / "translation.dxb").string());
+        Translation::ConvertToBinary(in, true, out);
+    });
+
+    // Translation stages are measured against the translation file they produce or read
+    uint64_t privateBytes = fileSize(privatePath), privateLines = fileLines(privatePath);
+    uint64_t publicBytes = fileSize(publicPath), publicLines = fileLines(publicPath);
+    for (StageType stage : { StageType::TranslationPrivate, StageType::PrivateToPublic, StageType::Upgrade, StageType::ToBinary })
+    {
+        stages[(int)stage].bytes = privateBytes;
+        stages[(int)stage].lines = privateLines;
+    }
+    for (StageType stage : { StageType::TranslationPublic, StageType::PublicToPrivate })
+    {
+        stages[(int)stage].bytes = publicBytes;
+        stages[(int)stage].lines = publicLines;
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    cxxopts::Options options("diannex_bench", "Times each stage of the diannex compiler on a generated project");
+
+    options
+        .add_options()
+            ("files", "Number of source files", cxxopts::value<uint32_t>()->default_value("50"))
+            ("namespaces", "Namespaces per file", cxxopts::value<uint32_t>()->default_value("2"))
+            ("scenes", "Scenes per namespace", cxxopts::value<uint32_t>()->default_value("10"))
+            ("lines", "Text lines per scene", cxxopts::value<uint32_t>()->default_value("20"))
+            ("choice_depth", "Nesting depth of the choice tree in each scene", cxxopts::value<uint32_t>()->default_value("2"))
+            ("interpolation", "Fraction of text lines with interpolated expressions", cxxopts::value<double>()->default_value("0.25"))
+            ("macros", "Number of project macros used in place of text lines", cxxopts::value<uint32_t>()->default_value("4"))
+            ("includes", "Number of #include directives per file", cxxopts::value<uint32_t>()->default_value("2"))
+            ("seed", "Seed for the generated text", cxxopts::value<uint32_t>()->default_value("1"))
+            ("i,iterations", "Number of times to run each stage", cxxopts::value<uint32_t>()->default_value("5"))
+            ("write", "Write the generated project to a directory instead of timing it", cxxopts::value<std::string>())
+            ("h,help", "Shows this message");
+
+    options
+        .add_options("Regression check")
+            ("check", "Compile the representative projects end to end, and compare against a baseline file (or this host's, in a directory)", cxxopts::value<std::string>())
+            ("update_baseline", "Compile the representative projects end to end, and write a new baseline file (or this host's, in a directory)", cxxopts::value<std::string>())
+            ("compiler", "Path to the diannex executable", cxxopts::value<std::string>()->default_value(DIANNEX_BENCH_COMPILER))
+            ("runs", "Number of times to compile each project", cxxopts::value<uint32_t>()->default_value("5"))
+            ("jobs", "Number of threads for the compiler to use", cxxopts::value<uint32_t>()->default_value("1"))
+            ("threshold", "Largest allowed throughput loss, as a fraction", cxxopts::value<double>()->default_value("0.1"));
+
+    cxxopts::ParseResult result = [&]()
+    {
+        try
+        {
+            return options.parse(argc, argv);
+        }
+        catch (const cxxopts::OptionException& e)
+        {
+            std::cout << options.help() << std::endl << e.what() << std::endl;
+            exit(1);
+        }
+    }();
+
+    if (result.count("help"))
+    {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    if (result.count("check") || result.count("update_baseline"))
+    {
+        RegressionOptions regression;
+        regression.update = result.count("update_baseline");
+        regression.baseline = result[regression.update ? "update_baseline" : "check"].as<std::string>();
+        regression.compiler = result["compiler"].as<std::string>();
+        regression.runs = std::max(result["runs"].as<uint32_t>(), 1u);
+        regression.jobs = std::max(result["jobs"].as<uint32_t>(), 1u);
+        regression.threshold = result["threshold"].as<double>();
+        return Regression::Run(regression);
+    }
+
+    SyntheticOptions synthOptions;
+    synthOptions.files = result["files"].as<uint32_t>();
+    synthOptions.namespaces = result["namespaces"].as<uint32_t>();
+    synthOptions.scenes = result["scenes"].as<uint32_t>();
+    synthOptions.lines = result["lines"].as<uint32_t>();
+    synthOptions.choiceDepth = result["choice_depth"].as<uint32_t>();
+    synthOptions.interpolation = result["interpolation"].as<double>();
+    synthOptions.macros = result["macros"].as<uint32_t>();
+    synthOptions.includes = result["includes"].as<uint32_t>();
+    synthOptions.seed = result["seed"].as<uint32_t>();
+    SyntheticProject synthetic = Synthetic::Generate(synthOptions);
+
+    if (result.count("write"))
+    {
+        const std::string directory = result["write"].as<std::string>();
+        if (!Synthetic::Write(synthetic, directory))
+        {
+            std::cout << "Failed to write project to '" << directory << "'." << std::endl;
+            return 1;
+        }
+        std::cout << "Wrote " << synthetic.files.size() << " files (" << synthetic.bytes << " bytes, " << synthetic.lines
+                  << " lines) to '" << directory << "'." << std::endl;
+        return 0;
+    }
+
+    fs::path workDirectory = fs::temp_directory_path() / ("diannex_bench_" + std::to_string(synthOptions.seed));
+    std::error_code ec;
+    fs::create_directories(workDirectory, ec);
+
+    // Compile stages are measured against the source
+    std::vector<Stage> stages((int)StageType::Count);
+    for (StageType stage : { StageType::Lex, StageType::Parse, StageType::Bytecode, StageType::Binary })
+    {
+        stages[(int)stage].bytes = synthetic.bytes;
+        stages[(int)stage].lines = synthetic.lines;
+    }
+
+    std::cout << "Generated " << synthetic.files.size() << " files (" << std::fixed << std::setprecision(2)
+              << synthetic.bytes / (1024.0 * 1024.0) << " MB, " << synthetic.lines << " lines)" << std::endl;
+
+    uint32_t iterations = std::max(result["iterations"].as<uint32_t>(), 1u);
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        if (!runIteration(synthetic, workDirectory, stages))
+        {
+            fs::remove_all(workDirectory, ec);
+            return 1;
+        }
+    }
+    fs::remove_all(workDirectory, ec);
+
+    std::cout << std::endl << "Median of " << iterations << " iterations:" << std::endl;
+    std::cout << "  " << std::left << std::setw(22) << "stage" << std::right << std::setw(12) << "ms"
+              << std::setw(12) << "MB/s" << std::setw(14) << "lines/s" << std::endl;
+    for (int i = 0; i < (int)StageType::Count; i++)
+    {
+        const Stage& stage = stages[i];
+        double ms = median(stage.times);
+        double seconds = std::max(ms, 1e-6) / 1000.0;
+        std::cout << "  " << std::left << std::setw(22) << stageNames[i] << std::right << std::setw(12) << ms
+                  << std::setw(12) << stage.bytes / (1024.0 * 1024.0) / seconds
+                  << std::setw(14) << std::setprecision(0) << stage.lines / seconds << std::setprecision(2) << std::endl;
+    }
+
+    return 0;
+}
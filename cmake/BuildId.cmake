@@ -0,0 +1,24 @@
+# Writes a header defining DIANNEX_BUILD_ID, a hash of the compiler's sources and toolchain.
+# Run with -DOUTPUT=<header> -DSOURCE_DIR=<repo> -DTOOLCHAIN=<compiler id and version>
+
+file(GLOB_RECURSE BUILD_ID_FILES
+    ${SOURCE_DIR}/src/*.cpp ${SOURCE_DIR}/src/*.c
+    ${SOURCE_DIR}/include/*.h ${SOURCE_DIR}/include/*.hpp)
+list(SORT BUILD_ID_FILES)
+
+set(BUILD_ID_INPUT "${TOOLCHAIN}")
+foreach(file ${BUILD_ID_FILES})
+    file(SHA256 ${file} file_hash)
+    string(APPEND BUILD_ID_INPUT "\n${file_hash}")
+endforeach()
+string(SHA256 BUILD_ID "${BUILD_ID_INPUT}")
+
+set(CONTENT "// Generated by cmake/BuildId.cmake\n#define DIANNEX_BUILD_ID \"${BUILD_ID}\"\n")
+
+# Only touch the header when the ID changes, so unchanged builds don't recompile Cache.cpp
+if (EXISTS ${OUTPUT})
+    file(READ ${OUTPUT} OLD_CONTENT)
+endif()
+if (NOT "${OLD_CONTENT}" STREQUAL "${CONTENT}")
+    file(WRITE ${OUTPUT} "${CONTENT}")
+endif()
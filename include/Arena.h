@@ -0,0 +1,66 @@
+#ifndef DIANNEX_ARENA_H
+#define DIANNEX_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace diannex
+{
+    // Bump allocator for data that is all freed together. Nothing allocated from it is destroyed,
+    // so whatever is placed in it must only own memory that also comes from the arena.
+    class Arena
+    {
+    public:
+        static constexpr size_t ChunkSize = 64 * 1024;
+
+        Arena() = default;
+        ~Arena();
+
+        void* Allocate(size_t size, size_t align);
+
+        // Copies a string into the arena
+        std::string_view Copy(std::string_view str);
+
+        // Frees everything allocated so far, at once
+        void Clear();
+
+        // Bytes held by the arena's chunks
+        uint64_t HeapSize() const;
+    private:
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        std::vector<char*> chunks;
+        char* current = nullptr;
+        size_t left = 0;
+        uint64_t chunkBytes = 0;
+    };
+
+    // Lets standard containers allocate from an arena. Memory given back is only reclaimed when the arena is cleared.
+    template<typename T>
+    struct ArenaAllocator
+    {
+        typedef T value_type;
+
+        Arena* arena;
+
+        ArenaAllocator(Arena& arena) : arena(&arena) {}
+        template<typename U>
+        ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+        T* allocate(size_t n) { return (T*)arena->Allocate(n * sizeof(T), alignof(T)); }
+        void deallocate(T*, size_t) {}
+
+        template<typename U>
+        bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+        template<typename U>
+        bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+    };
+
+    template<typename T>
+    using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+}
+
+#endif // DIANNEX_ARENA_H
@@ -67,6 +67,7 @@ namespace diannex
         BinaryMemoryWriter();
 
         uint32_t GetSize();
+        uint32_t GetCapacity();
         const char* GetBuffer();
         void SizePatch(uint32_t position);
     private:
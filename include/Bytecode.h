@@ -37,6 +37,7 @@ namespace diannex
     {
     public:
         static BytecodeResult* Generate(ParseResult* parsed, CompileContext* ctx);
+        static void Merge(CompileContext* shard, CompileContext* ctx, BytecodeResult* res);
         static void GenerateBlock(Node* block, CompileContext* ctx, BytecodeResult* res);
         static void GenerateSceneBlock(Node* block, CompileContext* ctx, BytecodeResult* res);
         static void GenerateSceneStatement(Node* statement, CompileContext* ctx, BytecodeResult* res);
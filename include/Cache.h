@@ -0,0 +1,39 @@
+#ifndef DIANNEX_CACHE_H
+#define DIANNEX_CACHE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Context.h"
+
+// Bump whenever lexing, parsing, or bytecode generation changes its output. Cache keys also
+// hash DIANNEX_BUILD_ID (see cmake/BuildId.cmake), which changes with any source change
+#define DIANNEX_CACHE_VERSION 3
+
+namespace diannex
+{
+    // Compiled state of a single source file, as stored in the cache directory
+    struct CacheEntry
+    {
+        std::vector<std::string> includes;
+        int32_t maxStringId = -1; // highest string ID already present in the file
+        CompileContext* shard = nullptr; // bytecode generated for the file, before being merged
+    };
+
+    class Cache
+    {
+    public:
+        // Hashes everything that affects a file's compiled output: its path and contents,
+        // the relevant project options and macros, and the compiler version and build
+        static uint64_t Key(const std::string& file, std::string_view source, ProjectFormat* project);
+
+        // Returns false if there's no usable entry; on success, entry.shard is newly allocated
+        static bool Load(const std::string& dir, uint64_t key, CacheEntry& entry, ProjectFormat* project);
+        static void Store(const std::string& dir, uint64_t key, const CacheEntry& entry);
+    private:
+        Cache();
+    };
+}
+
+#endif // DIANNEX_CACHE_H
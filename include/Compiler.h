@@ -0,0 +1,91 @@
+#ifndef DIANNEX_COMPILER_H
+#define DIANNEX_COMPILER_H
+
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Cache.h"
+#include "FileProvider.h"
+#include "Project.h"
+#include "Symbols.h"
+#include "ThreadPool.h"
+
+namespace diannex
+{
+    class Timings;
+    class MemoryStats;
+    class Trace;
+
+    // Files that compiled cleanly, kept in memory between rebuilds (in --watch and --server mode, or by an embedding program),
+    // keyed by Compiler::WarmKey. Files that change must be removed (and their shards deleted) before the next compile.
+    typedef std::unordered_map<std::string, CacheEntry> WarmFiles;
+
+    // An error found while compiling
+    struct Diagnostic
+    {
+        std::string file;
+        uint32_t line; // 0 if unknown
+        uint32_t column;
+        std::string message;
+    };
+
+    // A file produced by a compile, held in memory until written
+    struct CompileOutput
+    {
+        enum class OutputType
+        {
+            Binary,
+            PublicTranslation,
+            PrivateTranslation,
+            Source // a source file with new string IDs added
+        };
+
+        OutputType type;
+        std::string path;
+        std::string data;
+    };
+
+    // Inputs and results of a single compile, beyond what's logged
+    struct CompileSession
+    {
+        FileProvider* files = nullptr; // if null, sources are read from disk
+        std::ostream* log = nullptr; // progress and errors; if null, std::cout
+        WarmFiles* warmFiles = nullptr; // if null, nothing is kept between compiles
+        SymbolTable* symbols = nullptr; // names used by warmFiles, so must be set (and kept) along with it; if null, the compile uses its own
+        bool streaming = false; // if set, each file is parsed and generated right after it's lexed, freeing its tokens and tree early
+        Timings* timings = nullptr; // if null, nothing is measured
+        MemoryStats* memory = nullptr; // likewise
+        Trace* trace = nullptr; // likewise
+        std::vector<std::string> sourceFiles;
+        std::vector<CompileOutput> outputs;
+        std::vector<Diagnostic> diagnostics;
+    };
+
+    class Compiler
+    {
+    public:
+        // Compiles a project, with source and output paths relative to baseDirectory. Returns 0 on success;
+        // internal errors (exceptions) are reported as a diagnostic and fail the compile.
+        // Outputs are only kept in the session; nothing is written other than to the project's cache directory.
+        static int Compile(ProjectFormat& project, const std::filesystem::path& baseDirectory, ThreadPool& pool, CompileSession& session);
+
+        // Writes a session's outputs to disk, backing up source files before they're replaced
+        static bool WriteOutputs(const CompileSession& session);
+
+        // Drops a file from the warm files, for when it's changed. Any path naming the same file will do.
+        static void Invalidate(WarmFiles& warmFiles, const std::string& file);
+        static void InvalidateAll(WarmFiles& warmFiles);
+
+        // The absolute, lexically normal form of a path, so differently spelled paths to a file match
+        static std::string WarmKey(const std::string& file);
+    private:
+        Compiler();
+
+        static int compile(ProjectFormat& project, const std::filesystem::path& baseDirectory, ThreadPool& pool, CompileSession& session);
+    };
+}
+
+#endif // DIANNEX_COMPILER_H
@@ -13,9 +13,16 @@
 #include "Token.h"
 #include "Project.h"
 #include "ParseResult.h"
+#include "Symbols.h"
 
 namespace diannex
 {
+    class FileProvider;
+    class MacroCache;
+    class Timings;
+    class MemoryStats;
+    class Trace;
+
     struct TranslationInfo
     {
         std::string key;
@@ -32,6 +39,24 @@ namespace diannex
         int localCountStackIndex;
     };
 
+    // A scene, function, or definition symbol added while generating bytecode.
+    // Kept in order so that per-file contexts can be merged (and checked for duplicates) deterministically.
+    struct DefinedSymbol
+    {
+        enum class SymbolType
+        {
+            Scene,
+            Function,
+            Definition
+        };
+
+        SymbolType type;
+        Symbol name;
+        uint32_t line;
+        uint32_t column;
+        size_t errorIndex; // where a duplicate symbol error belongs in the file's error list
+    };
+
     struct CompileContext
     {
         ProjectFormat* project;
@@ -42,16 +67,18 @@ namespace diannex
 #endif
         std::string currentFile;
         std::unordered_set<std::string> files;
-        std::vector<std::pair<std::string, std::vector<Token>>> tokenList;
+        std::vector<std::pair<std::string, TokenList>> tokenList;
         std::vector<std::pair<std::string, ParseResult*>> parseList;
-        std::unordered_map<std::string, std::vector<int>> sceneBytecode;
-        std::unordered_map<std::string, std::vector<int>> functionBytecode;
+        std::unordered_map<Symbol, std::vector<int>, SymbolHash> sceneBytecode;
+        std::unordered_map<Symbol, std::vector<int>, SymbolHash> functionBytecode;
         std::unordered_set<std::string> definitions;
-        std::unordered_map<std::string, std::pair<std::variant<int, std::string>, int>> definitionBytecode;
+        std::unordered_map<Symbol, std::pair<std::variant<int, std::string>, int>, SymbolHash> definitionBytecode;
+        std::vector<DefinedSymbol> definedSymbols;
         std::vector<Instruction> bytecode;
         std::vector<std::string> internalStrings;
         std::unordered_map<std::string, int> internalStringsMap;
-        std::vector<std::string> symbolStack;
+        std::unordered_map<Symbol, int> internalSymbolsMap; // shortcut into internalStrings for symbol names
+        std::vector<Symbol> symbolStack; // each entry is the full name of its scope
         std::vector<std::string> localStack;
         std::vector<int> localCountStack;
         std::vector<LoopContext> loopStack;
@@ -63,9 +90,21 @@ namespace diannex
         int32_t maxStringId = -1;
         std::unordered_map<std::string, std::vector<std::pair<uint32_t, int32_t>>> stringIdPositions;
 
+        const LineIndex* lines = nullptr; // of the file being generated, for error positions; if null, they're unknown
+        FileProvider* fileProvider = nullptr; // resolves #include directives; if null, they're resolved on disk
+        const MacroCache* macroCache = nullptr; // project macros, lexed ahead of time; if null, they're lexed when first used
+        Timings* timings = nullptr; // set when measuring --timings
+        MemoryStats* memory = nullptr; // set when measuring --memory
+        Trace* trace = nullptr; // set when writing --trace_out
+
         ~CompileContext();
 
-        int string(const std::string& str);
+        int string(std::string_view str);
+        int string(Symbol symbol);
+
+        // Position of a token in the file being generated; 0 if unknown
+        uint32_t tokenLine(const Token& t) const;
+        uint32_t tokenColumn(const Token& t) const;
     };
 }
 	
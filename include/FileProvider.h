@@ -0,0 +1,78 @@
+#ifndef DIANNEX_FILEPROVIDER_H
+#define DIANNEX_FILEPROVIDER_H
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace diannex
+{
+    // Contents of a source file: owned, borrowed, or mapped from disk. Always followed by a null character.
+    class SourceBuffer
+    {
+    public:
+        SourceBuffer() = default;
+        ~SourceBuffer();
+        SourceBuffer(const SourceBuffer&) = delete;
+        SourceBuffer& operator=(const SourceBuffer&) = delete;
+
+        // Takes ownership of a string
+        void Assign(std::string&& str);
+
+        // Refers to a string owned by someone else, which must outlive the buffer
+        void Borrow(const std::string& str);
+
+        // Maps a file into memory, or reads it where it can't be mapped. Returns false, with a reason in error, on failure.
+        bool Map(const std::string& path, std::string& error);
+
+        std::string_view View() const { return std::string_view(data, size); }
+
+        // Frees (or unmaps) the contents, leaving the buffer empty
+        void Release();
+    private:
+
+        std::string owned;
+        const char* data = "";
+        size_t size = 0;
+        void* mapping = nullptr; // start of the mapped view, if mapped
+        size_t mappingSize = 0;
+    };
+
+    // Where the compiler gets its source files from. Called from worker threads, possibly several at once.
+    class FileProvider
+    {
+    public:
+        virtual ~FileProvider() = default;
+
+        // Reads a whole source file. Returns false, with a reason in error, if it can't be read.
+        virtual bool Read(const std::string& path, SourceBuffer& source, std::string& error) = 0;
+
+        // Path of the file named by an #include directive in another file.
+        // By default, relative to the directory of the including file.
+        virtual std::string ResolveInclude(const std::string& from, const std::string& include);
+    };
+
+    // Reads source files from disk, mapping them into memory. Includes resolve to absolute paths.
+    class DiskFileProvider : public FileProvider
+    {
+    public:
+        virtual bool Read(const std::string& path, SourceBuffer& source, std::string& error);
+        virtual std::string ResolveInclude(const std::string& from, const std::string& include);
+    };
+
+    // Serves source files from memory, keyed by path (as given in the project, joined to its base directory)
+    class MemoryFileProvider : public FileProvider
+    {
+    public:
+        // Adds or replaces a file. Not safe to call while compiling.
+        void Set(const std::string& path, const std::string& source);
+        void Remove(const std::string& path);
+
+        // Lends out the stored file, without copying it
+        virtual bool Read(const std::string& path, SourceBuffer& source, std::string& error);
+    private:
+        std::unordered_map<std::string, std::string> files;
+    };
+}
+
+#endif // DIANNEX_FILEPROVIDER_H
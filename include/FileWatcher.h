@@ -0,0 +1,32 @@
+#ifndef DIANNEX_FILEWATCHER_H
+#define DIANNEX_FILEWATCHER_H
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace diannex
+{
+    // Waits for changes to a set of files, using inotify. Only supported on Linux.
+    class FileWatcher
+    {
+    public:
+        FileWatcher();
+        ~FileWatcher();
+
+        bool IsSupported();
+
+        // Replaces the set of watched files. Their directories are watched, so files replaced by editors are seen too.
+        void Watch(const std::vector<std::string>& files);
+
+        // Blocks until at least one watched file changes, then returns all of the files changed in that burst
+        std::vector<std::string> WaitForChanges();
+    private:
+        int fd = -1;
+        std::unordered_set<std::string> files;
+        std::unordered_map<int, std::string> directories;
+    };
+}
+
+#endif // DIANNEX_FILEWATCHER_H
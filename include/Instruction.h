@@ -2,6 +2,7 @@
 #define DIANNEX_INSTRUCTION_H
 
 #include "BinaryWriter.h"
+#include "Symbols.h"
 
 #ifndef _MSC_VER
 typedef double double_t;
@@ -105,7 +106,7 @@ namespace diannex
             struct
             {
                 int32_t count;
-                std::vector<std::string>* vec;
+                std::vector<Symbol>* vec;
             };
 
             double_t argDouble;
@@ -162,7 +163,7 @@ namespace diannex
             return res;
         }
 
-        static inline Instruction make_patch_call(int32_t* offset, int32_t count, std::vector<std::string>* vec)
+        static inline Instruction make_patch_call(int32_t* offset, int32_t count, std::vector<Symbol>* vec)
         {
             Instruction res = Instruction(offset, Opcode::PATCH_CALL);
             res.count = count;
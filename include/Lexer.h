@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <queue>
 #include <unordered_map>
 
@@ -17,10 +18,37 @@ namespace diannex
     // Stringifies a token. Can return nullptr if it is a certain Error-type token.
     const char* tokenToString(Token t);
 
+    // A project macro, lexed on its own; its tokens take the position of each use
+    struct LexedMacro
+    {
+        std::string name;
+        TokenList tokens;
+        std::vector<std::pair<uint32_t, const LexedMacro*>> nested; // identifier tokens naming other macros, expanded when copied
+        std::vector<std::string> includes; // as written; resolved relative to the file using the macro
+        int32_t maxStringId = -1;
+    };
+
+    // Every project macro, lexed once so that each use only copies its tokens
+    class MacroCache
+    {
+    public:
+        MacroCache(ProjectFormat* project);
+        MacroCache(const MacroCache&) = delete;
+        MacroCache& operator=(const MacroCache&) = delete;
+
+        // Returns null if there's no macro with the name
+        const LexedMacro* Find(std::string_view name) const;
+    private:
+        std::unordered_map<std::string_view, LexedMacro> macros; // keyed by the project's own macro names
+    };
+
     class Lexer
     {
     public:
-        static void LexString(const std::string& in, CompileContext* ctx, std::vector<Token>& out, uint32_t startLine = 1, uint16_t startColumn = 1, std::unordered_set<std::string>* macros = nullptr);
+        // The input must be followed by a null character, as in a std::string or a SourceBuffer.
+        // Token offsets start from startOffset; when lexing a whole file (from 0), out's line index is built from it too.
+        // If macro is set, lexes a macro's body into it, leaving uses of other macros unexpanded.
+        static void LexString(std::string_view in, CompileContext* ctx, TokenList& out, uint32_t startOffset = 0, LexedMacro* macro = nullptr);
     private:
         Lexer();
     };
@@ -0,0 +1,86 @@
+#ifndef DIANNEX_MEMORYSTATS_H
+#define DIANNEX_MEMORYSTATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Timings.h"
+
+namespace diannex
+{
+    struct CompileContext;
+
+    // Resident memory at each compile phase boundary, allocations made during each phase,
+    // and estimated sizes of the larger compiler containers, for --memory
+    class MemoryStats
+    {
+    public:
+        // Allocations made through the global operator new while a MemoryStats exists
+        struct Counters
+        {
+            uint64_t allocations = 0;
+            uint64_t frees = 0;
+            uint64_t bytes = 0; // total allocated
+            int64_t live = 0; // allocated minus freed; always 0 if the allocator can't report block sizes
+
+            Counters& operator+=(const Counters& other);
+            Counters& operator-=(const Counters& other);
+        };
+
+        // Counts the allocations made between construction and Stop(), by all threads
+        class Sampler
+        {
+        public:
+            Sampler();
+            Counters Stop();
+        private:
+            Counters start;
+        };
+
+        // Starts counting allocations, until destroyed. Only one may exist at a time.
+        MemoryStats();
+        ~MemoryStats();
+
+        // Adds counters to the given phase, and records resident memory at its end
+        void AddPhase(Timings::Phase phase, const Counters& counters);
+
+        const Counters& GetPhase(Timings::Phase phase);
+
+        void AddContainer(const std::string& name, uint64_t items, uint64_t bytes);
+
+        // Estimates the token lists, ASTs, bytecode and string tables of a context that has finished generating bytecode
+        void MeasureContext(CompileContext* ctx);
+
+        void Print(std::ostream& s);
+
+        static bool TracksLiveBytes();
+
+        // Called by the global allocation functions in MemoryHooks.cpp, which only the executables link in;
+        // elsewhere, allocations aren't counted
+        static void CountAllocation(void* ptr, size_t size);
+        static void CountFree(void* ptr);
+    private:
+        struct PhaseStats
+        {
+            bool recorded = false;
+            Counters counters;
+            uint64_t rss = 0;
+            uint64_t peakRss = 0; // of the whole process so far
+        };
+
+        struct Container
+        {
+            std::string name;
+            uint64_t items;
+            uint64_t bytes;
+        };
+
+        PhaseStats phases[(int)Timings::Phase::Count];
+        std::vector<Container> containers;
+    };
+}
+
+#endif // DIANNEX_MEMORYSTATS_H
@@ -1,20 +1,23 @@
 #ifndef DIANNEX_PARSERESULT_H
 #define DIANNEX_PARSERESULT_H
 
+#include "Arena.h"
+
 #include <vector>
 
 namespace diannex
 {
     struct ParseResult
     {
-        class Node* baseNode;
+        class Node* baseNode = nullptr;
         std::vector<struct ParseError> errors;
-        bool doDelete = true;
+        Arena arena; // holds the whole tree, which is freed along with it
 
+        ParseResult() = default;
         ~ParseResult();
 
         ParseResult(const ParseResult&) = delete;
     };
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -6,6 +6,9 @@
 #include "ParseResult.h"
 
 #include <memory>
+#include <new>
+#include <optional>
+#include <utility>
 
 namespace diannex
 {
@@ -37,11 +40,22 @@ namespace diannex
     class Parser
     {
     public:
-        static ParseResult* ParseTokens(CompileContext* ctx, std::vector<Token>* tokens);
-        static ParseResult ParseTokensExpression(CompileContext* ctx, std::vector<Token>* tokens, uint32_t defaultLine, uint16_t defaultColumn);
-        static const std::string ProcessStringInterpolation(Parser* parser, Token& token, const std::string& input, std::vector<class Node*>* nodeList);
-
-        Parser(CompileContext* ctx, std::vector<Token>* tokens);
+        static ParseResult* ParseTokens(CompileContext* ctx, TokenList* tokens);
+        // Parses an expression from a range of tokens into the arena of an existing tree, positioned in a file through its line index.
+        // Any errors are added to the given list.
+        static class Node* ParseTokensExpression(CompileContext* ctx, TokenList* tokens, int begin, int end, const LineIndex* lines, uint32_t defaultOffset,
+                                                 Arena* arena, std::vector<ParseError>& errors);
+        static std::string_view ProcessStringInterpolation(Parser* parser, Token& token, std::string_view input, ArenaVector<class Node*>* nodeList);
+
+        Parser(CompileContext* ctx, TokenList* tokens, Arena* arena);
+        Parser(CompileContext* ctx, TokenList* tokens, Arena* arena, int begin, int end);
+
+        // Allocates a node from the tree's arena
+        template<typename T, typename... Args>
+        inline T* make(Args&&... args)
+        {
+            return new (arena->Allocate(sizeof(T), alignof(T))) T(*arena, std::forward<Args>(args)...);
+        }
 
         inline void advance();
         inline void synchronize();
@@ -53,22 +67,36 @@ namespace diannex
         void skipSemicolons();
         inline bool isNextToken(TokenType type);
 
-        inline Token peekToken();
-        inline Token previousToken();
+        // Tokens are handed out from the list itself, valid as long as it is
+        inline const Token& peekToken();
+        inline const Token& previousToken();
         Token ensureToken(TokenType type);
         Token ensureToken(TokenType type, TokenType type2);
         Token ensureToken(TokenType type, KeywordType keywordType);
 
-        bool checkErrorToken(Token& t);
+        bool checkErrorToken(const Token& t);
+
+        // Content of a token from this parser's list, valid until another token is made
+        std::string_view content(const Token& t);
+        std::optional<StringData> stringData(const Token& t);
+        NumberData number(const Token& t);
+
+        // Position of a token, for errors; 0 if unknown
+        inline uint32_t tokenLine(const Token& t) { return lines->Line(t.offset); }
+        inline uint32_t tokenColumn(const Token& t) { return lines->Column(t.offset); }
 
         std::vector<ParseError> errors;
         CompileContext* context;
-        uint32_t defaultLine = 0;
+        const LineIndex* lines; // of the file the tokens are from
+        Arena* arena; // what the tree is allocated from
+        uint32_t defaultLine = 0; // used for errors at the end of the tokens
         uint32_t defaultColumn = 0;
     private:
         Parser();
 
-        std::vector<Token>* tokens;
+        inline const Token& tokenAt(int index);
+
+        TokenList* tokens;
         int tokenCount;
         int position;
         int storedPosition;
@@ -76,6 +104,9 @@ namespace diannex
 
     /*
         General-purpose node types
+
+        Nodes are allocated from the arena of the ParseResult they belong to, and are freed along with it
+        without being destroyed. Anything a node holds (children, strings) also lives in the arena.
     */
 
     class Node
@@ -142,7 +173,7 @@ namespace diannex
         };
 
         static Node* ParseGroupBlock(Parser* parser, bool isNamespace);
-        static Node* ParseNamespaceBlock(Parser* parser, std::string name);
+        static Node* ParseNamespaceBlock(Parser* parser, Token name);
         static Node* ParseGroupStatement(Parser* parser, KeywordType modifier);
 
         static Node* ParseDefinitionBlock(Parser* parser, Token name);
@@ -167,11 +198,10 @@ namespace diannex
         static Node* ParseMulDiv(Parser* parser);
         static Node* ParseExprLast(Parser* parser);
 
-        Node(NodeType type);
-        ~Node();
+        Node(Arena& arena, NodeType type);
 
         NodeType type;
-        std::vector<Node*> nodes;
+        ArenaVector<Node*> nodes;
 
     private:
         Node(const Node&) = delete; 
@@ -181,10 +211,10 @@ namespace diannex
     class NodeContent : public Node
     {
     public:
-        NodeContent(Token token, NodeType type);
-        NodeContent(std::string content, NodeType type);
+        NodeContent(Arena& arena, Token token, std::string_view content, NodeType type);
+        NodeContent(Arena& arena, std::string_view content, NodeType type);
 
-        std::string content;
+        std::string_view content;
         Token token;
     private:
         NodeContent(const NodeContent&) = delete;
@@ -197,10 +227,10 @@ namespace diannex
     class NodeText : public NodeContent
     {
     public:
-        NodeText(NodeType type, std::string content, std::shared_ptr<StringData> stringData, bool excludeTranslation);
-        NodeText(std::string content, std::shared_ptr<StringData> stringData, bool excludeTranslation);
+        NodeText(Arena& arena, NodeType type, std::string_view content, std::optional<StringData> stringData, bool excludeTranslation);
+        NodeText(Arena& arena, std::string_view content, std::optional<StringData> stringData, bool excludeTranslation);
         bool excludeTranslation;
-        std::shared_ptr<StringData> stringData;
+        std::optional<StringData> stringData;
     private:
         NodeText(const NodeText&) = delete;
     };
@@ -208,9 +238,14 @@ namespace diannex
     class NodeToken : public Node
     {
     public:
-        NodeToken(NodeType type, Token token);
+        NodeToken(Arena& arena, NodeType type, Token token);
+        NodeToken(Arena& arena, NodeType type, Token token, std::string_view content, std::optional<StringData> stringData = std::nullopt);
+        NodeToken(Arena& arena, NodeType type, Token token, NumberData number);
 
         Token token;
+        std::string_view content;
+        std::optional<StringData> stringData; // for string literals
+        NumberData number; // for number and percentage literals
     private:
         NodeToken(const NodeToken&) = delete;
     };
@@ -218,7 +253,7 @@ namespace diannex
     class NodeTokenModifier : public Node
     {
     public:
-        NodeTokenModifier(NodeType type, Token token, KeywordType modifier);
+        NodeTokenModifier(Arena& arena, NodeType type, Token token, KeywordType modifier);
 
         Token token;
         KeywordType modifier;
@@ -229,9 +264,9 @@ namespace diannex
     class NodeScene : public NodeContent
     {
     public:
-        NodeScene(Token token);
+        NodeScene(Arena& arena, Token token, std::string_view name);
 
-        std::vector<NodeContent*> flags;
+        ArenaVector<NodeContent*> flags;
     private:
         NodeScene(const NodeScene&) = delete;
     };
@@ -239,14 +274,14 @@ namespace diannex
     class NodeFunc : public Node
     {
     public:
-        NodeFunc(Token token, KeywordType modifier);
-        NodeFunc(std::string name, KeywordType modifier);
+        NodeFunc(Arena& arena, Token token, std::string_view name, KeywordType modifier);
+        NodeFunc(Arena& arena, std::string_view name, KeywordType modifier);
 
-        std::string name;
+        std::string_view name;
         Token token;
         KeywordType modifier;
-        std::vector<Token> args;
-        std::vector<NodeContent*> flags;
+        ArenaVector<std::string_view> args;
+        ArenaVector<NodeContent*> flags;
     private:
         NodeFunc(const NodeFunc&) = delete;
     };
@@ -259,11 +294,11 @@ namespace diannex
     class NodeDefinition : public Node
     {
     public:
-        NodeDefinition(std::string key, std::string value, std::shared_ptr<StringData> stringData, bool excludeValueTranslation);
+        NodeDefinition(Arena& arena, std::string_view key, std::string_view value, std::optional<StringData> stringData, bool excludeValueTranslation);
 
-        std::string key;
-        std::string value;
-        std::shared_ptr<StringData> stringData;
+        std::string_view key;
+        std::string_view value;
+        std::optional<StringData> stringData;
         bool excludeValueTranslation;
     private:
         NodeDefinition(const NodeDefinition&) = delete;
@@ -52,6 +52,9 @@ namespace diannex
 
         // Whether or not to use string IDs in private translation files. default: false
         bool useStringIds;
+
+        // Directory to cache compiled files in, so unchanged files aren't recompiled. default: None
+        std::string cacheDir;
     };
 
     struct ProjectFormat
@@ -0,0 +1,26 @@
+#ifndef DIANNEX_SERVER_H
+#define DIANNEX_SERVER_H
+
+#include <functional>
+#include <string>
+
+namespace diannex
+{
+    // Serves newline-delimited requests one at a time, either over stdin/stdout or a Unix socket
+    class Server
+    {
+    public:
+        // Takes a single request line and returns the response line. Set stop to shut down the server.
+        typedef std::function<std::string(const std::string& request, bool& stop)> Handler;
+
+        static void ServeStdio(Handler handler);
+
+        // Returns false if the socket couldn't be set up (including when the path exists and isn't a socket),
+        // if accepting connections fails, or if sockets aren't supported on this platform
+        static bool ServeSocket(const std::string& path, Handler handler);
+    private:
+        Server();
+    };
+}
+
+#endif // DIANNEX_SERVER_H
@@ -0,0 +1,81 @@
+#ifndef DIANNEX_SYMBOLS_H
+#define DIANNEX_SYMBOLS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+namespace diannex
+{
+    // ID of an interned scene, function, definition or namespace name. Equal names always share an ID.
+    typedef uint32_t Symbol;
+
+    // Holds interned names for as long as anything compiled with it is kept, e.g. alongside a set of warm files.
+    // Names are kept in an arena until the table is cleared. Safe to use from several threads at once.
+    class SymbolTable
+    {
+    public:
+        SymbolTable();
+        ~SymbolTable();
+        SymbolTable(SymbolTable&&) noexcept;
+        SymbolTable& operator=(SymbolTable&&) noexcept;
+
+        // Drops every name; nothing holding symbols from this table may be used afterwards
+        void Clear();
+
+        // Whether a name failed to be interned because the table ran out of IDs.
+        // Those names all got Symbols::Overflow, so anything compiled since is unusable.
+        bool Full() const;
+    private:
+        friend class SymbolScope;
+        std::unique_ptr<struct SymbolTableData> data;
+    };
+
+    // Makes a table current on this thread until the scope ends
+    class SymbolScope
+    {
+    public:
+        SymbolScope(SymbolTable* table);
+        ~SymbolScope();
+
+        SymbolScope(const SymbolScope&) = delete;
+    private:
+        SymbolTableData* previous;
+    };
+
+    // Interns symbol names into the table current on the calling thread (see SymbolScope), so that every compile
+    // (and every warm shard) sharing a table agrees on their IDs
+    class Symbols
+    {
+    public:
+        static constexpr Symbol None = UINT32_MAX;
+        static constexpr Symbol Overflow = 0; // given to names that don't fit in a full table
+
+        static Symbol Intern(std::string_view name);
+
+        // The symbol for "parent.name", or just name if parent is None
+        static Symbol Child(Symbol parent, Symbol name);
+
+        // Like Child, but returns None instead of interning a name that doesn't exist yet
+        static Symbol FindChild(Symbol parent, Symbol name);
+
+        static std::string_view Name(Symbol symbol);
+
+        // Same as the standard hash of the name, so that containers keyed by symbols are laid out as if keyed by names
+        static size_t Hash(Symbol symbol);
+
+        // Number of names and bytes held by the table, for --memory
+        static size_t Count();
+        static size_t HeapSize();
+    private:
+        Symbols();
+    };
+
+    struct SymbolHash
+    {
+        size_t operator()(Symbol symbol) const { return Symbols::Hash(symbol); }
+    };
+}
+
+#endif // DIANNEX_SYMBOLS_H
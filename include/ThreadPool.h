@@ -0,0 +1,42 @@
+#ifndef DIANNEX_THREADPOOL_H
+#define DIANNEX_THREADPOOL_H
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace diannex
+{
+    class ThreadPool
+    {
+    public:
+        ThreadPool(unsigned int threadCount);
+        ~ThreadPool();
+
+        // Queues a task to be run on a worker thread. Can be called from within a running task.
+        void Submit(std::function<void()> task);
+
+        // Blocks until all submitted tasks (including ones submitted by other tasks) have finished,
+        // then rethrows the first exception any of them threw, if there was one
+        void Wait();
+
+        unsigned int GetThreadCount();
+    private:
+        void WorkerLoop();
+
+        std::vector<std::thread> workers;
+        std::queue<std::function<void()>> tasks;
+        std::mutex mutex;
+        std::condition_variable taskAvailable;
+        std::condition_variable tasksFinished;
+        unsigned int pending = 0;
+        std::exception_ptr error; // first exception thrown by a task since the last Wait
+        bool stopping = false;
+    };
+}
+
+#endif // DIANNEX_THREADPOOL_H
@@ -0,0 +1,79 @@
+#ifndef DIANNEX_TIMINGS_H
+#define DIANNEX_TIMINGS_H
+
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace diannex
+{
+    // Wall and CPU time spent in each compile phase and on each file, for --timings
+    class Timings
+    {
+    public:
+        enum class Phase
+        {
+            Lex,
+            Parse,
+            Bytecode,
+            StringIds,
+            Binary,
+            Compression,
+            Translation,
+
+            Count
+        };
+
+        // Wall and CPU time, in milliseconds
+        struct Time
+        {
+            double wall = 0;
+            double cpu = 0;
+
+            Time& operator+=(const Time& other);
+            Time& operator-=(const Time& other);
+        };
+
+        // Measures the time between construction and Stop(). Whole phases use CPU time
+        // across all threads, while single files only use the CPU time of the current thread.
+        class Timer
+        {
+        public:
+            Timer(bool threadOnly = false);
+            Time Stop();
+        private:
+            bool threadOnly;
+            std::chrono::steady_clock::time_point wallStart;
+            double cpuStart;
+        };
+
+        void AddPhase(Phase phase, const Time& time);
+
+        // Safe to call from worker threads
+        void AddFile(const std::string& file, Phase phase, const Time& time);
+
+        const Time& GetPhase(Phase phase);
+
+        void Print(std::ostream& s, unsigned int topFiles);
+        bool WriteJson(const std::string& path);
+
+        static const char* PhaseName(Phase phase);
+    private:
+        struct FileTimes
+        {
+            Time phases[(int)Phase::Count];
+            Time total;
+        };
+
+        std::vector<std::pair<std::string, const FileTimes*>> sortedFiles();
+
+        Time phases[(int)Phase::Count];
+        std::mutex filesMutex;
+        std::unordered_map<std::string, FileTimes> files;
+    };
+}
+
+#endif // DIANNEX_TIMINGS_H
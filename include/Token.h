@@ -1,12 +1,15 @@
 #ifndef DIANNEX_TOKEN_H
 #define DIANNEX_TOKEN_H
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <memory>
+#include <vector>
 
 namespace diannex
 {
-    enum class TokenType
+    enum class TokenType : uint8_t
     {
         Identifier, // a-z, A-Z, other language chars, _ (and 0-9 or . after first char)
         Number, // 0-9 first chars, optional . followed by more 0-9
@@ -83,7 +86,7 @@ namespace diannex
         ErrorUnenclosedString, // If there's a string with no end
     };
 
-    enum class KeywordType
+    enum class KeywordType : uint8_t
     {
         None,
 
@@ -132,19 +135,150 @@ namespace diannex
         StringData(int32_t localizedStringId, uint32_t endOfStringPos);
     };
 
+    // Value of a number or percentage literal, parsed once when it's lexed
+    struct NumberData
+    {
+        double value = 0;
+        bool integer = false; // written without a decimal point, so generated as an int if it fits in one
+
+        NumberData() = default;
+        NumberData(double value, bool integer);
+    };
+
+    // A lexed token. Its content (if any) is held by the TokenList it came from.
     struct Token
     {
+        static constexpr uint32_t NoOffset = UINT32_MAX; // for tokens that don't come from a source
+
         TokenType type = TokenType::Error;
-        uint32_t line = 0;
-        uint32_t column = 0;
         KeywordType keywordType = KeywordType::None;
-        std::string content; // unused if KeywordType is known
-        std::shared_ptr<StringData> stringData = nullptr;
+        uint32_t offset = NoOffset; // where the token starts in its source; see LineIndex
+        uint32_t content = 0; // offset into the list's text, or for string and number literals, index into their values
+        uint32_t length = 0; // length of the content
+
+        Token() = default;
+        Token(TokenType type, uint32_t offset = NoOffset);
+        Token(TokenType type, uint32_t offset, KeywordType keywordType);
+    };
+    static_assert(sizeof(Token) == 16, "tokens should stay compact");
+
+    // Where each line of a source starts. Tokens only hold offsets, which are turned into
+    // line and column numbers (both from 1) when a position is reported.
+    class LineIndex
+    {
+    public:
+        void Build(std::string_view source);
+
+        // Both are 0 for Token::NoOffset, or if nothing has been indexed
+        uint32_t Line(uint32_t offset) const;
+        uint32_t Column(uint32_t offset) const;
+
+        void Clear();
+        uint64_t HeapSize() const;
+    private:
+        std::vector<uint32_t> starts;
+    };
+
+    // Tokens lexed from one source, along with their content
+    class TokenList
+    {
+    public:
+        // An expression inside an interpolated string literal, already lexed
+        struct Interpolation
+        {
+            uint32_t begin; // range of the expression's tokens in the interpolated list
+            uint32_t end;
+            uint32_t offset; // where the expression starts in the source
+        };
+
+        std::vector<Token> tokens;
+        LineIndex lines; // of the source the tokens were lexed from
+        std::unique_ptr<TokenList> interpolated; // tokens of expressions in string literals, kept out of the main stream
+        std::vector<Interpolation> interpolations; // of every string literal, in order
+
+        // Adds a token without content
+        inline void Add(TokenType type, uint32_t offset, KeywordType keywordType = KeywordType::None)
+        {
+            tokens.emplace_back(type, offset, keywordType);
+        }
+
+        // Adds a token, copying its content into the list
+        void Add(TokenType type, uint32_t offset, std::string_view content);
+
+        // Adds a string literal token, with its data kept to the side.
+        // The last interpolationCount interpolations added belong to it.
+        void AddString(TokenType type, uint32_t offset, std::string_view content, StringData data, uint32_t interpolationCount = 0);
+
+        // Adds a number or percentage literal token, which keeps only its value
+        void AddNumber(TokenType type, uint32_t offset, NumberData data);
+
+        // Makes a token with content, without adding it to the list
+        Token Make(TokenType type, uint32_t offset, std::string_view content);
+
+        // Adds a copy of a token from another list, at a new position. String literals lose any interpolations.
+        void Copy(const TokenList& from, Token token, uint32_t offset);
+
+        inline std::string_view Content(const Token& token) const
+        {
+            if (token.length == 0)
+                return std::string_view();
+            if (isString(token.type))
+                return std::string_view(text.data() + strings[token.content].offset, token.length);
+            return std::string_view(text.data() + token.content, token.length);
+        }
+
+        // Returns null if the token isn't a string literal
+        inline const StringData* GetStringData(const Token& token) const
+        {
+            return isString(token.type) ? &strings[token.content].data : nullptr;
+        }
+
+        // Interpolations of a string literal, in the order they appear. Sets count to 0 if there are none.
+        inline const Interpolation* GetInterpolations(const Token& token, uint32_t& count) const
+        {
+            if (!isString(token.type))
+            {
+                count = 0;
+                return nullptr;
+            }
+            const StringLiteral& literal = strings[token.content];
+            count = literal.interpolationCount;
+            return interpolations.data() + literal.firstInterpolation;
+        }
+
+        // Zero if the token isn't a number or percentage literal
+        inline NumberData GetNumberData(const Token& token) const
+        {
+            return isNumber(token.type) ? numbers[token.content] : NumberData();
+        }
+
+        // Frees the tokens, their content and interpolations. The line index is kept, for positions of anything made from the tokens.
+        void Clear();
+
+        // Bytes allocated to hold the tokens, their content, interpolations and the line index
+        uint64_t HeapSize() const;
+    private:
+        struct StringLiteral
+        {
+            uint32_t offset; // into text
+            StringData data;
+            uint32_t firstInterpolation;
+            uint32_t interpolationCount;
+        };
+
+        static inline bool isString(TokenType type)
+        {
+            return type == TokenType::String || type == TokenType::MarkedString || type == TokenType::ExcludeString;
+        }
+
+        static inline bool isNumber(TokenType type)
+        {
+            return type == TokenType::Number || type == TokenType::Percentage;
+        }
 
-        Token(TokenType type, uint32_t line, uint32_t column);
-        Token(TokenType type, uint32_t line, uint32_t column, KeywordType keywordType);
-        Token(TokenType type, uint32_t line, uint32_t column, std::string content);
-        Token(TokenType type, uint32_t line, uint32_t column, std::string content, std::shared_ptr<StringData> stringData);
+        std::string text;
+        std::vector<StringLiteral> strings;
+        std::vector<NumberData> numbers;
     };
 }
 
@@ -0,0 +1,66 @@
+#ifndef DIANNEX_TRACE_H
+#define DIANNEX_TRACE_H
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace diannex
+{
+    // A timeline of what each thread was doing, written as Chrome trace events
+    // (readable by chrome://tracing and Perfetto), for --trace_out
+    class Trace
+    {
+    public:
+        // A span of time on the current thread, from construction until End() or destruction.
+        // Does nothing if the trace is null, so it can be left in place when not tracing.
+        class Span
+        {
+        public:
+            Span(Trace* trace, const char* category, const std::string& name);
+            ~Span();
+
+            // Ends this span, and starts another in the same category right away
+            void Next(const std::string& name);
+            void End();
+        private:
+            Trace* trace;
+            const char* category;
+            std::string name;
+            double start;
+            bool open;
+        };
+
+        // The thread creating the trace is named as the main thread
+        Trace();
+
+        // Microseconds since the trace started
+        double Now();
+
+        // Safe to call from worker threads
+        void AddSpan(const char* category, const std::string& name, double start, double end);
+
+        bool Write(const std::string& path);
+    private:
+        struct Event
+        {
+            const char* category;
+            std::string name;
+            double start;
+            double duration;
+            uint32_t thread;
+        };
+
+        uint32_t threadIndex(); // must be called with mutex held
+
+        std::chrono::steady_clock::time_point origin;
+        std::mutex mutex;
+        std::vector<Event> events;
+        std::unordered_map<std::thread::id, uint32_t> threads;
+    };
+}
+
+#endif // DIANNEX_TRACE_H
@@ -12,12 +12,13 @@ namespace diannex
     class Translation
     {
     public:
-        static void GeneratePublicFile(std::ofstream& s, CompileContext* ctx);
-        static void GeneratePrivateFile(std::ofstream& s, CompileContext* ctx);
+        static void GeneratePublicFile(std::ostream& s, CompileContext* ctx);
+        static void GeneratePrivateFile(std::ostream& s, CompileContext* ctx);
 
         static void ConvertPrivateToPublic(std::ifstream& in, std::ofstream& out);
         static void ConvertPublicToPrivate(std::ifstream& in, std::ifstream& inMatch, std::ofstream& out);
 
+        // Throws std::runtime_error if a string ID is missing or malformed
         static void UpgradeFileToNewer(std::ifstream& in, bool isInputPrivate, std::ifstream& inNewer, std::ofstream& out);
 
         static void ConvertToBinary(std::ifstream& in, bool isInputPrivate, BinaryWriter& bw);
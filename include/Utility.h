@@ -11,6 +11,9 @@ namespace diannex
     struct Token;
     void generate_project(std::string name);
     void load_project(std::string path, ProjectFormat &proj);
+
+    // Reads a project from the contents of a project file. Returns false, with a reason in error, if it's invalid.
+    bool parse_project(const std::string& text, const std::string& defaultName, ProjectFormat& proj, std::string& error);
 }
 
 #endif // DIANNEX_UTILITY_H
\ No newline at end of file
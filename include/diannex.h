@@ -0,0 +1,86 @@
+#ifndef DIANNEX_C_H
+#define DIANNEX_C_H
+
+/*
+    C interface to the compiler, for embedding it in other programs (e.g. to recompile in-process when sources change).
+    Sources are read through a file provider, and outputs are returned in memory; nothing is written to disk,
+    other than to the project's cache directory if it has one. No function lets a C++ exception escape, including
+    ones thrown on the compiler's worker threads: failures are reported through the result, and out-of-range indices
+    give null or 0.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct diannex_compiler diannex_compiler;
+typedef struct diannex_result diannex_result;
+typedef struct diannex_buffer diannex_buffer;
+
+typedef enum diannex_output_type
+{
+    DIANNEX_OUTPUT_BINARY,
+    DIANNEX_OUTPUT_PUBLIC_TRANSLATION,
+    DIANNEX_OUTPUT_PRIVATE_TRANSLATION,
+    DIANNEX_OUTPUT_SOURCE /* a source file with new string IDs added, from "add_string_ids" */
+} diannex_output_type;
+
+/* Copies data into a buffer passed to a file provider callback */
+void diannex_buffer_set(diannex_buffer* buffer, const char* data, size_t size);
+
+/*
+    Callbacks for reading source files. These may be called from several threads at once.
+    read: fills out with the contents of path, returning 0 if it can't be read.
+    resolve_include: fills out with the path of the file named by an #include directive in from, returning 0 on failure.
+        If null, includes are relative to the directory of the including file.
+*/
+typedef struct diannex_file_provider
+{
+    void* user;
+    int (*read)(void* user, const char* path, diannex_buffer* out);
+    int (*resolve_include)(void* user, const char* from, const char* include, diannex_buffer* out);
+} diannex_file_provider;
+
+/* Creates a compiler with its own worker threads (0 for one per hardware thread), which keeps files warm between compiles.
+   Returns null if the compiler can't be created. */
+diannex_compiler* diannex_compiler_create(unsigned int threads);
+void diannex_compiler_destroy(diannex_compiler* compiler);
+
+/* Marks a source file as changed, so it's recompiled next time. Any path naming the file will do, absolute or relative
+   to the current directory. Pass null to recompile everything. */
+void diannex_compiler_invalidate(diannex_compiler* compiler, const char* path);
+
+/*
+    Compiles a project, given the contents of its project file. Source paths are relative to base_directory.
+    If files is null, sources are read from disk. Calls on the same compiler must not overlap.
+    Internal errors fail the compile with a diagnostic and drop all warm files. Returns null only if the result itself
+    can't be allocated; free the result with diannex_result_free.
+*/
+diannex_result* diannex_compile(diannex_compiler* compiler, const char* project_json, const char* base_directory, const diannex_file_provider* files);
+
+int diannex_result_success(const diannex_result* result);
+
+/* Progress and errors, as the command line compiler would print them */
+const char* diannex_result_log(const diannex_result* result);
+
+size_t diannex_result_output_count(const diannex_result* result);
+diannex_output_type diannex_result_output_type(const diannex_result* result, size_t index);
+const char* diannex_result_output_path(const diannex_result* result, size_t index);
+const char* diannex_result_output_data(const diannex_result* result, size_t index, size_t* size);
+
+size_t diannex_result_diagnostic_count(const diannex_result* result);
+const char* diannex_result_diagnostic_file(const diannex_result* result, size_t index);
+uint32_t diannex_result_diagnostic_line(const diannex_result* result, size_t index); /* 0 if unknown */
+uint32_t diannex_result_diagnostic_column(const diannex_result* result, size_t index);
+const char* diannex_result_diagnostic_message(const diannex_result* result, size_t index);
+
+void diannex_result_free(diannex_result* result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DIANNEX_C_H */
@@ -0,0 +1,61 @@
+#include "Arena.h"
+
+#include <cstring>
+
+namespace diannex
+{
+    Arena::~Arena()
+    {
+        Clear();
+    }
+
+    void* Arena::Allocate(size_t size, size_t align)
+    {
+        size_t padding = (align - ((uintptr_t)current & (align - 1))) & (align - 1);
+        if (padding + size > left)
+        {
+            // Big allocations get a chunk of their own, so the current one can still be used
+            if (size > ChunkSize / 4)
+            {
+                char* chunk = new char[size];
+                chunks.push_back(chunk);
+                chunkBytes += size;
+                return chunk;
+            }
+            current = new char[ChunkSize];
+            chunks.push_back(current);
+            chunkBytes += ChunkSize;
+            left = ChunkSize;
+            padding = 0;
+        }
+        char* res = current + padding;
+        current = res + size;
+        left -= padding + size;
+        return res;
+    }
+
+    std::string_view Arena::Copy(std::string_view str)
+    {
+        if (str.empty())
+            return std::string_view();
+        char* res = (char*)Allocate(str.size(), 1);
+        std::memcpy(res, str.data(), str.size());
+        return std::string_view(res, str.size());
+    }
+
+    void Arena::Clear()
+    {
+        for (char* chunk : chunks)
+            delete[] chunk;
+        chunks.clear();
+        chunks.shrink_to_fit();
+        current = nullptr;
+        left = 0;
+        chunkBytes = 0;
+    }
+
+    uint64_t Arena::HeapSize() const
+    {
+        return chunkBytes + chunks.capacity() * sizeof(char*);
+    }
+}
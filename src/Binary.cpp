@@ -1,4 +1,7 @@
 #include "Binary.h"
+#include "MemoryStats.h"
+#include "Timings.h"
+#include "Trace.h"
 
 #include <algorithm>
 #include <random>
@@ -34,6 +37,7 @@ namespace diannex
         bw->WriteUInt8((uint8_t)compressed | ((uint8_t)internalTranslationFile << 1));
 
         BinaryMemoryWriter bmw;
+        Trace::Span section(ctx->trace, "binary", "scene metadata");
 
         // Scene metadata
         uint32_t begin = bmw.GetSize();
@@ -53,6 +57,7 @@ namespace diannex
         bmw.SizePatch(begin);
 
         // Function metadata
+        section.Next("function metadata");
         begin = bmw.GetSize();
         bmw.WriteUInt32(0);
         bmw.WriteUInt32(ctx->functionBytecode.size());
@@ -70,6 +75,7 @@ namespace diannex
         bmw.SizePatch(begin);
 
         // Definition metadata
+        section.Next("definition metadata");
         begin = bmw.GetSize();
         bmw.WriteUInt32(0);
         bmw.WriteUInt32(ctx->definitionBytecode.size());
@@ -95,17 +101,21 @@ namespace diannex
         int externalFunctionIndex = 0;
 
         // Bytecode
+        section.Next("bytecode");
         bmw.WriteUInt32(ctx->offset);
         for (auto it = ctx->bytecode.begin(); it != ctx->bytecode.end(); ++it)
         {
             if (it->opcode == Instruction::Opcode::PATCH_CALL)
             {
-                std::string funcName = it->vec->at(0);
+                Symbol funcName = it->vec->at(0);
 
                 // Start with local levels, go to higher levels
                 for (int i = it->vec->size() - 1; i >= 1; --i)
                 {
-                    auto func = ctx->functionBytecode.find(it->vec->at(i) + "." + funcName);
+                    Symbol scoped = Symbols::FindChild(it->vec->at(i), funcName);
+                    if (scoped == Symbols::None)
+                        continue;
+                    auto func = ctx->functionBytecode.find(scoped);
                     if (func != ctx->functionBytecode.end())
                     {
                         delete it->vec;
@@ -147,6 +157,7 @@ namespace diannex
         }
 
         // Internal string table
+        section.Next("internal strings");
         begin = bmw.GetSize();
         bmw.WriteUInt32(0);
         bmw.WriteUInt32(ctx->internalStrings.size());
@@ -157,6 +168,7 @@ namespace diannex
         // Internal translation file (if applicable)
         if (internalTranslationFile)
         {
+            section.Next("internal translation");
             uint32_t count = 0;
             for (auto it = ctx->translationInfo.begin(); it != ctx->translationInfo.end(); ++it)
             {
@@ -176,6 +188,7 @@ namespace diannex
         }
 
         // External function list
+        section.Next("external functions");
         begin = bmw.GetSize();
         bmw.WriteUInt32(0);
         bmw.WriteUInt32(externalFunctions.size());
@@ -183,11 +196,26 @@ namespace diannex
             bmw.WriteUInt32(*it);
         bmw.SizePatch(begin);
 
+        section.End();
+
         uint32_t size = bmw.GetSize();
+        if (ctx->memory != nullptr)
+            ctx->memory->AddContainer("Binary::Write buffer", size, bmw.GetCapacity());
         if (compressed)
         {
             std::vector<uint8_t> out;
+            Timings::Timer timer;
+            MemoryStats::Sampler sampler;
+            Trace::Span span(ctx->trace, "binary", "compress");
             uint32_t compSize = Compress(bmw.GetBuffer(), size, out);
+            if (ctx->timings != nullptr)
+                ctx->timings->AddPhase(Timings::Phase::Compression, timer.Stop());
+            span.End();
+            if (ctx->memory != nullptr)
+            {
+                ctx->memory->AddPhase(Timings::Phase::Compression, sampler.Stop());
+                ctx->memory->AddContainer("Binary::Write compressed", compSize, out.capacity());
+            }
             if (compSize == 0)
                 return false;
             bw->WriteUInt32(size);
@@ -160,11 +160,18 @@ namespace diannex
         return size;
     }
 
+    uint32_t BinaryMemoryWriter::GetCapacity()
+    {
+        return realBufferSize;
+    }
+
     int BinaryMemoryWriter::Write(const void* ptr, size_t size)
     {
         if (this->size + size > realBufferSize)
         {
-            realBufferSize += 1024 * 32;
+            // Writes can be larger than a block, when copying in another buffer
+            while (this->size + size > realBufferSize)
+                realBufferSize += 1024 * 32;
             buf.resize(realBufferSize);
         }
 
@@ -1,39 +1,38 @@
 #include "Bytecode.h"
 
-#include <sstream>
 #include <cmath>
 
 namespace diannex
 {
-    static std::string expandSymbol(CompileContext* ctx, int offsetSize = 0)
+    static void pushSymbol(CompileContext* ctx, std::string_view name)
     {
-        std::stringstream ss(std::ios_base::app | std::ios_base::out);
-        int size = ctx->symbolStack.size() - offsetSize;
-        for (int i = 0; i < size; i++)
-        {
-            ss << ctx->symbolStack.at(i);
-            if (i + 1 != size)
-                ss << '.';
-        }
-        return ss.str();
+        Symbol parent = ctx->symbolStack.empty() ? Symbols::None : ctx->symbolStack.back();
+        ctx->symbolStack.push_back(Symbols::Child(parent, Symbols::Intern(name)));
+    }
+
+    static std::string expandSymbol(CompileContext* ctx)
+    {
+        if (ctx->symbolStack.empty())
+            return "";
+        return std::string(Symbols::Name(ctx->symbolStack.back()));
     }
 
-    static int translationInfo(CompileContext* ctx, std::string text, StringData* stringData, bool isComment = false)
+    static int translationInfo(CompileContext* ctx, std::string_view text, const std::optional<StringData>& stringData, bool isComment = false)
     {
         int res = ctx->translationStringIndex;
         if (ctx->project->options.translationPrivate && !ctx->project->options.translationPrivateOutDir.empty())
         {
             if (!isComment)
             {
-                ctx->translationInfo.push_back({ expandSymbol(ctx), false, text, stringData ? stringData->localizedStringId : -1});
+                ctx->translationInfo.push_back({ expandSymbol(ctx), false, std::string(text), stringData ? stringData->localizedStringId : -1});
                 ctx->translationStringIndex++;
             } 
             else
-                ctx->translationInfo.push_back({ expandSymbol(ctx), true, text, -1 });
+                ctx->translationInfo.push_back({ expandSymbol(ctx), true, std::string(text), -1 });
         }
         else if (!isComment)
         {
-            ctx->translationInfo.push_back({ "", false, text, stringData ? stringData->localizedStringId : -1 });
+            ctx->translationInfo.push_back({ "", false, std::string(text), stringData ? stringData->localizedStringId : -1 });
             ctx->translationStringIndex++;
         }
 
@@ -148,13 +147,13 @@ namespace diannex
         }
     }
 
-    static void patchCall(int32_t count, std::string str, CompileContext* ctx, BytecodeResult* res)
+    static void patchCall(int32_t count, std::string_view str, CompileContext* ctx, BytecodeResult* res)
     {
         uint16_t size = ctx->symbolStack.size();
-        std::vector<std::string>* vec = new std::vector<std::string>();
-        vec->push_back(str);
+        std::vector<Symbol>* vec = new std::vector<Symbol>();
+        vec->push_back(Symbols::Intern(str));
         for (int i = 0; i < size - 1; i++)
-            vec->push_back(expandSymbol(ctx, (size - 1) - i));
+            vec->push_back(ctx->symbolStack.at(i));
         ctx->bytecode.push_back(Instruction::make_patch_call(&ctx->offset, count, vec));
     }
 
@@ -165,8 +164,105 @@ namespace diannex
         return res;
     }
 
+    static std::vector<int> rebaseIndices(const std::vector<int>& indices, int base)
+    {
+        std::vector<int> res;
+        res.reserve(indices.size());
+        for (int index : indices)
+            res.push_back(index == -1 ? -1 : index + base);
+        return res;
+    }
+
+    void Bytecode::Merge(CompileContext* shard, CompileContext* ctx, BytecodeResult* res)
+    {
+        int baseIndex = ctx->bytecode.size();
+        int baseOffset = ctx->offset;
+        int baseTranslation = ctx->translationStringIndex;
+
+        // Renumber internal strings; adding them in order of first use gives the same table as generating directly into ctx
+        std::vector<int> strings;
+        strings.reserve(shard->internalStrings.size());
+        for (const std::string& str : shard->internalStrings)
+            strings.push_back(ctx->string(str));
+
+        // Relocate instructions, leaving the shard untouched so it can be merged again later
+        for (const Instruction& shardInstr : shard->bytecode)
+        {
+            Instruction instr = shardInstr;
+            instr.offset += baseOffset;
+            switch (instr.opcode)
+            {
+            case Instruction::Opcode::pushbs:
+            case Instruction::Opcode::pushbints:
+            case Instruction::Opcode::setvarglb:
+            case Instruction::Opcode::pushvarglb:
+                instr.arg = strings.at(instr.arg);
+                break;
+            case Instruction::Opcode::pushs:
+            case Instruction::Opcode::pushints:
+                instr.arg += baseTranslation;
+                break;
+            case Instruction::Opcode::PATCH_CALL:
+                instr.vec = new std::vector<Symbol>(*shardInstr.vec);
+                break;
+            default:
+                break;
+            }
+            ctx->bytecode.push_back(instr);
+        }
+        ctx->offset += shard->offset;
+
+        ctx->translationInfo.insert(ctx->translationInfo.end(), shard->translationInfo.begin(), shard->translationInfo.end());
+        ctx->translationStringIndex += shard->translationStringIndex;
+
+        // Add symbols in their original order, now checking for duplicates in other files
+        int insertedErrors = 0;
+        for (const DefinedSymbol& symbol : shard->definedSymbols)
+        {
+            bool inserted = true;
+            BytecodeError::ErrorType errorType;
+            switch (symbol.type)
+            {
+            case DefinedSymbol::SymbolType::Scene:
+                inserted = ctx->sceneBytecode.insert(std::make_pair(symbol.name, rebaseIndices(shard->sceneBytecode.at(symbol.name), baseIndex))).second;
+                errorType = BytecodeError::ErrorType::SceneAlreadyExists;
+                break;
+            case DefinedSymbol::SymbolType::Function:
+                inserted = ctx->functionBytecode.insert(std::make_pair(symbol.name, rebaseIndices(shard->functionBytecode.at(symbol.name), baseIndex))).second;
+                errorType = BytecodeError::ErrorType::FunctionAlreadyExists;
+                break;
+            case DefinedSymbol::SymbolType::Definition:
+            {
+                auto p = shard->definitionBytecode.at(symbol.name);
+                if (std::holds_alternative<int>(p.first))
+                    p.first = std::get<int>(p.first) + baseTranslation;
+                if (p.second != -1)
+                    p.second += baseIndex;
+                inserted = ctx->definitionBytecode.insert(std::make_pair(symbol.name, p)).second;
+                errorType = BytecodeError::ErrorType::DefinitionAlreadyExists;
+                break;
+            }
+            }
+
+            if (!inserted)
+            {
+                res->errors.insert(res->errors.begin() + symbol.errorIndex + insertedErrors, { errorType, symbol.line, symbol.column, std::string(Symbols::Name(symbol.name)) });
+                insertedErrors++;
+            }
+        }
+
+        // New string IDs continue on from the ones already assigned
+        for (auto it = shard->stringIdPositions.begin(); it != shard->stringIdPositions.end(); ++it)
+        {
+            auto& vec = ctx->stringIdPositions[it->first];
+            for (auto& pair : it->second)
+                vec.push_back(std::make_pair(pair.first, pair.second + ctx->maxStringId + 1));
+        }
+        ctx->maxStringId += shard->maxStringId + 1;
+    }
+
     template<typename T>
-    static void generateFlagExpressions(T* node, const std::string& symbol, std::vector<int>& bytecodeIndices, CompileContext* ctx, BytecodeResult* res)
+    static void generateFlagExpressions(T* node, Symbol symbol, std::vector<int>& bytecodeIndices, CompileContext* ctx, BytecodeResult* res)
     {
         for (auto it = node->flags.begin(); it != node->flags.end(); ++it)
         {
@@ -184,7 +280,7 @@ namespace diannex
             }
             else
             {
-                ctx->bytecode.push_back(Instruction::make_int(&ctx->offset, Instruction::Opcode::pushbs, ctx->string(symbol + "_" + flag->content)));
+                ctx->bytecode.push_back(Instruction::make_int(&ctx->offset, Instruction::Opcode::pushbs, ctx->string(std::string(Symbols::Name(symbol)).append("_").append(flag->content))));
                 ctx->bytecode.emplace_back(&ctx->offset, Instruction::Opcode::exit);
             }
         }
@@ -197,20 +293,21 @@ namespace diannex
             switch (n->type)
             {
             case Node::NodeType::MarkedComment:
-                translationInfo(ctx, ((NodeContent*)n)->content, nullptr, true);
+                translationInfo(ctx, ((NodeContent*)n)->content, std::nullopt, true);
                 break;
             case Node::NodeType::Namespace:
-                ctx->symbolStack.push_back(((NodeContent*)n)->content);
+                pushSymbol(ctx, ((NodeContent*)n)->content);
                 GenerateBlock(n, ctx, res);
                 ctx->symbolStack.pop_back();
                 break;
             case Node::NodeType::Scene:
             {
                 NodeScene* ns = ((NodeScene*)n);
-                ctx->symbolStack.push_back(ns->content);
-                const std::string& symbol = expandSymbol(ctx);
+                pushSymbol(ctx, ns->content);
+                Symbol symbol = ctx->symbolStack.back();
+                size_t errorIndex = res->errors.size();
                 if (ctx->sceneBytecode.count(symbol))
-                    res->errors.push_back({ BytecodeError::ErrorType::SceneAlreadyExists, ns->token.line, ns->token.column, std::string(symbol) });
+                    res->errors.push_back({ BytecodeError::ErrorType::SceneAlreadyExists, ctx->tokenLine(ns->token), ctx->tokenColumn(ns->token), std::string(Symbols::Name(symbol)) });
                
                 int pos = ctx->bytecode.size();
                 ctx->generatingFunction = false;
@@ -219,7 +316,7 @@ namespace diannex
                 pushLocalContext(ctx);
                 ctx->localCountStack.back() = ns->flags.size();
                 for (auto it = ns->flags.begin(); it != ns->flags.end(); ++it)
-                    ctx->localStack.push_back((*it)->content);
+                    ctx->localStack.emplace_back((*it)->content);
 
                 GenerateSceneBlock(n, ctx, res);
 
@@ -237,7 +334,8 @@ namespace diannex
                 // Also deal with flag expressions here
                 generateFlagExpressions(ns, symbol, bytecodeIndices, ctx, res);
 
-                ctx->sceneBytecode.insert(std::make_pair(symbol, bytecodeIndices));
+                if (ctx->sceneBytecode.insert(std::make_pair(symbol, bytecodeIndices)).second)
+                    ctx->definedSymbols.push_back({ DefinedSymbol::SymbolType::Scene, symbol, ctx->tokenLine(ns->token), ctx->tokenColumn(ns->token), errorIndex });
 
                 ctx->symbolStack.pop_back();
                 break;
@@ -245,10 +343,11 @@ namespace diannex
             case Node::NodeType::Function:
             {
                 NodeFunc* func = ((NodeFunc*)n);
-                ctx->symbolStack.push_back(func->name);
-                const std::string& symbol = expandSymbol(ctx);
+                pushSymbol(ctx, func->name);
+                Symbol symbol = ctx->symbolStack.back();
+                size_t errorIndex = res->errors.size();
                 if (ctx->functionBytecode.count(symbol))
-                    res->errors.push_back({ BytecodeError::ErrorType::FunctionAlreadyExists, func->token.line, func->token.column, std::string(symbol) });
+                    res->errors.push_back({ BytecodeError::ErrorType::FunctionAlreadyExists, ctx->tokenLine(func->token), ctx->tokenColumn(func->token), std::string(Symbols::Name(symbol)) });
                 int pos = ctx->bytecode.size();
                 ctx->generatingFunction = true;
 
@@ -256,9 +355,9 @@ namespace diannex
                 pushLocalContext(ctx);
                 ctx->localCountStack.back() = func->flags.size() + func->args.size();
                 for (auto it = func->flags.begin(); it != func->flags.end(); ++it)
-                    ctx->localStack.push_back((*it)->content);
+                    ctx->localStack.emplace_back((*it)->content);
                 for (auto it = func->args.begin(); it != func->args.end(); ++it)
-                    ctx->localStack.push_back(it->content);
+                    ctx->localStack.emplace_back(*it);
 
                 GenerateSceneBlock(n, ctx, res);
 
@@ -276,7 +375,8 @@ namespace diannex
                 // Also deal with flag expressions here
                 generateFlagExpressions(func, symbol, bytecodeIndices, ctx, res);
 
-                ctx->functionBytecode.insert(std::make_pair(symbol, bytecodeIndices));
+                if (ctx->functionBytecode.insert(std::make_pair(symbol, bytecodeIndices)).second)
+                    ctx->definedSymbols.push_back({ DefinedSymbol::SymbolType::Function, symbol, ctx->tokenLine(func->token), ctx->tokenColumn(func->token), errorIndex });
 
                 ctx->symbolStack.pop_back();
                 break;
@@ -284,15 +384,15 @@ namespace diannex
             case Node::NodeType::Definitions:
             {
                 NodeContent* nc = ((NodeContent*)n);
-                ctx->symbolStack.push_back(nc->content);
-                const std::string& symbol = expandSymbol(ctx);
+                pushSymbol(ctx, nc->content);
+                Symbol symbol = ctx->symbolStack.back();
 
                 // Iterate over all of the definitions, and generate proper info
                 for (Node* subNode : n->nodes)
                 {
                     if (subNode->type == Node::NodeType::MarkedComment)
                     {
-                        translationInfo(ctx, ((NodeContent*)subNode)->content, nullptr, true);
+                        translationInfo(ctx, ((NodeContent*)subNode)->content, std::nullopt, true);
                     }
                     else
                     {
@@ -308,17 +408,16 @@ namespace diannex
                         }
                         else
                             hasExpr = false;
-                        const std::string& name = symbol + '.' + def->key;
+                        Symbol name = Symbols::Child(symbol, Symbols::Intern(def->key));
+                        bool inserted;
                         if (def->excludeValueTranslation)
-                        {
-                            if (!ctx->definitionBytecode.insert(std::make_pair(name, std::make_pair(def->value, hasExpr ? pos : -1))).second)
-                                res->errors.push_back({ BytecodeError::ErrorType::DefinitionAlreadyExists, nc->token.line, nc->token.column, name });
-                        }
+                            inserted = ctx->definitionBytecode.insert(std::make_pair(name, std::make_pair(std::string(def->value), hasExpr ? pos : -1))).second;
                         else
-                        {
-                            if (!ctx->definitionBytecode.insert(std::make_pair(name, std::make_pair(translationInfo(ctx, def->value, def->stringData.get()), hasExpr ? pos : -1))).second)
-                                res->errors.push_back({ BytecodeError::ErrorType::DefinitionAlreadyExists, nc->token.line, nc->token.column, name });
-                        }
+                            inserted = ctx->definitionBytecode.insert(std::make_pair(name, std::make_pair(translationInfo(ctx, def->value, def->stringData), hasExpr ? pos : -1))).second;
+                        if (inserted)
+                            ctx->definedSymbols.push_back({ DefinedSymbol::SymbolType::Definition, name, ctx->tokenLine(nc->token), ctx->tokenColumn(nc->token), res->errors.size() });
+                        else
+                            res->errors.push_back({ BytecodeError::ErrorType::DefinitionAlreadyExists, ctx->tokenLine(nc->token), ctx->tokenColumn(nc->token), std::string(Symbols::Name(name)) });
                     }
                 }
 
@@ -443,9 +542,9 @@ namespace diannex
             {
                 ctx->localCountStack.back()++;
                 if (std::find(ctx->localStack.begin(), ctx->localStack.end(), var->content) != ctx->localStack.end())
-                    res->errors.push_back({ BytecodeError::ErrorType::LocalVariableAlreadyExists, assign->token.line, assign->token.column, std::string(var->content) });
+                    res->errors.push_back({ BytecodeError::ErrorType::LocalVariableAlreadyExists, ctx->tokenLine(assign->token), ctx->tokenColumn(assign->token), std::string(var->content) });
                 localId = ctx->localStack.size();
-                ctx->localStack.push_back(var->content);
+                ctx->localStack.emplace_back(var->content);
             }
             else
             {
@@ -536,24 +635,24 @@ namespace diannex
             case TokenType::ExcludeString:
             case TokenType::Identifier:
                 if (sc->nodes.size() == 1)
-                    ctx->bytecode.push_back(Instruction::make_int(&ctx->offset, Instruction::Opcode::pushbs, ctx->string(sc->token.content)));
+                    ctx->bytecode.push_back(Instruction::make_int(&ctx->offset, Instruction::Opcode::pushbs, ctx->string(sc->content)));
                 else
                 {
                     for (int i = sc->nodes.size() - 1; i > 0; i--)
                         GenerateExpression(sc->nodes.at(i), ctx, res);
-                    ctx->bytecode.push_back(Instruction::make_int2(&ctx->offset, Instruction::Opcode::pushbints, ctx->string(sc->token.content), sc->nodes.size()));
+                    ctx->bytecode.push_back(Instruction::make_int2(&ctx->offset, Instruction::Opcode::pushbints, ctx->string(sc->content), sc->nodes.size()));
                 }
                 break;
             case TokenType::MarkedString:
                 if (sc->nodes.size() == 1)
                 {
-                    ctx->bytecode.push_back(Instruction::make_int(&ctx->offset, Instruction::Opcode::pushs, translationInfo(ctx, sc->token.content, sc->token.stringData.get())));
+                    ctx->bytecode.push_back(Instruction::make_int(&ctx->offset, Instruction::Opcode::pushs, translationInfo(ctx, sc->content, sc->stringData)));
                 }
                 else
                 {
                     for (int i = sc->nodes.size() - 1; i > 0; i--)
                         GenerateExpression(sc->nodes.at(i), ctx, res);
-                    ctx->bytecode.push_back(Instruction::make_int2(&ctx->offset, Instruction::Opcode::pushints, translationInfo(ctx, sc->token.content, sc->token.stringData.get()), sc->nodes.size()));
+                    ctx->bytecode.push_back(Instruction::make_int2(&ctx->offset, Instruction::Opcode::pushints, translationInfo(ctx, sc->content, sc->stringData), sc->nodes.size()));
                 }
                 break;
             default:
@@ -593,13 +692,13 @@ namespace diannex
             {
                 if (tr->nodes.size() == 0)
                 {
-                    ctx->bytecode.push_back(Instruction::make_int(&ctx->offset, Instruction::Opcode::pushs, translationInfo(ctx, tr->content, tr->stringData.get())));
+                    ctx->bytecode.push_back(Instruction::make_int(&ctx->offset, Instruction::Opcode::pushs, translationInfo(ctx, tr->content, tr->stringData)));
                 }
                 else
                 {
                     for (auto it = tr->nodes.rbegin(); it != tr->nodes.rend(); ++it)
                         GenerateExpression(*it, ctx, res);
-                    ctx->bytecode.push_back(Instruction::make_int2(&ctx->offset, Instruction::Opcode::pushints, translationInfo(ctx, tr->content, tr->stringData.get()), tr->nodes.size()));
+                    ctx->bytecode.push_back(Instruction::make_int2(&ctx->offset, Instruction::Opcode::pushints, translationInfo(ctx, tr->content, tr->stringData), tr->nodes.size()));
                 }
             }
             if (statement->type == Node::NodeType::TextRun)
@@ -827,7 +926,7 @@ namespace diannex
                     if (!foundCase)
                     {
                         Token& t = ((NodeToken*)statement)->token;
-                        res->errors.push_back({ BytecodeError::ErrorType::StatementsBeforeSwitchCase, t.line, t.column });
+                        res->errors.push_back({ BytecodeError::ErrorType::StatementsBeforeSwitchCase, ctx->tokenLine(t), ctx->tokenColumn(t) });
                     }
                     break;
                 }
@@ -966,7 +1065,7 @@ namespace diannex
             if (ctx->loopStack.size() == 0)
             {
                 Token t = ((NodeToken*)statement)->token;
-                res->errors.push_back({ BytecodeError::ErrorType::ContinueOutsideOfLoop, t.line, t.column });
+                res->errors.push_back({ BytecodeError::ErrorType::ContinueOutsideOfLoop, ctx->tokenLine(t), ctx->tokenColumn(t) });
                 break;
             }
 
@@ -979,7 +1078,7 @@ namespace diannex
             if (ctx->loopStack.size() == 0)
             {
                 Token t = ((NodeToken*)statement)->token;
-                res->errors.push_back({ BytecodeError::ErrorType::BreakOutsideOfLoop, t.line, t.column });
+                res->errors.push_back({ BytecodeError::ErrorType::BreakOutsideOfLoop, ctx->tokenLine(t), ctx->tokenColumn(t) });
                 break;
             }
 
@@ -1184,7 +1283,7 @@ namespace diannex
             break;
         }
         case Node::NodeType::MarkedComment:
-            translationInfo(ctx, ((NodeContent*)statement)->content, nullptr, true);
+            translationInfo(ctx, ((NodeContent*)statement)->content, std::nullopt, true);
             break;
         default:
             break;
@@ -1322,92 +1421,35 @@ namespace diannex
             switch (constant->token.type)
             {
             case TokenType::Number:
-                if (constant->token.content.find('.') == std::string::npos)
-                {
-                    int converted = 0;
-                    try
-                    {
-                        converted = std::stoi(constant->token.content);
-                    }
-                    catch (const std::exception&)
-                    {
-                        // Use a double instead...
-                        try
-                        {
-                            ctx->bytecode.push_back(Instruction::make_double(&ctx->offset, Instruction::Opcode::pushd, std::stod(constant->token.content)));
-                        }
-                        catch (const std::exception&)
-                        {
-                            // Just use infinity as failsafe
-                            ctx->bytecode.push_back(Instruction::make_double(&ctx->offset, Instruction::Opcode::pushd, INFINITY));
-                        }
-                        break;
-                    }
-                    ctx->bytecode.push_back(Instruction::make_int(&ctx->offset, Instruction::Opcode::pushi, converted));
-                }
+                if (constant->number.integer && constant->number.value >= INT32_MIN && constant->number.value <= INT32_MAX)
+                    ctx->bytecode.push_back(Instruction::make_int(&ctx->offset, Instruction::Opcode::pushi, (int)constant->number.value));
                 else
-                {
-                    try
-                    {
-                        ctx->bytecode.push_back(Instruction::make_double(&ctx->offset, Instruction::Opcode::pushd, std::stod(constant->token.content)));
-                    }
-                    catch (const std::exception&)
-                    {
-                        // Just use infinity as failsafe
-                        ctx->bytecode.push_back(Instruction::make_double(&ctx->offset, Instruction::Opcode::pushd, INFINITY));
-                    }
-                }
+                    ctx->bytecode.push_back(Instruction::make_double(&ctx->offset, Instruction::Opcode::pushd, constant->number.value));
                 break;
             case TokenType::Percentage:
-                if (constant->token.content.find('.') == std::string::npos)
-                {
-                    int converted = 0;
-                    try
-                    {
-                        converted = std::stoi(constant->token.content);
-                    }
-                    catch (const std::exception&)
-                    {
-                        // Use a double instead...
-                        try
-                        {
-                            ctx->bytecode.push_back(Instruction::make_double(&ctx->offset, Instruction::Opcode::pushd, std::stod(constant->token.content) / 100.0));
-                        }
-                        catch (const std::exception&)
-                        {
-                            // Just use infinity as failsafe
-                            ctx->bytecode.push_back(Instruction::make_double(&ctx->offset, Instruction::Opcode::pushd, INFINITY));
-                        }
-                        break;
-                    }
-                    ctx->bytecode.push_back(Instruction::make_double(&ctx->offset, Instruction::Opcode::pushd, converted / 100.0));
-                }
-                else
-                {
-                    ctx->bytecode.push_back(Instruction::make_double(&ctx->offset, Instruction::Opcode::pushd, std::stod(constant->token.content) / 100.0));
-                }
+                ctx->bytecode.push_back(Instruction::make_double(&ctx->offset, Instruction::Opcode::pushd, constant->number.value / 100.0));
                 break;
             case TokenType::String: // todo: add default setting to project file?
             case TokenType::ExcludeString:
                 if (constant->nodes.size() == 0)
-                    ctx->bytecode.push_back(Instruction::make_int(&ctx->offset, Instruction::Opcode::pushbs, ctx->string(constant->token.content)));
+                    ctx->bytecode.push_back(Instruction::make_int(&ctx->offset, Instruction::Opcode::pushbs, ctx->string(constant->content)));
                 else
                 {
                     for (auto it = constant->nodes.rbegin(); it != constant->nodes.rend(); ++it)
                         GenerateExpression(*it, ctx, res);
-                    ctx->bytecode.push_back(Instruction::make_int2(&ctx->offset, Instruction::Opcode::pushbints, ctx->string(constant->token.content), constant->nodes.size()));
+                    ctx->bytecode.push_back(Instruction::make_int2(&ctx->offset, Instruction::Opcode::pushbints, ctx->string(constant->content), constant->nodes.size()));
                 }
                 break;
             case TokenType::MarkedString:
                 if (constant->nodes.size() == 0)
                 {
-                    ctx->bytecode.push_back(Instruction::make_int(&ctx->offset, Instruction::Opcode::pushs, translationInfo(ctx, constant->token.content, constant->token.stringData.get())));
+                    ctx->bytecode.push_back(Instruction::make_int(&ctx->offset, Instruction::Opcode::pushs, translationInfo(ctx, constant->content, constant->stringData)));
                 }
                 else
                 {
                     for (auto it = constant->nodes.rbegin(); it != constant->nodes.rend(); ++it)
                         GenerateExpression(*it, ctx, res);
-                    ctx->bytecode.push_back(Instruction::make_int2(&ctx->offset, Instruction::Opcode::pushints, translationInfo(ctx, constant->token.content, constant->token.stringData.get()), constant->nodes.size()));
+                    ctx->bytecode.push_back(Instruction::make_int2(&ctx->offset, Instruction::Opcode::pushints, translationInfo(ctx, constant->content, constant->stringData), constant->nodes.size()));
                 }
                 break;
             case TokenType::Undefined:
@@ -0,0 +1,291 @@
+#include "diannex.h"
+
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+#include "Compiler.h"
+#include "Utility.h"
+
+using namespace diannex;
+
+struct diannex_buffer
+{
+    std::string data;
+    bool failed = false; // the data couldn't be stored
+};
+
+struct diannex_compiler
+{
+    ThreadPool pool;
+    WarmFiles warmFiles;
+    SymbolTable symbols; // names used by the warm files
+    std::string projectKey; // project file contents and base directory the warm files were compiled with
+
+    diannex_compiler(unsigned int threads) : pool(threads) {}
+};
+
+struct diannex_result
+{
+    bool success = false;
+    std::string log;
+    std::vector<CompileOutput> outputs;
+    std::vector<Diagnostic> diagnostics;
+};
+
+namespace diannex
+{
+    // Forwards to the callbacks of a diannex_file_provider
+    class CallbackFileProvider : public FileProvider
+    {
+    public:
+        CallbackFileProvider(const diannex_file_provider& callbacks) : callbacks(callbacks) {}
+
+        virtual bool Read(const std::string& path, SourceBuffer& source, std::string& error)
+        {
+            diannex_buffer out;
+            if (!callbacks.read(callbacks.user, path.c_str(), &out))
+            {
+                error = "File could not be read.";
+                return false;
+            }
+            if (out.failed)
+            {
+                error = "Out of memory.";
+                return false;
+            }
+            source.Assign(std::move(out.data));
+            return true;
+        }
+
+        virtual std::string ResolveInclude(const std::string& from, const std::string& include)
+        {
+            diannex_buffer out;
+            if (callbacks.resolve_include == nullptr)
+                return FileProvider::ResolveInclude(from, include);
+            if (!callbacks.resolve_include(callbacks.user, from.c_str(), include.c_str(), &out) || out.failed)
+                return include; // reported when it fails to be read
+            return out.data;
+        }
+    private:
+        diannex_file_provider callbacks;
+    };
+
+    // Exceptions can't unwind into C callers, so each entry point returns a fallback value instead
+    template<typename T, typename F>
+    static T guard(T fallback, F f)
+    {
+        try
+        {
+            return f();
+        }
+        catch (...)
+        {
+            return fallback;
+        }
+    }
+}
+
+extern "C"
+{
+    void diannex_buffer_set(diannex_buffer* buffer, const char* data, size_t size)
+    {
+        try
+        {
+            buffer->data.assign(data, size);
+            buffer->failed = false;
+        }
+        catch (...)
+        {
+            buffer->failed = true;
+        }
+    }
+
+    diannex_compiler* diannex_compiler_create(unsigned int threads)
+    {
+        if (threads == 0)
+            threads = std::max(std::thread::hardware_concurrency(), 1u);
+        return guard<diannex_compiler*>(nullptr, [&]() { return new diannex_compiler(threads); });
+    }
+
+    void diannex_compiler_destroy(diannex_compiler* compiler)
+    {
+        try
+        {
+            Compiler::InvalidateAll(compiler->warmFiles);
+            delete compiler;
+        }
+        catch (...)
+        {
+        }
+    }
+
+    void diannex_compiler_invalidate(diannex_compiler* compiler, const char* path)
+    {
+        try
+        {
+            if (path == nullptr)
+                Compiler::InvalidateAll(compiler->warmFiles);
+            else
+                Compiler::Invalidate(compiler->warmFiles, path);
+        }
+        catch (...)
+        {
+            // Can't tell what was dropped, so make sure nothing stale is reused
+            Compiler::InvalidateAll(compiler->warmFiles);
+        }
+    }
+
+    diannex_result* diannex_compile(diannex_compiler* compiler, const char* project_json, const char* base_directory, const diannex_file_provider* files)
+    {
+        diannex_result* result = new (std::nothrow) diannex_result;
+        if (result == nullptr)
+            return nullptr;
+
+        try
+        {
+            ProjectFormat project;
+            std::string error;
+            if (!parse_project(project_json, "out", project, error))
+            {
+                result->log = "Failed to load project file: " + error + "\n";
+                result->diagnostics.push_back({ "", 0, 0, "Failed to parse project file: " + error });
+                return result;
+            }
+
+            // Anything compiled with other project settings can't be reused
+            std::string projectKey = std::string(project_json) + '\n' + base_directory;
+            if (projectKey != compiler->projectKey)
+            {
+                Compiler::InvalidateAll(compiler->warmFiles);
+                compiler->projectKey = projectKey;
+            }
+
+            std::unique_ptr<CallbackFileProvider> provider;
+            if (files != nullptr)
+                provider = std::make_unique<CallbackFileProvider>(*files);
+
+            std::stringstream log;
+            CompileSession session;
+            session.files = provider.get();
+            session.log = &log;
+            session.warmFiles = &compiler->warmFiles;
+            session.symbols = &compiler->symbols;
+            result->success = Compiler::Compile(project, base_directory, compiler->pool, session) == 0;
+            result->log = log.str();
+            result->outputs = std::move(session.outputs);
+            result->diagnostics = std::move(session.diagnostics);
+        }
+        catch (...)
+        {
+            // A compile cut short may have left the warm files half updated
+            Compiler::InvalidateAll(compiler->warmFiles);
+            compiler->projectKey.clear();
+            result->success = false;
+            result->outputs.clear();
+            result->diagnostics.clear();
+            result->log.clear();
+            guard(0, [&]()
+            {
+                std::string message = "Internal compiler error";
+                try
+                {
+                    throw;
+                }
+                catch (const std::exception& e)
+                {
+                    message = message + ": " + e.what();
+                }
+                catch (...)
+                {
+                }
+                result->log = message + "\n";
+                result->diagnostics.push_back({ "", 0, 0, message });
+                return 0;
+            });
+        }
+        return result;
+    }
+
+    int diannex_result_success(const diannex_result* result)
+    {
+        return result->success ? 1 : 0;
+    }
+
+    const char* diannex_result_log(const diannex_result* result)
+    {
+        return result->log.c_str();
+    }
+
+    size_t diannex_result_output_count(const diannex_result* result)
+    {
+        return result->outputs.size();
+    }
+
+    diannex_output_type diannex_result_output_type(const diannex_result* result, size_t index)
+    {
+        return guard(DIANNEX_OUTPUT_BINARY, [&]()
+        {
+            switch (result->outputs.at(index).type)
+            {
+            case CompileOutput::OutputType::PublicTranslation:
+                return DIANNEX_OUTPUT_PUBLIC_TRANSLATION;
+            case CompileOutput::OutputType::PrivateTranslation:
+                return DIANNEX_OUTPUT_PRIVATE_TRANSLATION;
+            case CompileOutput::OutputType::Source:
+                return DIANNEX_OUTPUT_SOURCE;
+            default:
+                return DIANNEX_OUTPUT_BINARY;
+            }
+        });
+    }
+
+    const char* diannex_result_output_path(const diannex_result* result, size_t index)
+    {
+        return guard<const char*>(nullptr, [&]() { return result->outputs.at(index).path.c_str(); });
+    }
+
+    const char* diannex_result_output_data(const diannex_result* result, size_t index, size_t* size)
+    {
+        if (size != nullptr)
+            *size = 0;
+        return guard<const char*>(nullptr, [&]()
+        {
+            const CompileOutput& output = result->outputs.at(index);
+            if (size != nullptr)
+                *size = output.data.size();
+            return output.data.data();
+        });
+    }
+
+    size_t diannex_result_diagnostic_count(const diannex_result* result)
+    {
+        return result->diagnostics.size();
+    }
+
+    const char* diannex_result_diagnostic_file(const diannex_result* result, size_t index)
+    {
+        return guard<const char*>(nullptr, [&]() { return result->diagnostics.at(index).file.c_str(); });
+    }
+
+    uint32_t diannex_result_diagnostic_line(const diannex_result* result, size_t index)
+    {
+        return guard<uint32_t>(0, [&]() { return result->diagnostics.at(index).line; });
+    }
+
+    uint32_t diannex_result_diagnostic_column(const diannex_result* result, size_t index)
+    {
+        return guard<uint32_t>(0, [&]() { return result->diagnostics.at(index).column; });
+    }
+
+    const char* diannex_result_diagnostic_message(const diannex_result* result, size_t index)
+    {
+        return guard<const char*>(nullptr, [&]() { return result->diagnostics.at(index).message.c_str(); });
+    }
+
+    void diannex_result_free(diannex_result* result)
+    {
+        delete result;
+    }
+}
@@ -0,0 +1,365 @@
+#include "Cache.h"
+
+#include "Binary.h"
+#include "BuildId.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace diannex
+{
+    // Reads back the little-endian data written by BinaryWriter, failing softly on truncated input
+    class CacheReader
+    {
+    public:
+        CacheReader(const std::vector<char>& data) : data(data) {}
+
+        bool ok = true;
+
+        uint8_t ReadUInt8()
+        {
+            if (!check(1))
+                return 0;
+            return (uint8_t)data[pos++];
+        }
+
+        uint32_t ReadUInt32()
+        {
+            return (uint32_t)readLE(4);
+        }
+
+        int32_t ReadInt32()
+        {
+            return (int32_t)readLE(4);
+        }
+
+        uint64_t ReadUInt64()
+        {
+            return readLE(8);
+        }
+
+        double ReadDouble()
+        {
+            uint64_t bits = readLE(8);
+            double res;
+            memcpy(&res, &bits, sizeof(res));
+            return res;
+        }
+
+        std::string ReadString()
+        {
+            uint32_t size = ReadUInt32();
+            if (!check(size))
+                return "";
+            std::string res(&data[pos], size);
+            pos += size;
+            return res;
+        }
+    private:
+        const std::vector<char>& data;
+        size_t pos = 0;
+
+        bool check(size_t size)
+        {
+            if (!ok || data.size() - pos < size)
+                ok = false;
+            return ok;
+        }
+
+        uint64_t readLE(int size)
+        {
+            if (!check(size))
+                return 0;
+            uint64_t res = 0;
+            for (int i = 0; i < size; i++)
+                res |= (uint64_t)(uint8_t)data[pos + i] << (i * 8);
+            pos += size;
+            return res;
+        }
+    };
+
+    static void writeString(BinaryWriter& bw, std::string_view str)
+    {
+        // Byte by byte, as BinaryWriter byte-swaps 2, 4 and 8 byte writes on big-endian hosts
+        bw.WriteUInt32(str.size());
+        for (char c : str)
+            bw.WriteUInt8(c);
+    }
+
+    static std::string entryPath(const std::string& dir, uint64_t key)
+    {
+        std::stringstream ss;
+        ss << std::setfill('0') << std::setw(16) << std::hex << key << ".dxc";
+        return (fs::path(dir) / ss.str()).string();
+    }
+
+    static void hash(uint64_t& h, const void* data, size_t size)
+    {
+        // FNV-1a
+        const uint8_t* bytes = (const uint8_t*)data;
+        for (size_t i = 0; i < size; i++)
+        {
+            h ^= bytes[i];
+            h *= 0x100000001b3ULL;
+        }
+    }
+
+    static void hash(uint64_t& h, std::string_view str)
+    {
+        uint64_t size = str.size();
+        hash(h, &size, sizeof(size));
+        hash(h, str.data(), str.size());
+    }
+
+    uint64_t Cache::Key(const std::string& file, std::string_view source, ProjectFormat* project)
+    {
+        uint64_t h = 0xcbf29ce484222325ULL;
+
+        uint32_t versions[] = { DIANNEX_CACHE_VERSION, DIANNEX_BINARY_VERSION };
+        hash(h, versions, sizeof(versions));
+        hash(h, DIANNEX_BUILD_ID);
+
+        hash(h, file);
+        hash(h, source);
+
+        // Macros are stored unordered, so sort them first
+        std::vector<std::pair<std::string, std::string>> macros(project->options.macros.begin(), project->options.macros.end());
+        std::sort(macros.begin(), macros.end());
+        for (auto& macro : macros)
+        {
+            hash(h, macro.first);
+            hash(h, macro.second);
+        }
+
+        uint8_t flags[] = {
+            project->options.interpolationEnabled,
+            project->options.translationPrivate && !project->options.translationPrivateOutDir.empty()
+        };
+        hash(h, flags, sizeof(flags));
+
+        return h;
+    }
+
+    bool Cache::Load(const std::string& dir, uint64_t key, CacheEntry& entry, ProjectFormat* project)
+    {
+        std::vector<char> data;
+        {
+            std::ifstream f(entryPath(dir, key), std::ios::in | std::ios::binary);
+            if (!f.is_open())
+                return false;
+            f.seekg(0, std::ios::end);
+            data.resize(f.tellg());
+            f.seekg(0, std::ios::beg);
+            f.read(data.data(), data.size());
+        }
+
+        CacheReader r(data);
+        if (r.ReadUInt8() != 'D' || r.ReadUInt8() != 'X' || r.ReadUInt8() != 'C' ||
+            r.ReadUInt8() != DIANNEX_CACHE_VERSION || r.ReadUInt64() != key)
+            return false;
+
+        CacheEntry res;
+        res.shard = new CompileContext();
+        res.shard->project = project;
+        CompileContext* shard = res.shard;
+
+        uint32_t count = r.ReadUInt32();
+        for (uint32_t i = 0; i < count && r.ok; i++)
+            res.includes.push_back(r.ReadString());
+        res.maxStringId = r.ReadInt32();
+
+        shard->offset = r.ReadInt32();
+        shard->translationStringIndex = r.ReadInt32();
+
+        count = r.ReadUInt32();
+        for (uint32_t i = 0; i < count && r.ok; i++)
+            shard->string(r.ReadString());
+
+        count = r.ReadUInt32();
+        for (uint32_t i = 0; i < count && r.ok; i++)
+        {
+            Instruction instr((Instruction::Opcode)r.ReadUInt8());
+            instr.offset = r.ReadInt32();
+            if (instr.opcode == Instruction::Opcode::PATCH_CALL)
+            {
+                instr.count = r.ReadInt32();
+                instr.vec = new std::vector<Symbol>();
+                uint32_t size = r.ReadUInt32();
+                for (uint32_t j = 0; j < size && r.ok; j++)
+                    instr.vec->push_back(Symbols::Intern(r.ReadString()));
+            }
+            else if (instr.opcode == Instruction::Opcode::pushd)
+                instr.argDouble = r.ReadDouble();
+            else
+            {
+                instr.arg = r.ReadInt32();
+                instr.arg2 = r.ReadInt32();
+            }
+            shard->bytecode.push_back(instr);
+        }
+
+        count = r.ReadUInt32();
+        for (uint32_t i = 0; i < count && r.ok; i++)
+        {
+            TranslationInfo info;
+            info.key = r.ReadString();
+            info.isComment = r.ReadUInt8();
+            info.text = r.ReadString();
+            info.localizationStringId = r.ReadInt32();
+            shard->translationInfo.push_back(info);
+        }
+
+        count = r.ReadUInt32();
+        for (uint32_t i = 0; i < count && r.ok; i++)
+        {
+            DefinedSymbol symbol;
+            symbol.type = (DefinedSymbol::SymbolType)r.ReadUInt8();
+            symbol.name = Symbols::Intern(r.ReadString());
+            symbol.line = r.ReadUInt32();
+            symbol.column = r.ReadUInt32();
+            symbol.errorIndex = 0;
+
+            if (symbol.type == DefinedSymbol::SymbolType::Definition)
+            {
+                std::pair<std::variant<int, std::string>, int> p;
+                if (r.ReadUInt8())
+                    p.first = r.ReadString();
+                else
+                    p.first = r.ReadInt32();
+                p.second = r.ReadInt32();
+                shard->definitionBytecode.insert(std::make_pair(symbol.name, p));
+            }
+            else
+            {
+                std::vector<int> indices;
+                uint32_t size = r.ReadUInt32();
+                for (uint32_t j = 0; j < size && r.ok; j++)
+                    indices.push_back(r.ReadInt32());
+                if (symbol.type == DefinedSymbol::SymbolType::Scene)
+                    shard->sceneBytecode.insert(std::make_pair(symbol.name, indices));
+                else
+                    shard->functionBytecode.insert(std::make_pair(symbol.name, indices));
+            }
+            shard->definedSymbols.push_back(symbol);
+        }
+
+        if (!r.ok)
+        {
+            delete shard;
+            return false;
+        }
+
+        entry = std::move(res);
+        return true;
+    }
+
+    void Cache::Store(const std::string& dir, uint64_t key, const CacheEntry& entry)
+    {
+        std::error_code ec;
+        fs::create_directories(dir, ec);
+
+        // Write to a temporary file first, so other processes never see a partial entry
+        const std::string path = entryPath(dir, key);
+        std::stringstream tempName;
+        tempName << path << '.' << std::this_thread::get_id() << ".tmp";
+        const std::string tempPath = tempName.str();
+        {
+            BinaryFileWriter bw(tempPath);
+            if (!bw.CanWrite())
+                return;
+
+            CompileContext* shard = entry.shard;
+
+            bw.WriteUInt8('D');
+            bw.WriteUInt8('X');
+            bw.WriteUInt8('C');
+            bw.WriteUInt8(DIANNEX_CACHE_VERSION);
+            bw.WriteUInt64(key);
+
+            bw.WriteUInt32(entry.includes.size());
+            for (const std::string& include : entry.includes)
+                writeString(bw, include);
+            bw.WriteInt32(entry.maxStringId);
+
+            bw.WriteInt32(shard->offset);
+            bw.WriteInt32(shard->translationStringIndex);
+
+            bw.WriteUInt32(shard->internalStrings.size());
+            for (const std::string& str : shard->internalStrings)
+                writeString(bw, str);
+
+            bw.WriteUInt32(shard->bytecode.size());
+            for (const Instruction& instr : shard->bytecode)
+            {
+                bw.WriteUInt8((uint8_t)instr.opcode);
+                bw.WriteInt32(instr.offset);
+                if (instr.opcode == Instruction::Opcode::PATCH_CALL)
+                {
+                    bw.WriteInt32(instr.count);
+                    bw.WriteUInt32(instr.vec->size());
+                    for (Symbol symbol : *instr.vec)
+                        writeString(bw, Symbols::Name(symbol));
+                }
+                else if (instr.opcode == Instruction::Opcode::pushd)
+                    bw.WriteDouble(instr.argDouble);
+                else
+                {
+                    bw.WriteInt32(instr.arg);
+                    bw.WriteInt32(instr.arg2);
+                }
+            }
+
+            bw.WriteUInt32(shard->translationInfo.size());
+            for (const TranslationInfo& info : shard->translationInfo)
+            {
+                writeString(bw, info.key);
+                bw.WriteUInt8(info.isComment);
+                writeString(bw, info.text);
+                bw.WriteInt32(info.localizationStringId);
+            }
+
+            bw.WriteUInt32(shard->definedSymbols.size());
+            for (const DefinedSymbol& symbol : shard->definedSymbols)
+            {
+                bw.WriteUInt8((uint8_t)symbol.type);
+                writeString(bw, Symbols::Name(symbol.name));
+                bw.WriteUInt32(symbol.line);
+                bw.WriteUInt32(symbol.column);
+
+                if (symbol.type == DefinedSymbol::SymbolType::Definition)
+                {
+                    auto& p = shard->definitionBytecode.at(symbol.name);
+                    if (std::holds_alternative<std::string>(p.first))
+                    {
+                        bw.WriteUInt8(1);
+                        writeString(bw, std::get<std::string>(p.first));
+                    }
+                    else
+                    {
+                        bw.WriteUInt8(0);
+                        bw.WriteInt32(std::get<int>(p.first));
+                    }
+                    bw.WriteInt32(p.second);
+                }
+                else
+                {
+                    auto& indices = (symbol.type == DefinedSymbol::SymbolType::Scene) ?
+                                    shard->sceneBytecode.at(symbol.name) : shard->functionBytecode.at(symbol.name);
+                    bw.WriteUInt32(indices.size());
+                    for (int index : indices)
+                        bw.WriteInt32(index);
+                }
+            }
+        }
+
+        fs::rename(tempPath, path, ec);
+        if (ec)
+            fs::remove(tempPath, ec);
+    }
+}
@@ -0,0 +1,788 @@
+#include "Compiler.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+
+#include <libs/rang.hpp>
+
+#include "Lexer.h"
+#include "Parser.h"
+#include "Bytecode.h"
+#include "Context.h"
+#include "Binary.h"
+#include "BinaryWriter.h"
+#include "Translation.h"
+#include "ParseResult.h"
+#include "Timings.h"
+#include "MemoryStats.h"
+#include "Trace.h"
+
+namespace fs = std::filesystem;
+
+namespace diannex
+{
+    int Compiler::Compile(ProjectFormat& project, const fs::path& baseDirectory, ThreadPool& pool, CompileSession& session)
+    {
+        // Compiler bugs (including ones hit on the worker threads) fail the compile rather than the whole program,
+        // which matters in --server mode and when embedded
+        try
+        {
+            return compile(project, baseDirectory, pool, session);
+        }
+        catch (const std::exception& e)
+        {
+            std::ostream& log = (session.log != nullptr) ? *session.log : std::cout;
+            log << std::endl << rang::fgB::red << "Internal compiler error: " << e.what() << rang::fg::reset << std::endl;
+            session.diagnostics.push_back({ "", 0, 0, std::string("Internal compiler error: ") + e.what() });
+
+            // A compile cut short may have left the warm files half updated
+            if (session.warmFiles != nullptr)
+                InvalidateAll(*session.warmFiles);
+            session.outputs.clear();
+            return 1;
+        }
+    }
+
+    int Compiler::compile(ProjectFormat& project, const fs::path& baseDirectory, ThreadPool& pool, CompileSession& session)
+    {
+        bool fatalError = false;
+        WarmFiles* warmFiles = session.warmFiles;
+
+        // Adding string IDs rewrites the sources, so a shard kept from before would insert its IDs again, at stale positions
+        if (warmFiles != nullptr && project.options.addStringIds)
+        {
+            InvalidateAll(*warmFiles);
+            warmFiles = nullptr;
+        }
+
+        // Names are interned into the session's table, which the warm files depend on.
+        // With nothing warm, none of its names are needed any more, so it starts over.
+        SymbolTable ownSymbols;
+        SymbolTable* symbols = (session.symbols != nullptr) ? session.symbols : &ownSymbols;
+        if (warmFiles == nullptr || warmFiles->empty() || symbols->Full())
+        {
+            if (warmFiles != nullptr)
+                InvalidateAll(*warmFiles);
+            symbols->Clear();
+        }
+        SymbolScope symbolScope(symbols);
+        std::ostream& log = (session.log != nullptr) ? *session.log : std::cout;
+        DiskFileProvider disk;
+        FileProvider* files = (session.files != nullptr) ? session.files : &disk;
+
+        log << "Beginning compilation process..." << std::endl;
+
+        auto start = std::chrono::high_resolution_clock::now();
+
+        // Files that haven't changed since the last compile are loaded from the cache instead.
+        // Not used when adding string IDs, as that needs to rewrite the source files.
+        std::string cacheDir;
+        if (!project.options.cacheDir.empty() && !project.options.addStringIds)
+            cacheDir = fs::absolute(baseDirectory / project.options.cacheDir).string();
+
+        CompileContext context;
+        context.project = &project;
+        for (auto& file : project.options.files)
+        {
+#if DIANNEX_OLD_INCLUDE_ORDER
+            context.queue.push((baseDirectory / file).string());
+#else
+            context.queue.push_back((baseDirectory / file).string());
+#endif
+        }
+
+        // Load all of the files in the queue and lex them into tokens
+        log << "Lexing..." << std::endl;
+
+        // Adds the time and allocations since the previous phase ended to the given phase, for --timings, --memory and --trace_out
+        Timings::Timer phaseTimer;
+        MemoryStats::Sampler phaseSampler;
+        double phaseTraceStart = (session.trace != nullptr) ? session.trace->Now() : 0;
+        auto traceEndPhase = [&](Timings::Phase phase)
+        {
+            if (session.trace == nullptr)
+                return;
+            double now = session.trace->Now();
+            session.trace->AddSpan("phase", Timings::PhaseName(phase), phaseTraceStart, now);
+            phaseTraceStart = now;
+        };
+        auto endPhase = [&](Timings::Phase phase)
+        {
+            if (session.timings != nullptr)
+                session.timings->AddPhase(phase, phaseTimer.Stop());
+            if (session.memory != nullptr)
+                session.memory->AddPhase(phase, phaseSampler.Stop());
+            traceEndPhase(phase);
+            phaseTimer = Timings::Timer();
+            phaseSampler = MemoryStats::Sampler();
+        };
+        struct LexedFile
+        {
+            bool failed = false;
+            std::string error;
+            TokenList tokens;
+            std::vector<std::string> includes;
+            int32_t maxStringId = -1;
+            uint64_t cacheKey = 0;
+            CompileContext* cached = nullptr; // generated bytecode, if loaded from the cache
+
+            // Only in streaming mode, where files are parsed and generated as soon as they're lexed
+            ParseResult* parsed = nullptr; // without its tree, which is freed after generating bytecode
+            int32_t parseMaxStringId = -1;
+            CompileContext* shard = nullptr; // null if the file failed to parse
+            BytecodeResult* bytecode = nullptr;
+        };
+        std::unordered_map<std::string, LexedFile> lexedFiles;
+
+        // Project macros are lexed once, then copied wherever they're used
+        MacroCache macroCache(&project);
+
+        // Frees shards loaded from the disk cache or generated early, if compilation stops before they get merged
+        auto releaseCached = [&]()
+        {
+            for (auto& pair : lexedFiles)
+            {
+                if (pair.second.cached != nullptr && (warmFiles == nullptr || !warmFiles->count(WarmKey(pair.first))))
+                    delete pair.second.cached;
+                delete pair.second.parsed;
+                delete pair.second.shard;
+                delete pair.second.bytecode;
+            }
+        };
+
+        // String interpolation re-lexes text, so each file is parsed with its own context as well
+        auto parseFile = [&](const std::string& file, TokenList* tokens, int32_t& maxStringId)
+        {
+            Timings::Timer fileTimer(true);
+            Trace::Span span(session.trace, "parse", file);
+            CompileContext fileContext;
+            fileContext.project = &project;
+            fileContext.currentFile = file;
+            fileContext.trace = session.trace;
+            fileContext.macroCache = &macroCache;
+            ParseResult* res = Parser::ParseTokens(&fileContext, tokens);
+            maxStringId = fileContext.maxStringId;
+            if (session.timings != nullptr)
+                session.timings->AddFile(file, Timings::Phase::Parse, fileTimer.Stop());
+            return res;
+        };
+
+        // Each file is generated into its own shard, with its own bytecode, strings, and translation info
+        auto generateFile = [&](const std::string& file, ParseResult* parsed, const LexedFile& lexed, const LineIndex& lines, int32_t parseMaxStringId, CompileContext*& shard)
+        {
+            Timings::Timer fileTimer(true);
+            Trace::Span span(session.trace, "codegen", file);
+            shard = new CompileContext();
+            shard->project = &project;
+            shard->currentFile = file;
+            shard->lines = &lines;
+            BytecodeResult* res = Bytecode::Generate(parsed, shard);
+            shard->lines = nullptr;
+            span.End();
+
+            // Only cache files that compiled cleanly on their own
+            if (!cacheDir.empty() && res->errors.empty())
+            {
+                CacheEntry entry;
+                entry.includes = lexed.includes;
+                entry.maxStringId = std::max(lexed.maxStringId, parseMaxStringId);
+                entry.shard = shard;
+                Trace::Span cacheSpan(session.trace, "cache", file);
+                Cache::Store(cacheDir, lexed.cacheKey, entry);
+            }
+
+            if (session.timings != nullptr)
+                session.timings->AddFile(file, Timings::Phase::Bytecode, fileTimer.Stop());
+            return res;
+        };
+        {
+            std::mutex lexMutex;
+
+            // Set once any file can't be read, which stops compilation before parsing,
+            // so streaming mode stops doing work that will only be thrown away
+            std::atomic<bool> readFailed(false);
+
+            // Files are lexed as soon as they're discovered, including through #include directives.
+            // Must be called with lexMutex held.
+            std::function<void(const std::string&)> scheduleLex = [&](const std::string& file)
+            {
+                if (!lexedFiles.emplace(file, LexedFile()).second)
+                    return; // Already lexing this file
+
+                pool.Submit([&, file]()
+                {
+                    SymbolScope symbolScope(symbols);
+                    Timings::Timer fileTimer(true);
+                    Trace::Span span(session.trace, "lex", file);
+                    LexedFile lexed;
+                    if (warmFiles != nullptr)
+                    {
+                        // Unchanged since the last rebuild, so there's no need to even read it
+                        auto warm = warmFiles->find(WarmKey(file));
+                        if (warm != warmFiles->end())
+                        {
+                            lexed.cached = warm->second.shard;
+                            lexed.includes = warm->second.includes;
+                            lexed.maxStringId = warm->second.maxStringId;
+                        }
+                    }
+
+                    // Lexed straight from the file mapping, which is released once the file is tokenized
+                    SourceBuffer source;
+                    if (lexed.cached == nullptr && !files->Read(file, source, lexed.error))
+                    {
+                        lexed.failed = true;
+                        readFailed = true;
+                    }
+
+                    if (!lexed.failed && lexed.cached == nullptr && !cacheDir.empty())
+                    {
+                        lexed.cacheKey = Cache::Key(file, source.View(), &project);
+                        CacheEntry entry;
+                        if (Cache::Load(cacheDir, lexed.cacheKey, entry, &project))
+                        {
+                            entry.shard->currentFile = file;
+                            lexed.cached = entry.shard;
+                            lexed.includes = std::move(entry.includes);
+                            lexed.maxStringId = entry.maxStringId;
+                        }
+                    }
+
+                    if (!lexed.failed && lexed.cached == nullptr)
+                    {
+                        // Each file gets its own context, so includes and string IDs can be collected separately
+                        CompileContext fileContext;
+                        fileContext.project = &project;
+                        fileContext.currentFile = file;
+                        fileContext.fileProvider = files;
+                        fileContext.trace = session.trace;
+                        fileContext.macroCache = &macroCache;
+                        Lexer::LexString(source.View(), &fileContext, lexed.tokens);
+
+                        while (!fileContext.queue.empty())
+                        {
+                            lexed.includes.push_back(fileContext.queue.front());
+#if DIANNEX_OLD_INCLUDE_ORDER
+                            fileContext.queue.pop();
+#else
+                            fileContext.queue.pop_front();
+#endif
+                        }
+                        lexed.maxStringId = fileContext.maxStringId;
+                    }
+
+                    if (session.timings != nullptr)
+                        session.timings->AddFile(file, Timings::Phase::Lex, fileTimer.Stop());
+                    span.End();
+                    source.Release();
+
+                    {
+                        std::lock_guard<std::mutex> lock(lexMutex);
+                        for (auto& include : lexed.includes)
+                            scheduleLex(include);
+                    }
+
+                    if (session.streaming && !readFailed && !lexed.failed && lexed.cached == nullptr)
+                    {
+                        // Carry on with this file right away, so its tokens and tree can be freed as soon as they've been used
+                        lexed.parsed = parseFile(file, &lexed.tokens, lexed.parseMaxStringId);
+                        lexed.tokens.Clear();
+                        if (lexed.parsed->errors.empty())
+                            lexed.bytecode = generateFile(file, lexed.parsed, lexed, lexed.tokens.lines, lexed.parseMaxStringId, lexed.shard);
+                        lexed.tokens.lines.Clear();
+                        lexed.parsed->arena.Clear();
+                        lexed.parsed->baseNode = nullptr;
+                    }
+
+                    std::lock_guard<std::mutex> lock(lexMutex);
+                    lexedFiles[file] = std::move(lexed);
+                });
+            };
+
+            {
+                std::lock_guard<std::mutex> lock(lexMutex);
+                for (auto& file : project.options.files)
+                    scheduleLex((baseDirectory / file).string());
+            }
+            pool.Wait();
+
+            for (auto& pair : lexedFiles)
+                session.sourceFiles.push_back(pair.first);
+
+            // Replay the include queue with the results, so the final order doesn't depend on thread timing
+            while (!context.queue.empty())
+            {
+                std::string file = context.queue.front();
+#if DIANNEX_OLD_INCLUDE_ORDER
+                context.queue.pop();
+#else
+                context.queue.pop_front();
+#endif
+                LexedFile& lexed = lexedFiles.at(file);
+                if (lexed.failed)
+                {
+                    log << rang::fg::red << "Failed to read file '" << file << "': " << lexed.error << rang::fg::reset << std::endl;
+                    session.diagnostics.push_back({ file, 0, 0, "Failed to read file: " + lexed.error });
+                    fatalError = true;
+                    continue;
+                }
+                if (context.files.find(file) != context.files.end())
+                    continue; // Already tokenized this file
+
+#if DIANNEX_OLD_INCLUDE_ORDER
+                for (auto& include : lexed.includes)
+                    context.queue.push(include);
+#else
+                // Add includes to beginning of list, in reverse order
+                for (auto it = lexed.includes.rbegin(); it != lexed.includes.rend(); ++it)
+                    context.queue.push_front(*it);
+#endif
+                if (lexed.maxStringId > context.maxStringId)
+                    context.maxStringId = lexed.maxStringId;
+
+                context.currentFile = file;
+                context.tokenList.push_back(std::make_pair(file, std::move(lexed.tokens)));
+                context.files.insert(file);
+            }
+        }
+        endPhase(Timings::Phase::Lex);
+
+        if (fatalError)
+        {
+            log << std::endl << rang::fgB::red << "Not proceeding with compilation due to fatal errors." << rang::fg::reset << std::endl;
+            releaseCached();
+            return 1;
+        }
+
+        // Parse each token stream
+        log << "Parsing..." << std::endl;
+        std::vector<ParseResult*> parseResults(context.tokenList.size());
+        std::vector<int32_t> parseMaxStringIds(context.tokenList.size(), -1);
+        for (size_t i = 0; i < context.tokenList.size(); i++)
+        {
+            LexedFile& lexed = lexedFiles.at(context.tokenList[i].first);
+            if (lexed.cached != nullptr)
+                continue;
+            if (lexed.parsed != nullptr)
+            {
+                // Already parsed in streaming mode
+                parseResults[i] = lexed.parsed;
+                parseMaxStringIds[i] = lexed.parseMaxStringId;
+                lexed.parsed = nullptr;
+                continue;
+            }
+            pool.Submit([&, i]()
+            {
+                SymbolScope symbolScope(symbols);
+                auto& pair = context.tokenList[i];
+                parseResults[i] = parseFile(pair.first, &pair.second, parseMaxStringIds[i]);
+            });
+        }
+        pool.Wait();
+
+        // Report results in file order
+        for (size_t i = 0; i < context.tokenList.size(); i++)
+        {
+            auto& pair = context.tokenList[i];
+            ParseResult* parsed = parseResults[i];
+            if (parseMaxStringIds[i] > context.maxStringId)
+                context.maxStringId = parseMaxStringIds[i];
+            if (parsed == nullptr)
+            {
+                // Loaded from the cache; nothing to parse
+                context.parseList.push_back(std::make_pair(pair.first, parsed));
+            }
+            else if (parsed->errors.size() != 0)
+            {
+                if (!fatalError)
+                {
+                    log << rang::fgB::red << std::endl << "Encountered errors while parsing:" << rang::fg::reset << std::endl;
+                    fatalError = true;
+                }
+
+                log << rang::fg::red;
+
+                for (ParseError& e : parsed->errors)
+                {
+                    if (e.line == 0 && e.column == 0)
+                        log << "[" << pair.first << ":?:?] ";
+                    else
+                        log << "[" << pair.first << ":" << e.line << ":" << e.column << "] ";
+                    std::stringstream message;
+                    switch (e.type)
+                    {
+                    case ParseError::ErrorType::ExpectedTokenButGot:
+                        message << "Expected token " << e.info1 << " but got " << e.info2 << ".";
+                        break;
+                    case ParseError::ErrorType::ExpectedTokenButEOF:
+                        message << "Expected token " << e.info1 << " but reached end of code.";
+                        break;
+                    case ParseError::ErrorType::UnexpectedToken:
+                        message << "Unexpected token " << e.info1 << ".";
+                        break;
+                    case ParseError::ErrorType::UnexpectedModifierFor:
+                        message << "Unexpected modifier for " << e.info1 << ".";
+                        break;
+                    case ParseError::ErrorType::UnexpectedMarkedString:
+                        message << "Unexpected MarkedString token.";
+                        break;
+                    case ParseError::ErrorType::UnexpectedEOF:
+                        message << "Unexpected end of code.";
+                        break;
+                    case ParseError::ErrorType::UnexpectedSwitchCase:
+                        message << "Unexpected switch 'case' keyword.";
+                        break;
+                    case ParseError::ErrorType::UnexpectedSwitchDefault:
+                        message << "Unexpected switch 'default' keyword.";
+                        break;
+                    case ParseError::ErrorType::ChooseWithoutStatement:
+                        message << "Choose statement without any sub-statements.";
+                        break;
+                    case ParseError::ErrorType::ChoiceWithoutStatement:
+                        message << "Choice statement without any sub-statements.";
+                        break;
+                    case ParseError::ErrorType::DuplicateFlagName:
+                        message << "Duplicate flag names.";
+                        break;
+                    case ParseError::ErrorType::ErrorToken:
+                        message << e.info1;
+                        break;
+                    }
+                    log << message.str() << std::endl;
+                    session.diagnostics.push_back({ pair.first, e.line, e.column, message.str() });
+                }
+
+                log << rang::fg::reset;
+                delete parsed;
+            }
+            else
+            {
+                context.parseList.push_back(std::make_pair(pair.first, parsed));
+            }
+        }
+        endPhase(Timings::Phase::Parse);
+
+        if (fatalError)
+        {
+            log << std::endl << rang::fgB::red << "Not proceeding with compilation due to fatal errors." << rang::fg::reset << std::endl;
+            releaseCached();
+            return 1;
+        }
+
+        // Generate bytecode
+        log << "Generating bytecode..." << std::endl;
+        std::vector<CompileContext*> shards(context.parseList.size());
+        std::vector<BytecodeResult*> bytecodeResults(context.parseList.size());
+        for (size_t i = 0; i < context.parseList.size(); i++)
+        {
+            LexedFile* lexed = &lexedFiles.at(context.parseList[i].first);
+            if (lexed->cached != nullptr)
+            {
+                shards[i] = lexed->cached;
+                bytecodeResults[i] = new BytecodeResult;
+                continue;
+            }
+            if (lexed->shard != nullptr)
+            {
+                // Already generated in streaming mode
+                shards[i] = lexed->shard;
+                bytecodeResults[i] = lexed->bytecode;
+                lexed->shard = nullptr;
+                lexed->bytecode = nullptr;
+                continue;
+            }
+            pool.Submit([&, i, lexed]()
+            {
+                SymbolScope symbolScope(symbols);
+                auto& pair = context.parseList[i];
+                bytecodeResults[i] = generateFile(pair.first, pair.second, *lexed, context.tokenList[i].second.lines, parseMaxStringIds[i], shards[i]);
+            });
+        }
+        pool.Wait();
+
+        // Names that didn't fit in the symbol table all share one ID, so none of the generated code can be used
+        if (symbols->Full())
+        {
+            endPhase(Timings::Phase::Bytecode);
+            log << std::endl << rang::fgB::red << "Too many symbols; not proceeding with compilation." << rang::fg::reset << std::endl;
+            session.diagnostics.push_back({ "", 0, 0, "Too many symbols." });
+            for (size_t i = 0; i < context.parseList.size(); i++)
+            {
+                if (shards[i] != lexedFiles.at(context.parseList[i].first).cached)
+                    delete shards[i];
+                delete bytecodeResults[i];
+            }
+            releaseCached();
+            if (warmFiles != nullptr)
+                InvalidateAll(*warmFiles);
+            symbols->Clear();
+            return 1;
+        }
+
+        // Link the shards together in file order
+        WarmFiles retained;
+        for (size_t i = 0; i < context.parseList.size(); i++)
+        {
+            auto& pair = context.parseList[i];
+            context.currentFile = pair.first;
+
+            // Initialize string ID map for this file, if necessary
+            if (context.project->options.addStringIds)
+                context.stringIdPositions.insert(std::pair<std::string, std::vector<std::pair<uint32_t, int32_t>>>(context.currentFile, std::vector<std::pair<uint32_t, int32_t>>()));
+
+            BytecodeResult* bytecode = bytecodeResults[i];
+            bool compiledCleanly = bytecode->errors.empty();
+            Bytecode::Merge(shards[i], &context, bytecode);
+            if (warmFiles != nullptr && compiledCleanly)
+            {
+                LexedFile& lexed = lexedFiles.at(pair.first);
+                retained[WarmKey(pair.first)] = { lexed.includes, std::max(lexed.maxStringId, parseMaxStringIds[i]), shards[i] };
+            }
+            else
+                delete shards[i];
+
+            if (bytecode->errors.size() != 0)
+            {
+                if (!fatalError)
+                {
+                    log << rang::fgB::red << std::endl << "Encountered errors while generating bytecode:" << rang::fg::reset << std::endl;
+                    fatalError = true;
+                }
+
+                log << rang::fg::red;
+
+                for (BytecodeError& e : bytecode->errors)
+                {
+                    if (e.line == 0 && e.column == 0)
+                        log << "[" << pair.first << ":?:?] ";
+                    else
+                        log << "[" << pair.first << ":" << e.line << ":" << e.column << "] ";
+
+                    std::stringstream message;
+                    switch (e.type)
+                    {
+                    case BytecodeError::ErrorType::SceneAlreadyExists:
+                        message << "Duplicate scene name '" << e.info1 << "'.";
+                        break;
+                    case BytecodeError::ErrorType::FunctionAlreadyExists:
+                        message << "Duplicate function name '" << e.info1 << "'.";
+                        break;
+                    case BytecodeError::ErrorType::DefinitionAlreadyExists:
+                        message << "Duplicate definition name '" << e.info1 << "'.";
+                        break;
+                    case BytecodeError::ErrorType::LocalVariableAlreadyExists:
+                        message << "Local variable '" << e.info1 << "' already defined.";
+                        break;
+                    case BytecodeError::ErrorType::ContinueOutsideOfLoop:
+                        message << "Continue statement outside of a loop.";
+                        break;
+                    case BytecodeError::ErrorType::BreakOutsideOfLoop:
+                        message << "Break statement outside of a loop or switch statement.";
+                        break;
+                    case BytecodeError::ErrorType::StatementsBeforeSwitchCase:
+                        message << "Statements present before any cases in switch statement.";
+                        break;
+                    case BytecodeError::ErrorType::UnexpectedError:
+                        message << "Unexpected error. May be invalid syntax.";
+                        break;
+                    }
+                    log << message.str() << std::endl;
+                    session.diagnostics.push_back({ pair.first, e.line, e.column, message.str() });
+                }
+            }
+        }
+
+        if (warmFiles != nullptr)
+        {
+            // Drop files that are no longer part of the project
+            for (auto& pair : *warmFiles)
+            {
+                if (!retained.count(pair.first))
+                    delete pair.second.shard;
+            }
+            *warmFiles = std::move(retained);
+        }
+        endPhase(Timings::Phase::Bytecode);
+
+        // Binary::Write resolves calls in place, so measure while everything is still as generated
+        if (session.memory != nullptr && !fatalError)
+            session.memory->MeasureContext(&context);
+
+        if (fatalError)
+        {
+            log << std::endl << rang::fgB::red << "Not proceeding with compilation due to fatal errors." << rang::fg::reset << std::endl;
+            return 1;
+        }
+
+        if (context.project->options.addStringIds)
+        {
+            // Output string IDs to necessary files
+            log << "Writing string IDs..." << std::endl;
+
+            for (auto it = context.stringIdPositions.begin(); it != context.stringIdPositions.end(); ++it)
+            {
+                const std::string& currentFile = it->first;
+
+                // Read in the data from the file
+                SourceBuffer source;
+                std::string error;
+                if (!files->Read(currentFile, source, error))
+                {
+                    log << std::endl << rang::fgB::red << "Failed to read file '" << currentFile << "': " << error << rang::fg::reset << std::endl;
+                    return 1;
+                }
+                std::string fileData(source.View());
+
+                // Insert new IDs
+                int offset = 0;
+                std::stringstream ss(std::ios_base::app | std::ios_base::out);
+                for (const std::pair<int, int>& info : it->second)
+                {
+                    ss.str(std::string());
+                    ss.clear();
+                    ss << '&' << std::setfill('0') << std::setw(8) << std::hex << info.second;
+                    std::string ss_str = ss.str();
+                    fileData.insert(fileData.begin() + info.first + offset, ss_str.begin(), ss_str.begin() + 9);
+                    offset += 9;
+                }
+
+                session.outputs.push_back({ CompileOutput::OutputType::Source, currentFile, std::move(fileData) });
+            }
+            endPhase(Timings::Phase::StringIds);
+
+            return 0;
+        }
+
+        // Write binary
+        log << "Writing binary..." << std::endl;
+        const fs::path mainOutput = baseDirectory / project.options.binaryOutputDir;
+        const std::string binaryName = (project.options.binaryName.empty() ? project.name : project.options.binaryName);
+        const std::string fileName = binaryName + ".dxb";
+        {
+            BinaryMemoryWriter bw;
+            context.timings = session.timings;
+            context.memory = session.memory;
+            context.trace = session.trace;
+            if (!Binary::Write(&bw, &context))
+            {
+                log << std::endl << rang::fgB::red << "Failed to compress with zlib!" << rang::fg::reset << std::endl;
+                return 1;
+            }
+            session.outputs.push_back({ CompileOutput::OutputType::Binary, (mainOutput / fileName).lexically_normal().string(), std::string(bw.GetBuffer(), bw.GetSize()) });
+        }
+        if (session.timings != nullptr)
+        {
+            // Compression is measured separately, from within Binary::Write
+            Timings::Time binaryTime = phaseTimer.Stop();
+            binaryTime -= session.timings->GetPhase(Timings::Phase::Compression);
+            session.timings->AddPhase(Timings::Phase::Binary, binaryTime);
+        }
+        if (session.memory != nullptr)
+        {
+            MemoryStats::Counters binaryCounters = phaseSampler.Stop();
+            binaryCounters -= session.memory->GetPhase(Timings::Phase::Compression);
+            session.memory->AddPhase(Timings::Phase::Binary, binaryCounters);
+        }
+        traceEndPhase(Timings::Phase::Binary);
+        phaseTimer = Timings::Timer();
+        phaseSampler = MemoryStats::Sampler();
+
+        // Write translation files
+        if (context.project->options.translationPublic)
+        {
+            log << "Writing public translation file..." << std::endl;
+
+            const std::string pubFileName = (project.options.translationPublicName.empty() ? binaryName : project.options.translationPublicName) + ".dxt";
+
+            std::stringstream s(std::ios_base::binary | std::ios_base::out);
+            Translation::GeneratePublicFile(s, &context);
+            session.outputs.push_back({ CompileOutput::OutputType::PublicTranslation, (mainOutput / pubFileName).lexically_normal().string(), s.str() });
+        }
+
+        if (context.project->options.translationPrivate) 
+        {
+            log << "Writing private translation file..." << std::endl;
+
+            const fs::path privateOutput = baseDirectory / project.options.translationPrivateOutDir;
+            const std::string privFileName = (project.options.translationPrivateName.empty() ? binaryName : project.options.translationPrivateName) + ".dxt";
+
+            std::stringstream s(std::ios_base::binary | std::ios_base::out);
+            Translation::GeneratePrivateFile(s, &context);
+            session.outputs.push_back({ CompileOutput::OutputType::PrivateTranslation, (privateOutput / privFileName).lexically_normal().string(), s.str() });
+        }
+        endPhase(Timings::Phase::Translation);
+
+        auto stop = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start);
+
+        log << rang::fgB::green;
+        if (project.options.compileFinishMessage.size() != 0)
+            log << project.options.compileFinishMessage << std::endl;
+        else
+            log << "Finished! ";
+        log << "Took " << duration.count() << " milliseconds." << rang::fg::reset << std::endl;
+
+        return 0;
+    }
+
+    bool Compiler::WriteOutputs(const CompileSession& session)
+    {
+        std::ostream& log = (session.log != nullptr) ? *session.log : std::cout;
+        for (const CompileOutput& output : session.outputs)
+        {
+            std::error_code ec;
+            if (output.type == CompileOutput::OutputType::Source)
+            {
+                // Make backup of the file before replacing it
+                fs::copy_file(output.path, output.path + ".backup", fs::copy_options::overwrite_existing, ec);
+            }
+            else
+            {
+                const fs::path directory = fs::path(output.path).parent_path();
+                if (!directory.empty() && !fs::exists(directory))
+                    fs::create_directories(directory, ec);
+            }
+
+            std::ofstream s(output.path, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
+            if (!s.is_open())
+            {
+                log << std::endl << rang::fgB::red << "Failed to open output file '" << output.path << "' for writing!" << rang::fg::reset << std::endl;
+                return false;
+            }
+            s.write(output.data.data(), output.data.size());
+        }
+        return true;
+    }
+
+    void Compiler::Invalidate(WarmFiles& warmFiles, const std::string& file)
+    {
+        auto warm = warmFiles.find(WarmKey(file));
+        if (warm != warmFiles.end())
+        {
+            delete warm->second.shard;
+            warmFiles.erase(warm);
+        }
+    }
+
+    void Compiler::InvalidateAll(WarmFiles& warmFiles)
+    {
+        for (auto& warm : warmFiles)
+            delete warm.second.shard;
+        warmFiles.clear();
+    }
+
+    std::string Compiler::WarmKey(const std::string& file)
+    {
+        std::error_code ec;
+        fs::path path = fs::absolute(file, ec);
+        if (ec)
+            path = file;
+        return path.lexically_normal().string();
+    }
+}
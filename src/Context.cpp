@@ -8,20 +8,47 @@ namespace diannex
         {
             delete it->second;
         }
+
+        // Calls that were never patched still own their symbol lists
+        for (Instruction& instr : bytecode)
+        {
+            if (instr.opcode == Instruction::Opcode::PATCH_CALL)
+                delete instr.vec;
+        }
     }
 
-    int CompileContext::string(const std::string& str)
+    int CompileContext::string(std::string_view str)
     {
         int index = internalStrings.size();
-        auto p = internalStringsMap.insert({ str, index });
+        auto p = internalStringsMap.insert({ std::string(str), index });
         if (p.second)
         {
             // This is a new string; add to list as well
-            internalStrings.push_back(str);
+            internalStrings.push_back(p.first->first);
             return index;
         }
 
         // Return index of previously-stored string
         return p.first->second;
     }
-}
\ No newline at end of file
+
+    int CompileContext::string(Symbol symbol)
+    {
+        auto it = internalSymbolsMap.find(symbol);
+        if (it != internalSymbolsMap.end())
+            return it->second;
+        int index = string(std::string(Symbols::Name(symbol)));
+        internalSymbolsMap.insert({ symbol, index });
+        return index;
+    }
+
+    uint32_t CompileContext::tokenLine(const Token& t) const
+    {
+        return (lines != nullptr) ? lines->Line(t.offset) : 0;
+    }
+
+    uint32_t CompileContext::tokenColumn(const Token& t) const
+    {
+        return (lines != nullptr) ? lines->Column(t.offset) : 0;
+    }
+}
@@ -0,0 +1,179 @@
+#include "FileProvider.h"
+
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace diannex
+{
+    SourceBuffer::~SourceBuffer()
+    {
+        Release();
+    }
+
+    void SourceBuffer::Release()
+    {
+        if (mapping != nullptr)
+        {
+#ifdef _WIN32
+            UnmapViewOfFile(mapping);
+#else
+            munmap(mapping, mappingSize);
+#endif
+            mapping = nullptr;
+        }
+        std::string().swap(owned);
+        data = "";
+        size = 0;
+    }
+
+    void SourceBuffer::Assign(std::string&& str)
+    {
+        Release();
+        owned = std::move(str);
+        data = owned.c_str();
+        size = owned.size();
+    }
+
+    void SourceBuffer::Borrow(const std::string& str)
+    {
+        Release();
+        data = str.c_str();
+        size = str.size();
+    }
+
+    // Reads a whole file with streams, for files that can't be mapped
+    static bool readFile(const std::string& path, std::string& source, std::string& error)
+    {
+        try
+        {
+            if (!fs::exists(path))
+                throw std::runtime_error("File does not exist.");
+            std::ifstream f(path, std::ios::in | std::ios::binary);
+            f.seekg(0, std::ios::end);
+            source.resize(f.tellg());
+            f.seekg(0, std::ios::beg);
+            f.read(source.data(), source.size());
+            source.resize(f.gcount());
+        }
+        catch (const std::exception& e)
+        {
+            error = e.what();
+            return false;
+        }
+        return true;
+    }
+
+    bool SourceBuffer::Map(const std::string& path, std::string& error)
+    {
+        Release();
+
+        // The lexer relies on a null character after the contents. Past the end of a file, the rest of its last page
+        // is zero-filled, so that only needs a copy when the file is empty or exactly fills its last page.
+        uint64_t fileSize = 0;
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file != INVALID_HANDLE_VALUE)
+        {
+            LARGE_INTEGER largeSize;
+            SYSTEM_INFO info;
+            GetSystemInfo(&info);
+            if (GetFileSizeEx(file, &largeSize) && largeSize.QuadPart != 0 && largeSize.QuadPart % info.dwPageSize != 0)
+            {
+                fileSize = largeSize.QuadPart;
+                HANDLE fileMapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+                if (fileMapping != nullptr)
+                {
+                    mapping = MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0);
+                    CloseHandle(fileMapping); // the view keeps the mapping alive
+                }
+            }
+            CloseHandle(file);
+        }
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd != -1)
+        {
+            struct stat st;
+            long pageSize = sysconf(_SC_PAGESIZE);
+            if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size != 0 && st.st_size % pageSize != 0)
+            {
+                fileSize = st.st_size;
+                void* view = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (view != MAP_FAILED)
+                {
+                    mapping = view;
+#ifdef MADV_SEQUENTIAL
+                    madvise(mapping, fileSize, MADV_SEQUENTIAL);
+#endif
+                }
+            }
+            close(fd); // the mapping stays valid
+        }
+#endif
+        if (mapping != nullptr)
+        {
+            mappingSize = fileSize;
+            data = (const char*)mapping;
+            size = fileSize;
+            return true;
+        }
+
+        std::string str;
+        if (!readFile(path, str, error))
+            return false;
+        Assign(std::move(str));
+        return true;
+    }
+
+    std::string FileProvider::ResolveInclude(const std::string& from, const std::string& include)
+    {
+        return (fs::path(from).parent_path() / include).lexically_normal().string();
+    }
+
+    bool DiskFileProvider::Read(const std::string& path, SourceBuffer& source, std::string& error)
+    {
+        return source.Map(path, error);
+    }
+
+    std::string DiskFileProvider::ResolveInclude(const std::string& from, const std::string& include)
+    {
+        fs::path p = fs::absolute(from).parent_path();
+        p /= include;
+        return p.string();
+    }
+
+    void MemoryFileProvider::Set(const std::string& path, const std::string& source)
+    {
+        files[fs::path(path).lexically_normal().string()] = source;
+    }
+
+    void MemoryFileProvider::Remove(const std::string& path)
+    {
+        files.erase(fs::path(path).lexically_normal().string());
+    }
+
+    bool MemoryFileProvider::Read(const std::string& path, SourceBuffer& source, std::string& error)
+    {
+        auto it = files.find(fs::path(path).lexically_normal().string());
+        if (it == files.end())
+        {
+            error = "File does not exist.";
+            return false;
+        }
+        source.Borrow(it->second);
+        return true;
+    }
+}
@@ -0,0 +1,114 @@
+#include "FileWatcher.h"
+
+#include <filesystem>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace diannex
+{
+    // How long to keep collecting changes after the first one, as editors often write files in several steps
+    static const int SETTLE_MILLISECONDS = 100;
+
+#ifdef __linux__
+    FileWatcher::FileWatcher()
+    {
+        fd = inotify_init1(IN_CLOEXEC);
+    }
+
+    FileWatcher::~FileWatcher()
+    {
+        if (fd != -1)
+            close(fd);
+    }
+
+    bool FileWatcher::IsSupported()
+    {
+        return fd != -1;
+    }
+
+    void FileWatcher::Watch(const std::vector<std::string>& files)
+    {
+        for (auto& pair : directories)
+            inotify_rm_watch(fd, pair.first);
+        directories.clear();
+        this->files.clear();
+
+        std::unordered_set<std::string> added;
+        for (const std::string& file : files)
+        {
+            fs::path path = fs::path(file).lexically_normal();
+            this->files.insert(path.string());
+
+            std::string directory = path.parent_path().string();
+            if (!added.insert(directory).second)
+                continue;
+            int wd = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE | IN_MOVED_FROM);
+            if (wd != -1)
+                directories[wd] = directory;
+        }
+    }
+
+    std::vector<std::string> FileWatcher::WaitForChanges()
+    {
+        std::unordered_set<std::string> changed;
+        alignas(inotify_event) char buf[4096];
+
+        while (true)
+        {
+            // Block for the first change, then only wait a little while for the rest
+            if (!changed.empty())
+            {
+                pollfd p = { fd, POLLIN, 0 };
+                if (poll(&p, 1, SETTLE_MILLISECONDS) <= 0)
+                    break;
+            }
+
+            ssize_t len = read(fd, buf, sizeof(buf));
+            if (len <= 0)
+                break;
+
+            for (char* ptr = buf; ptr < buf + len; ptr += sizeof(inotify_event) + ((inotify_event*)ptr)->len)
+            {
+                inotify_event* event = (inotify_event*)ptr;
+                auto directory = directories.find(event->wd);
+                if (directory == directories.end() || event->len == 0)
+                    continue;
+
+                std::string path = (fs::path(directory->second) / event->name).string();
+                if (files.count(path))
+                    changed.insert(path);
+            }
+        }
+
+        return std::vector<std::string>(changed.begin(), changed.end());
+    }
+#else
+    FileWatcher::FileWatcher()
+    {
+    }
+
+    FileWatcher::~FileWatcher()
+    {
+    }
+
+    bool FileWatcher::IsSupported()
+    {
+        return false;
+    }
+
+    void FileWatcher::Watch(const std::vector<std::string>&)
+    {
+    }
+
+    std::vector<std::string> FileWatcher::WaitForChanges()
+    {
+        return std::vector<std::string>();
+    }
+#endif
+}
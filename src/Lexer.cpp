@@ -1,30 +1,114 @@
 #include "Lexer.h"
+#include "Trace.h"
+#include "FileProvider.h"
 
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
 #include <string>
 #include <memory>
+
+#if !defined(__cpp_lib_to_chars)
+#include <locale>
 #include <sstream>
-#include <filesystem>
+#endif
 
-namespace fs = std::filesystem;
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DIANNEX_LEXER_SSE2 1
+#include <emmintrin.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
 
 namespace diannex
 {
     // Token constructors
-    Token::Token(TokenType type, uint32_t line, uint32_t column)
-        : type(type), line(line), column(column)
+    Token::Token(TokenType type, uint32_t offset)
+        : type(type), offset(offset)
+    {
+    }
+    Token::Token(TokenType type, uint32_t offset, KeywordType keywordType)
+        : type(type), keywordType(keywordType), offset(offset)
+    {
+    }
+
+    // TokenList
+    void TokenList::Add(TokenType type, uint32_t offset, std::string_view content)
+    {
+        tokens.push_back(Make(type, offset, content));
+    }
+
+    void TokenList::AddString(TokenType type, uint32_t offset, std::string_view content, StringData data, uint32_t interpolationCount)
+    {
+        Token& token = tokens.emplace_back(type, offset);
+        token.content = (uint32_t)strings.size();
+        token.length = (uint32_t)content.size();
+        strings.push_back({ (uint32_t)text.size(), data, (uint32_t)interpolations.size() - interpolationCount, interpolationCount });
+        text.append(content);
+    }
+
+    void TokenList::AddNumber(TokenType type, uint32_t offset, NumberData data)
+    {
+        Token& token = tokens.emplace_back(type, offset);
+        token.content = (uint32_t)numbers.size();
+        numbers.push_back(data);
+    }
+
+    Token TokenList::Make(TokenType type, uint32_t offset, std::string_view content)
     {
+        Token token(type, offset);
+        token.content = (uint32_t)text.size();
+        token.length = (uint32_t)content.size();
+        text.append(content);
+        return token;
     }
-    Token::Token(TokenType type, uint32_t line, uint32_t column, KeywordType keywordType)
-        : type(type), line(line), column(column), keywordType(keywordType)
+
+    void TokenList::Copy(const TokenList& from, Token token, uint32_t offset)
     {
+        token.offset = offset;
+        if (isNumber(token.type))
+        {
+            AddNumber(token.type, offset, from.numbers[token.content]);
+            return;
+        }
+
+        std::string_view content = from.Content(token);
+        if (isString(token.type))
+        {
+            uint32_t index = (uint32_t)strings.size();
+            strings.push_back({ (uint32_t)text.size(), from.strings[token.content].data, (uint32_t)interpolations.size(), 0 });
+            token.content = index;
+        }
+        else
+            token.content = (uint32_t)text.size();
+        text.append(content);
+        tokens.push_back(token);
     }
-    Token::Token(TokenType type, uint32_t line, uint32_t column, std::string content)
-        : type(type), line(line), column(column), content(content)
+
+    void TokenList::Clear()
     {
+        std::vector<Token>().swap(tokens);
+        std::string().swap(text);
+        std::vector<StringLiteral>().swap(strings);
+        std::vector<NumberData>().swap(numbers);
+        std::vector<Interpolation>().swap(interpolations);
+        interpolated.reset();
     }
-    Token::Token(TokenType type, uint32_t line, uint32_t column, std::string content, std::shared_ptr<StringData> stringData)
-        : type(type), line(line), column(column), content(content), stringData(stringData)
+
+    uint64_t TokenList::HeapSize() const
     {
+        uint64_t res = tokens.capacity() * sizeof(Token) + strings.capacity() * sizeof(StringLiteral) +
+                       numbers.capacity() * sizeof(NumberData) + interpolations.capacity() * sizeof(Interpolation) + lines.HeapSize();
+        if (interpolated != nullptr)
+            res += sizeof(TokenList) + interpolated->HeapSize();
+        if (text.capacity() > std::string().capacity())
+            res += text.capacity() + 1;
+        return res;
     }
 
     // StringData constructors
@@ -33,25 +117,227 @@ namespace diannex
     {
     }
 
+    // NumberData constructors
+    NumberData::NumberData(double value, bool integer)
+        : value(value), integer(integer)
+    {
+    }
+
+    // Parses the text of a number literal: digits, with an optional sign and decimal point.
+    // Anything out of range (or with no digits) becomes infinity.
+    static NumberData parseNumber(std::string_view text)
+    {
+        bool integer = text.find('.') == std::string_view::npos;
+        double value;
+#if defined(__cpp_lib_to_chars)
+        if (std::from_chars(text.data(), text.data() + text.size(), value).ec != std::errc())
+            value = INFINITY;
+#else
+        // Older standard libraries (such as libc++ before 20) only have from_chars for integers,
+        // so anything else goes through a stream, using the C locale for the decimal point
+        int64_t intValue;
+        auto res = std::from_chars(text.data(), text.data() + text.size(), intValue);
+        if (integer && res.ec == std::errc() && res.ptr == text.data() + text.size())
+            value = (double)intValue;
+        else
+        {
+            std::istringstream ss { std::string(text) };
+            ss.imbue(std::locale::classic());
+            if (!(ss >> value))
+                value = INFINITY;
+        }
+#endif
+        return NumberData(value, integer);
+    }
+
+    // Character classes, looked up by byte value
+    enum CharClass : uint8_t
+    {
+        CharBlank = 1 << 0, // whitespace other than newlines
+        CharIdentifierStart = 1 << 1,
+        CharIdentifierMid = 1 << 2,
+        CharNumberStart = 1 << 3, // digits, and '.' (also starting a range)
+        CharStringStart = 1 << 4, // '"', or the '@' and '!' prefixes
+        CharHexDigit = 1 << 5
+    };
+
+    static constexpr std::array<uint8_t, 256> makeCharClasses()
+    {
+        std::array<uint8_t, 256> classes {};
+        for (int c = 0; c < 256; c++)
+        {
+            uint8_t cls = 0;
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f')
+                cls |= CharBlank;
+            if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c >= 0xC0)
+                cls |= CharIdentifierStart;
+            if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == '.' || (c >= '0' && c <= '9') || c >= 0x80)
+                cls |= CharIdentifierMid;
+            if ((c >= '0' && c <= '9') || c == '.')
+                cls |= CharNumberStart;
+            if (c == '"' || c == '@' || c == '!')
+                cls |= CharStringStart;
+            if ((c >= '0' && c <= '9') || (c >= 'A' && c <= 'F') || (c >= 'a' && c <= 'f'))
+                cls |= CharHexDigit;
+            classes[c] = cls;
+        }
+        return classes;
+    }
+
+    static constexpr std::array<uint8_t, 256> charClasses = makeCharClasses();
+
+    static inline bool hasClass(char c, uint8_t cls)
+    {
+        return (charClasses[(uint8_t)c] & cls) != 0;
+    }
+
+    // Scanning over runs of characters, 16 (or 32) at a time where SIMD is available.
+    // These never read past end, so they're safe on mapped files.
+#if DIANNEX_LEXER_SSE2
+    static inline int lowestBit(uint32_t mask)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return (int)index;
+#else
+        return __builtin_ctz(mask);
+#endif
+    }
+#endif
+
+    // Returns the first occurrence of c (or c2) from p, or end if there isn't one
+    static inline const char* findChar(const char* p, const char* end, char c, char c2)
+    {
+#if DIANNEX_LEXER_SSE2
+#ifdef __AVX2__
+        const __m256i wideC = _mm256_set1_epi8(c), wideC2 = _mm256_set1_epi8(c2);
+        while (end - p >= 32)
+        {
+            __m256i chunk = _mm256_loadu_si256((const __m256i*)p);
+            uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, wideC), _mm256_cmpeq_epi8(chunk, wideC2)));
+            if (mask != 0)
+                return p + lowestBit(mask);
+            p += 32;
+        }
+#endif
+        const __m128i vecC = _mm_set1_epi8(c), vecC2 = _mm_set1_epi8(c2);
+        while (end - p >= 16)
+        {
+            __m128i chunk = _mm_loadu_si128((const __m128i*)p);
+            uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, vecC), _mm_cmpeq_epi8(chunk, vecC2)));
+            if (mask != 0)
+                return p + lowestBit(mask);
+            p += 16;
+        }
+#endif
+        while (p < end && *p != c && *p != c2)
+            p++;
+        return p;
+    }
+
+    static inline const char* findChar(const char* p, const char* end, char c)
+    {
+        return findChar(p, end, c, c);
+    }
+
+    // Returns the first character from p that isn't blank (so possibly a newline), or end if there isn't one
+    static inline const char* findNonBlank(const char* p, const char* end)
+    {
+        // Most runs of whitespace are a single space, if there's any at all
+        if (p == end || !hasClass(*p, CharBlank))
+            return p;
+        p++;
+#if DIANNEX_LEXER_SSE2
+        // Blank characters are ' ', and '\t' through '\r' other than '\n'
+        const __m128i space = _mm_set1_epi8(' '), newline = _mm_set1_epi8('\n');
+        const __m128i belowTab = _mm_set1_epi8('\t' - 1), aboveReturn = _mm_set1_epi8('\r' + 1);
+        while (end - p >= 16)
+        {
+            __m128i chunk = _mm_loadu_si128((const __m128i*)p);
+            __m128i control = _mm_andnot_si128(_mm_cmpeq_epi8(chunk, newline),
+                                               _mm_and_si128(_mm_cmpgt_epi8(chunk, belowTab), _mm_cmplt_epi8(chunk, aboveReturn)));
+            uint32_t mask = ~(uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, space), control)) & 0xFFFF;
+            if (mask != 0)
+                return p + lowestBit(mask);
+            p += 16;
+        }
+#endif
+        while (p < end && hasClass(*p, CharBlank))
+            p++;
+        return p;
+    }
+
+    // LineIndex
+    void LineIndex::Build(std::string_view source)
+    {
+        const char* begin = source.data();
+        const char* end = begin + source.size();
+
+        // A byte order mark doesn't count towards the first line's columns
+        starts.clear();
+        if (source.size() >= 3 && (uint8_t)begin[0] == 0xEF && (uint8_t)begin[1] == 0xBB && (uint8_t)begin[2] == 0xBF)
+            starts.push_back(3);
+        else
+            starts.push_back(0);
+
+        for (const char* p = findChar(begin, end, '\n'); p != end; p = findChar(p + 1, end, '\n'))
+            starts.push_back((uint32_t)(p + 1 - begin));
+    }
+
+    uint32_t LineIndex::Line(uint32_t offset) const
+    {
+        if (offset == Token::NoOffset || starts.empty())
+            return 0;
+        auto it = std::upper_bound(starts.begin(), starts.end(), offset);
+        return (it == starts.begin()) ? 1 : (uint32_t)(it - starts.begin());
+    }
+
+    uint32_t LineIndex::Column(uint32_t offset) const
+    {
+        uint32_t line = Line(offset);
+        if (line == 0)
+            return 0;
+        if (offset < starts[line - 1]) // inside a byte order mark
+            return 1;
+        return offset - starts[line - 1] + 1;
+    }
+
+    void LineIndex::Clear()
+    {
+        std::vector<uint32_t>().swap(starts);
+    }
+
+    uint64_t LineIndex::HeapSize() const
+    {
+        return starts.capacity() * sizeof(uint32_t);
+    }
+
     // Utility class for reading code strings easily
     class CodeReader
     {
     public:
-        CodeReader(const std::string& code, uint32_t line, uint32_t column)
-            : code(code), position(0), length(code.length()), line(line), column(column)
+        // Reads directly from the given characters, which must be followed by a null character
+        CodeReader(const char* code, uint32_t length, uint32_t base)
+            : code(code), position(0), length(length), base(base)
         {
-            if ((uint8_t)code[0] == 0xEF && (uint8_t)code[1] == 0xBB && (uint8_t)code[2] == 0xBF)
+            if (length >= 3 && (uint8_t)code[0] == 0xEF && (uint8_t)code[1] == 0xBB && (uint8_t)code[2] == 0xBF)
                 position += 3;
         }
 
         uint32_t position;
         uint32_t length;
-        uint32_t line;
-        uint32_t column;
+        uint32_t base; // offset of the code within the whole file, added to token offsets
         int16_t skip = -1;
         int16_t stack = 0;
         bool directiveFollowup = false;
 
+        // Offset of the current position within the whole file
+        inline uint32_t offset()
+        {
+            return base + position;
+        }
+
         inline char peekChar()
         {
             return code[position];
@@ -69,7 +355,6 @@ namespace diannex
 
         inline void advanceChar()
         {
-            column++;
             position++;
         }
 
@@ -81,13 +366,11 @@ namespace diannex
 
         inline void backUpChar()
         {
-            column--;
             position--;
         }
 
         inline char readChar()
         {
-            column++;
             return code[position++];
         }
 
@@ -111,32 +394,101 @@ namespace diannex
             return (peekCharNext2() == c3);
         }
 
+        // Advances to the next c (or c2) on or after the current position, or to EOF
+        inline void skipTo(char c, char c2)
+        {
+            position = (uint32_t)(findChar(code + position, code + length, c, c2) - code);
+        }
+
+        inline void skipTo(char c)
+        {
+            skipTo(c, c);
+        }
+
         // Skips whitespace characters
         // Returns true if EOF is hit
-        bool skipWhitespace(std::vector<Token>& out)
+        bool skipWhitespace(TokenList& out)
         {
-            while (position < length)
+            while (true)
             {
-                char curr = peekChar();
-                if (curr != ' ' && curr != '\t' && curr != '\r' && curr != '\v' && curr != '\f')
+                position = (uint32_t)(findNonBlank(code + position, code + length) - code);
+                if (position >= length)
+                    return true;
+                if (peekChar() != '\n')
+                    return false;
+                out.Add(TokenType::Newline, offset());
+                advanceChar();
+            }
+        }
+
+        // Skips the rest of the current line, and whitespace after it
+        void skipLine(TokenList& out)
+        {
+            skipTo('\n');
+            skipWhitespace(out);
+        }
+
+        // Skips over an inactive #ifdef/#ifndef region up to its #endif, only stopping at newlines and '#'.
+        // Returns true if EOF is hit
+        bool skipInactive(TokenList& out)
+        {
+            while (true)
+            {
+                skipTo('#', '\n');
+                if (position >= length)
+                    return true;
+                if (peekChar() == '\n')
                 {
-                    if (curr != '\n')
-                        return false;
-                    else
+                    out.Add(TokenType::Newline, offset());
+                    advanceChar();
+                    continue;
+                }
+
+                // Only directives are looked at, to track nesting
+                if (peekCharNext() == 'i')
+                {
+                    if (
+                            (advanceChar(), matchChars('i', 'f')) &&
+                            (advanceChar(2), peekChar() == 'n' ?
+                                                (advanceChar(), matchChars('d', 'e', 'f')) :
+                                                matchChars('d', 'e', 'f')))
                     {
-                        out.emplace_back(TokenType::Newline, line, column);
-                        line++;
-                        column = 0;
+                        advanceChar(3);
+                        char curr = peekChar();
+                        if (curr == ' ' || curr == '\t' || curr == '\r' || curr == '\v' || curr == '\f' || curr == '\n')
+                        {
+                            stack++;
+                        }
                     }
                 }
+                else if (peekCharNext() == 'e')
+                {
+                    if (
+                            (advanceChar(), matchChars('e', 'n', 'd')) &&
+                            (advanceChar(3), matchChars('i', 'f')))
+                    {
+                        advanceChar(2);
+                        char curr = peekChar();
+                        if (curr == ' ' || curr == '\t' || curr == '\r' || curr == '\v' || curr == '\f' || curr == '\n')
+                        {
+                            stack--;
+                            if (stack == skip)
+                            {
+                                skip = -1;
+                            }
+                        }
+                    }
+                }
+
                 advanceChar();
+                if (skip == -1)
+                    return false;
             }
-            return true;
         }
 
         // Reads a comment if one exists
         // Returns true if recognized
-        bool readComment(std::vector<Token>& out)
+        bool readComment(TokenList& out)
         {
             if (peekChar() == '/')
             {
@@ -152,14 +504,7 @@ namespace diannex
                         advanceChar(2);
 
                         // Ignore all further text on this line
-                        uint32_t thisLine = line;
-                        skipWhitespace(out);
-                        while (position < length && thisLine == line)
-                        {
-                            advanceChar();
-                            skipWhitespace(out);
-                        }
-
+                        skipLine(out);
                         return true;
                     }
                     else if (n == '*')
@@ -173,19 +518,13 @@ namespace diannex
                         // Ignore text until EOF or "*/"
                         while (position < length)
                         {
-                            char c = readChar();
-                            if (c == '*')
-                            {
-                                if (position + 1 < length && peekChar() == '/')
-                                {
-                                    advanceChar();
-                                    return true;
-                                }
-                            }
-                            else if (c == '\n')
+                            skipTo('*', '\n');
+                            if (position >= length)
+                                break;
+                            if (readChar() == '*' && position + 1 < length && peekChar() == '/')
                             {
-                                line++;
-                                column = 0;
+                                advanceChar();
+                                return true;
                             }
                         }
 
@@ -196,32 +535,24 @@ namespace diannex
             return false;
         }
 
-        // Reads an identifier
+        // Reads an identifier, as a view into the code
         // Returns null if not valid
-        std::optional<std::string> readIdentifier()
+        std::optional<std::string_view> readIdentifier()
         {
             uint32_t base = position;
 
-            if (position == length || !isValidIdentifierStart(readChar()))
+            if (position == length || !hasClass(readChar(), CharIdentifierStart))
                 return {}; // invalid
 
-            while (position < length)
-            {
-                char curr = peekChar();
-                if (isValidIdentifierMid(curr))
-                    advanceChar();
-                else
-                    break;
-            }
+            while (position < length && hasClass(peekChar(), CharIdentifierMid))
+                advanceChar();
 
-            return code.substr(base, position - base);
+            return std::string_view(code + base, position - base);
         }
 
-        void readNumber(char curr, const std::string& in, std::vector<Token>& out)
+        void readNumber(char curr, TokenList& out)
         {
-            uint32_t startLine = line;
-            uint16_t startCol = column;
-
+            uint32_t start = offset();
             uint32_t base = position;
 
             if (curr == '-')
@@ -269,67 +600,271 @@ namespace diannex
             }
 
             if (isPercent)
-                out.emplace_back(TokenType::Percentage, startLine, startCol, in.substr(base, position - base - 1));
+                out.AddNumber(TokenType::Percentage, start, parseNumber(std::string_view(code + base, position - base - 1)));
             else
-                out.emplace_back(TokenType::Number, startLine, startCol, in.substr(base, position - base));
+                out.AddNumber(TokenType::Number, start, parseNumber(std::string_view(code + base, position - base)));
         }
     private:
-        std::string code;
+        const char* code;
+    };
+
+    // Built-in keywords, found through a perfect hash generated at compile time
+    struct KeywordInfo
+    {
+        std::string_view name;
+        TokenType type;
+        KeywordType keywordType;
+        const char* content; // for keywords standing in for values
+    };
 
-        static inline bool isValidIdentifierStart(char c)
+    static constexpr KeywordInfo keywordList[] =
+    {
+        { "namespace", TokenType::GroupKeyword, KeywordType::Namespace, nullptr },
+        { "scene", TokenType::GroupKeyword, KeywordType::Scene, nullptr },
+        { "def", TokenType::GroupKeyword, KeywordType::Def, nullptr },
+        { "func", TokenType::GroupKeyword, KeywordType::Func, nullptr },
+
+        { "choice", TokenType::MainKeyword, KeywordType::Choice, nullptr },
+        { "choose", TokenType::MainKeyword, KeywordType::Choose, nullptr },
+        { "if", TokenType::MainKeyword, KeywordType::If, nullptr },
+        { "else", TokenType::MainKeyword, KeywordType::Else, nullptr },
+        { "while", TokenType::MainKeyword, KeywordType::While, nullptr },
+        { "for", TokenType::MainKeyword, KeywordType::For, nullptr },
+        { "do", TokenType::MainKeyword, KeywordType::Do, nullptr },
+        { "repeat", TokenType::MainKeyword, KeywordType::Repeat, nullptr },
+        { "switch", TokenType::MainKeyword, KeywordType::Switch, nullptr },
+        { "continue", TokenType::MainKeyword, KeywordType::Continue, nullptr },
+        { "break", TokenType::MainKeyword, KeywordType::Break, nullptr },
+        { "return", TokenType::MainKeyword, KeywordType::Return, nullptr },
+        { "case", TokenType::MainKeyword, KeywordType::Case, nullptr },
+        { "default", TokenType::MainKeyword, KeywordType::Default, nullptr },
+        { "sequence", TokenType::MainKeyword, KeywordType::Sequence, nullptr },
+
+        { "require", TokenType::MainSubKeyword, KeywordType::Require, nullptr },
+
+        { "local", TokenType::ModifierKeyword, KeywordType::Local, nullptr },
+        { "global", TokenType::ModifierKeyword, KeywordType::Global, nullptr },
+
+        { "false", TokenType::Number, KeywordType::None, "0" },
+        { "true", TokenType::Number, KeywordType::None, "1" },
+
+        { "undefined", TokenType::Undefined, KeywordType::None, "undefined" },
+    };
+
+    static constexpr uint32_t keywordTableSize = 64;
+
+    // Hashes the length, first character and last two characters of a name, which must be at least two long
+    static constexpr uint32_t keywordHash(std::string_view name, uint32_t seed)
+    {
+        uint32_t hash = (uint32_t)name.size();
+        hash = hash * seed + (uint8_t)name[0];
+        hash = hash * seed + (uint8_t)name[name.size() - 2];
+        hash = hash * seed + (uint8_t)name[name.size() - 1];
+        return (hash >> 4) % keywordTableSize;
+    }
+
+    // Finds the first seed that gives every keyword its own slot, or 0 if there isn't one
+    static constexpr uint32_t findKeywordSeed()
+    {
+        for (uint32_t seed = 1; seed < 0x10000; seed++)
         {
-            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || (unsigned char)c >= 0xC0;
+            bool used[keywordTableSize] {};
+            bool collision = false;
+            for (const KeywordInfo& keyword : keywordList)
+            {
+                uint32_t hash = keywordHash(keyword.name, seed);
+                if (used[hash])
+                {
+                    collision = true;
+                    break;
+                }
+                used[hash] = true;
+            }
+            if (!collision)
+                return seed;
         }
+        return 0;
+    }
+
+    static constexpr uint32_t keywordSeed = findKeywordSeed();
+    static_assert(keywordSeed != 0, "no perfect hash for the keyword set; increase keywordTableSize");
 
-        static inline bool isValidIdentifierMid(char c)
+    static constexpr std::array<int8_t, keywordTableSize> makeKeywordTable()
+    {
+        std::array<int8_t, keywordTableSize> table {};
+        for (uint32_t i = 0; i < keywordTableSize; i++)
+            table[i] = -1;
+        for (uint32_t i = 0; i < sizeof(keywordList) / sizeof(keywordList[0]); i++)
+            table[keywordHash(keywordList[i].name, keywordSeed)] = (int8_t)i;
+        return table;
+    }
+
+    static constexpr std::array<int8_t, keywordTableSize> keywordTable = makeKeywordTable();
+
+    // Returns the keyword with the given name, or null if it isn't one
+    static inline const KeywordInfo* findKeyword(std::string_view name)
+    {
+        if (name.size() < 2) // shorter than any keyword
+            return nullptr;
+        int8_t index = keywordTable[keywordHash(name, keywordSeed)];
+        if (index == -1 || keywordList[index].name != name)
+            return nullptr;
+        return &keywordList[index];
+    }
+
+    MacroCache::MacroCache(ProjectFormat* project)
+    {
+        CompileContext ctx;
+        ctx.project = project;
+        for (auto& pair : project->options.macros)
         {
-            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == '.' || (c >= '0' && c <= '9') || (unsigned char)c >= 0x80;
+            LexedMacro& macro = macros[pair.first];
+            macro.name = pair.first;
+            ctx.maxStringId = -1;
+            Lexer::LexString(pair.second, &ctx, macro.tokens, 0, &macro);
+            macro.maxStringId = ctx.maxStringId;
         }
-    };
 
-    static const std::unordered_map<std::string, Token> keywords =
+        // Now that every macro exists, link up the ones used inside others
+        for (auto& pair : macros)
+        {
+            for (auto& nested : pair.second.nested)
+                nested.second = Find(pair.second.tokens.Content(pair.second.tokens.tokens[nested.first]));
+        }
+    }
+
+    const LexedMacro* MacroCache::Find(std::string_view name) const
     {
-        { "namespace", Token(TokenType::GroupKeyword, 0, 0, KeywordType::Namespace) },
-        { "scene", Token(TokenType::GroupKeyword, 0, 0, KeywordType::Scene) },
-        { "def", Token(TokenType::GroupKeyword, 0, 0, KeywordType::Def) },
-        { "func", Token(TokenType::GroupKeyword, 0, 0, KeywordType::Func) },
-
-        { "choice", Token(TokenType::MainKeyword, 0, 0, KeywordType::Choice) },
-        { "choose", Token(TokenType::MainKeyword, 0, 0, KeywordType::Choose) },
-        { "if", Token(TokenType::MainKeyword, 0, 0, KeywordType::If) },
-        { "else", Token(TokenType::MainKeyword, 0, 0, KeywordType::Else) },
-        { "while", Token(TokenType::MainKeyword, 0, 0, KeywordType::While) },
-        { "for", Token(TokenType::MainKeyword, 0, 0, KeywordType::For) },
-        { "do", Token(TokenType::MainKeyword, 0, 0, KeywordType::Do) },
-        { "repeat", Token(TokenType::MainKeyword, 0, 0, KeywordType::Repeat) },
-        { "switch", Token(TokenType::MainKeyword, 0, 0, KeywordType::Switch) },
-        { "continue", Token(TokenType::MainKeyword, 0, 0, KeywordType::Continue) },
-        { "break", Token(TokenType::MainKeyword, 0, 0, KeywordType::Break) },
-        { "return", Token(TokenType::MainKeyword, 0, 0, KeywordType::Return) },
-        { "case", Token(TokenType::MainKeyword, 0, 0, KeywordType::Case) },
-        { "default", Token(TokenType::MainKeyword, 0, 0, KeywordType::Default) },
-        { "sequence", Token(TokenType::MainKeyword, 0, 0, KeywordType::Sequence) },
-
-        { "require", Token(TokenType::MainSubKeyword, 0, 0, KeywordType::Require) },
-
-        { "local", Token(TokenType::ModifierKeyword, 0, 0, KeywordType::Local) },
-        { "global", Token(TokenType::ModifierKeyword, 0, 0, KeywordType::Global) },
-
-        { "false", Token(TokenType::Number, 0, 0, "0") },
-        { "true", Token(TokenType::Number, 0, 0, "1") },
-
-        { "undefined", Token(TokenType::Undefined, 0, 0, "undefined") },
-    };
+        auto it = macros.find(name);
+        return (it == macros.end()) ? nullptr : &it->second;
+    }
+
+    // Lexes code into a list. Expressions inside strings are lexed as such: their includes are dropped.
+    static void lex(std::string_view in, CompileContext* ctx, TokenList& out, uint32_t startOffset, LexedMacro* macro, bool expression);
+
+    // Adds a string literal token. With interpolation enabled, each "${...}" in its content is lexed into
+    // the list's interpolated tokens right away, and replaced by its index, ready for the parser.
+    static void addString(TokenType type, uint32_t offset, std::string_view content, StringData data, CompileContext* ctx, TokenList& out)
+    {
+        size_t pos = content.find("${");
+        if (pos == std::string_view::npos || !ctx->project->options.interpolationEnabled)
+        {
+            out.AddString(type, offset, content, data);
+            return;
+        }
+
+        if (out.interpolated == nullptr)
+            out.interpolated = std::make_unique<TokenList>();
+        TokenList& inner = *out.interpolated;
+
+        // Expressions are positioned as if the string had no escape sequences
+        uint32_t base = offset + ((type == TokenType::String) ? 1 : 2);
+        uint32_t count = 0;
+        std::string res, expr;
+        size_t last = 0;
+        while (pos != std::string_view::npos)
+        {
+            // An escaped "$" (one after a backslash) stays as text
+            if (pos != 0 && content[pos - 1] == '\\')
+            {
+                pos = content.find("${", pos + 1);
+                continue;
+            }
+
+            size_t start = pos + 2;
+            size_t end = std::min(content.find('}', start), content.size());
+            expr.assign(content.substr(start, end - start));
+            uint32_t begin = (uint32_t)inner.tokens.size();
+            lex(expr, ctx, inner, base + (uint32_t)start, nullptr, true);
+            out.interpolations.push_back({ begin, (uint32_t)inner.tokens.size(), base + (uint32_t)start });
+
+            res.append(content.substr(last, pos - last));
+            res.append("${");
+            res.append(std::to_string(count++));
+            res.push_back('}');
+            last = std::min(end + 1, content.size());
+            pos = content.find("${", last);
+        }
+        res.append(content.substr(last));
+
+        out.AddString(type, offset, res, data, count);
+    }
+
+    // Copies a macro's tokens to where it's used, expanding the macros it uses in turn.
+    // The chain holds the macros being expanded, so that recursive uses become errors.
+    static void expandMacro(const LexedMacro& macro, CompileContext* ctx, TokenList& out, uint32_t offset,
+                            std::vector<const LexedMacro*>& chain, bool expression)
+    {
+        Trace::Span span(ctx->trace, "macro", macro.name);
+        chain.push_back(&macro);
+
+        auto nested = macro.nested.begin();
+        const std::vector<Token>& tokens = macro.tokens.tokens;
+        for (uint32_t i = 0; i < tokens.size(); i++)
+        {
+            // Every token is positioned where the macro is used
+            const Token& t = tokens[i];
+            if (nested != macro.nested.end() && nested->first == i)
+            {
+                const LexedMacro* use = (nested++)->second;
+                if (std::find(chain.begin(), chain.end(), use) != chain.end())
+                    out.Add(TokenType::Error, offset, "recursive_macro");
+                else
+                    expandMacro(*use, ctx, out, offset, chain, expression);
+            }
+            else if (const StringData* data = macro.tokens.GetStringData(t))
+            {
+                // Interpolations are left in macros until they're used, as their expressions may use other macros
+                addString(t.type, offset, macro.tokens.Content(t), *data, ctx, out);
+            }
+            else
+                out.Copy(macro.tokens, t, offset);
+        }
+
+        if (!macro.includes.empty() && !expression)
+        {
+            static DiskFileProvider disk;
+            FileProvider* files = (ctx->fileProvider != nullptr) ? ctx->fileProvider : &disk;
+#if DIANNEX_OLD_INCLUDE_ORDER
+            for (const std::string& path : macro.includes)
+            {
+                Trace::Span span(ctx->trace, "include", path);
+                ctx->queue.push(files->ResolveInclude(ctx->currentFile, path));
+            }
+#else
+            for (auto it = macro.includes.rbegin(); it != macro.includes.rend(); ++it)
+            {
+                Trace::Span span(ctx->trace, "include", *it);
+                ctx->queue.push_front(files->ResolveInclude(ctx->currentFile, *it));
+            }
+#endif
+        }
+        if (macro.maxStringId > ctx->maxStringId)
+            ctx->maxStringId = macro.maxStringId;
 
-    void Lexer::LexString(const std::string& in, CompileContext* ctx, std::vector<Token>& out, uint32_t startLine, uint16_t startColumn, std::unordered_set<std::string>* macros)
+        chain.pop_back();
+    }
+
+    void Lexer::LexString(std::string_view in, CompileContext* ctx, TokenList& out, uint32_t startOffset, LexedMacro* macro)
+    {
+        lex(in, ctx, out, startOffset, macro, false);
+    }
+
+    static void lex(std::string_view in, CompileContext* ctx, TokenList& out, uint32_t startOffset, LexedMacro* macro, bool expression)
     {
-        CodeReader cr = CodeReader(in, startLine, startColumn);
+        CodeReader cr = CodeReader(in.data(), (uint32_t)in.size(), startOffset);
+        if (macro == nullptr && startOffset == 0)
+            out.lines.Build(in);
+
+        // Only built here if a macro is used without one being passed in
+        std::unique_ptr<MacroCache> localMacros;
+        std::vector<const LexedMacro*> macroChain;
 
 #if !DIANNEX_OLD_INCLUDE_ORDER
         std::vector<std::string> includes;
 #endif
 
-        out.reserve(1024);
+        out.tokens.reserve(1024);
 
         while (cr.position < cr.length)
         {
@@ -337,57 +872,11 @@ namespace diannex
                 break;
 
             // Directive checks when necessary
+            // Inactive #ifdef/#ifndef regions are skipped in one go
             if (cr.skip != -1)
             {
-                if (cr.peekChar() == '#')
-                {
-                    if (cr.peekCharNext() == 'i')
-                    {
-                        if (
-                                (cr.advanceChar(), cr.matchChars('i', 'f')) &&
-                                (cr.advanceChar(2), cr.peekChar() == 'n' ?
-                                                    (cr.advanceChar(), cr.matchChars('d', 'e', 'f')) :
-                                                    cr.matchChars('d', 'e', 'f')))
-                        {
-                            cr.advanceChar(3);
-                            char curr = cr.peekChar();
-                            if (curr == ' ' || curr == '\t' || curr == '\r' || curr == '\v' || curr == '\f' || curr == '\n')
-                            {
-                                if (curr == '\n')
-                                {
-                                    cr.line++;
-                                    cr.column = 0;
-                                }
-                                cr.stack++;
-                            }
-                        }
-                    }
-                    else if (cr.peekCharNext() == 'e')
-                    {
-                        if (
-                                (cr.advanceChar(), cr.matchChars('e', 'n', 'd')) &&
-                                (cr.advanceChar(3), cr.matchChars('i', 'f')))
-                        {
-                            cr.advanceChar(2);
-                            char curr = cr.peekChar();
-                            if (curr == ' ' || curr == '\t' || curr == '\r' || curr == '\v' || curr == '\f' || curr == '\n')
-                            {
-                                if (curr == '\n')
-                                {
-                                    cr.line++;
-                                    cr.column = 0;
-                                }
-                                cr.stack--;
-                                if (cr.stack == cr.skip)
-                                {
-                                    cr.skip = -1;
-                                }
-                            }
-                        }
-                    }
-                }
-
-                cr.advanceChar();
+                if (cr.skipInactive(out))
+                    break;
                 continue;
             }
 
@@ -395,26 +884,18 @@ namespace diannex
                 continue;
             if (cr.matchChars('/', '/', '!')) // Marked comment single-line
             {
-                uint16_t col = cr.column;
+                uint32_t start = cr.offset();
                 cr.advanceChar(3);
 
                 // Get to the next newline/EOF
                 uint32_t base = cr.position;
-                while (cr.position < cr.length)
-                {
-                    if (cr.readChar() == '\n')
-                    {
-                        cr.backUpChar();
-                        break;
-                    }
-                }
+                cr.skipTo('\n');
 
-                out.emplace_back(TokenType::MarkedComment, cr.line, col, in.substr(base, cr.position - base));
+                out.Add(TokenType::MarkedComment, start, in.substr(base, cr.position - base));
             }
             else if (cr.matchChars('/', '*', '!')) // Marked comment multi-line
             {
-                uint32_t line = cr.line;
-                uint16_t col = cr.column;
+                uint32_t start = cr.offset();
                 cr.advanceChar(3);
 
                 // Go until EOF or "*/"
@@ -422,6 +903,9 @@ namespace diannex
                 bool foundEnd = false;
                 while (cr.position < cr.length)
                 {
+                    cr.skipTo('*', '\n');
+                    if (cr.position >= cr.length)
+                        break;
                     char curr = cr.readChar();
                     if (curr == '*')
                     {
@@ -434,13 +918,11 @@ namespace diannex
                     }
                     else if (curr == '\n')
                     {
-                        out.emplace_back(TokenType::Newline, cr.line, cr.column);
-                        cr.line++;
-                        cr.column = 1;
+                        out.Add(TokenType::Newline, cr.offset() - 1);
                     }
                 }
 
-                out.emplace_back(TokenType::MarkedComment, line, col, in.substr(base, cr.position - base));
+                out.Add(TokenType::MarkedComment, start, in.substr(base, cr.position - base));
 
                 if (foundEnd)
                     cr.advanceChar(2);
@@ -450,8 +932,7 @@ namespace diannex
                 char curr = cr.peekChar();
                 if (curr == '#') // Directive
                 {
-                    uint32_t line = cr.line;
-                    uint16_t col = cr.column;
+                    uint32_t start = cr.offset();
                     cr.advanceChar();
 
                     // Read the directive type
@@ -461,32 +942,32 @@ namespace diannex
                         cr.directiveFollowup = true;
                         if (identifier->compare("include") == 0)
                         {
-                            out.emplace_back(TokenType::Directive, line, col, KeywordType::Include);
+                            out.Add(TokenType::Directive, start, KeywordType::Include);
                         }
                         else if (identifier->compare("ifdef") == 0)
                         {
-                            out.emplace_back(TokenType::Directive, line, col, KeywordType::IfDef);
+                            out.Add(TokenType::Directive, start, KeywordType::IfDef);
                         }
                         else if (identifier->compare("ifndef") == 0)
                         {
-                            out.emplace_back(TokenType::Directive, line, col, KeywordType::IfNDef);
+                            out.Add(TokenType::Directive, start, KeywordType::IfNDef);
                         }
                         else if (identifier->compare("endif") == 0) 
                         {
-                            out.emplace_back(TokenType::Directive, line, col, KeywordType::EndIf);
+                            out.Add(TokenType::Directive, start, KeywordType::EndIf);
                         }
                         else 
                         {
                             cr.directiveFollowup = false;
-                            out.emplace_back(TokenType::ErrorString, line, col, *identifier);
+                            out.Add(TokenType::ErrorString, start, *identifier);
                         }
                     }
                     else
                     {
-                        out.emplace_back(TokenType::Error, line, col);
+                        out.Add(TokenType::Error, start);
                     }
                 }
-                else if ((curr >= '0' && curr <= '9') || curr == '.') // Number, percentage, or range
+                else if (hasClass(curr, CharNumberStart)) // Number, percentage, or range
                 {
                     bool isRange = false;
                     if (curr == '.' && cr.position + 1 < cr.length)
@@ -499,25 +980,29 @@ namespace diannex
 
                     if (isRange)
                     {
-                        out.emplace_back(TokenType::Range, cr.line, cr.column);
+                        out.Add(TokenType::Range, cr.offset());
                         cr.advanceChar(2);
                     }
                     else
-                        cr.readNumber(curr, in, out);
+                        cr.readNumber(curr, out);
                 }
-                else if (curr == '"' || cr.matchChars('@', '"') || cr.matchChars('!', '"')) // Strings
+                else if (hasClass(curr, CharStringStart) && (curr == '"' || cr.matchChars(curr, '"'))) // Strings
                 {
                     char type = curr;
-                    uint32_t line = cr.line;
-                    uint16_t col = cr.column;
+                    uint32_t start = cr.offset();
 
                     cr.advanceChar(type == '"' ? 1 : 2);
 
-                    // Parse string content
-                    std::stringstream ss(std::ios_base::app | std::ios_base::out);
+                    // Parse string content, copying runs of plain characters at once
+                    std::string content;
                     bool foundEnd = false;
                     while (cr.position < cr.length)
                     {
+                        uint32_t base = cr.position;
+                        cr.skipTo('"', '\\');
+                        content.append(in.data() + base, cr.position - base);
+                        if (cr.position >= cr.length)
+                            break;
                         curr = cr.readChar();
                         if (curr == '\\')
                         {
@@ -527,143 +1012,127 @@ namespace diannex
                                 switch (curr)
                                 {
                                 case 'a':
-                                    ss << '\a';
+                                    content += '\a';
                                     break;
                                 case 'n':
-                                    ss << '\n';
+                                    content += '\n';
                                     break;
                                 case 'r':
-                                    ss << '\r';
+                                    content += '\r';
                                     break;
                                 case 't':
-                                    ss << '\t';
+                                    content += '\t';
                                     break;
                                 case 'v':
-                                    ss << '\v';
+                                    content += '\v';
                                     break;
                                 case 'f':
-                                    ss << '\f';
+                                    content += '\f';
                                     break;
                                 case 'b':
-                                    ss << '\b';
+                                    content += '\b';
                                     break;
                                 case '\n':
                                     break;
                                     // todo: unicode/hex/octal support?
                                 default:
-                                    ss << curr;
+                                    content += curr;
                                     break;
                                 }
                             }
                             else
                                 break; // error
                         }
-                        else if (curr == '"')
+                        else // if (curr == '"')
                         {
                             foundEnd = true;
                             break;
                         }
-                        else
-                            ss << curr;
                     }
 
                     if (foundEnd)
                     {
-                        std::shared_ptr<StringData> data;
+                        StringData data(-1, cr.position);
                         if (cr.position + 2 < cr.length && cr.peekChar() == '&' && /* prevent && syntax from erroring */ cr.peekCharNext() != '&')
                         {
                             cr.advanceChar();
 
                             // Parse localized string ID
-                            std::stringstream ss2(std::ios_base::app | std::ios_base::out);
-                            int charsRead = 0;
-                            while (cr.position < cr.length)
-                            {
-                                char curr = cr.peekChar();
-                                if ((curr >= '0' && curr <= '9') || (curr >= 'A' && curr <= 'F') || (curr >= 'a' && curr <= 'f'))
-                                {
-                                    cr.advanceChar();
-                                    ss2 << curr;
-                                    charsRead++;
-                                }
-                                else
-                                    break;
-                            }
+                            uint32_t base = cr.position;
+                            while (cr.position < cr.length && hasClass(cr.peekChar(), CharHexDigit))
+                                cr.advanceChar();
+                            uint32_t charsRead = cr.position - base;
                             if (charsRead != 8)
                             {
                                 // Invalid 32-bit value
-                                data = std::make_shared<StringData>(-1, cr.position);
-                                out.emplace_back(TokenType::Error, line, col);
+                                data = StringData(-1, cr.position);
+                                out.Add(TokenType::Error, start);
                             }
                             else
                             {
-                                int32_t id = std::stoul(ss2.str(), nullptr, 16);
-                                data = std::make_shared<StringData>(id, 0);
+                                int32_t id = std::stoul(std::string(in.substr(base, charsRead)), nullptr, 16);
+                                data = StringData(id, 0);
 
                                 // Increase max string ID if necessary
                                 if (id > ctx->maxStringId)
                                     ctx->maxStringId = id;
                             }
                         }
+                        TokenType stringType = (type == '"') ? TokenType::String : (type == '@') ? TokenType::MarkedString : TokenType::ExcludeString;
+                        if (macro != nullptr)
+                            out.AddString(stringType, start, content, data); // interpolated where the macro is used
                         else
-                            data = std::make_shared<StringData>(-1, cr.position);
-                        if (type == '"')
-                            out.emplace_back(TokenType::String, line, col, ss.str(), data);
-                        else if (type == '@')
-                            out.emplace_back(TokenType::MarkedString, line, col, ss.str(), data);
-                        else // if (type == '!')
-                            out.emplace_back(TokenType::ExcludeString, line, col, ss.str(), data);
+                            addString(stringType, start, content, data, ctx, out);
                     }
                     else
-                        out.emplace_back(TokenType::ErrorUnenclosedString, line, col);
+                        out.Add(TokenType::ErrorUnenclosedString, start);
                 }
                 else
                 {
-                    uint32_t line = cr.line;
-                    uint32_t col = cr.column;
+                    uint32_t start = cr.offset();
                     switch (curr)
                     {
                     case '(':
-                        out.emplace_back(TokenType::OpenParen, line, col);
+                        out.Add(TokenType::OpenParen, start);
                         break;
                     case ')':
-                        out.emplace_back(TokenType::CloseParen, line, col);
+                        out.Add(TokenType::CloseParen, start);
                         break;
                     case '{':
-                        out.emplace_back(TokenType::OpenCurly, line, col);
+                        out.Add(TokenType::OpenCurly, start);
                         break;
                     case '}':
-                        out.emplace_back(TokenType::CloseCurly, line, col);
+                        out.Add(TokenType::CloseCurly, start);
                         break;
                     case '[':
-                        out.emplace_back(TokenType::OpenBrack, line, col);
+                        out.Add(TokenType::OpenBrack, start);
                         break;
                     case ']':
-                        out.emplace_back(TokenType::CloseBrack, line, col);
+                        out.Add(TokenType::CloseBrack, start);
                         break;
                     case ';':
-                        out.emplace_back(TokenType::Semicolon, line, col);
+                        out.Add(TokenType::Semicolon, start);
                         break;
                     case ':':
-                        out.emplace_back(TokenType::Colon, line, col);
+                        out.Add(TokenType::Colon, start);
                         break;
                     case ',':
-                        out.emplace_back(TokenType::Comma, line, col);
+                        out.Add(TokenType::Comma, start);
                         break;
                     case '?':
-                        out.emplace_back(TokenType::Ternary, line, col);
+                        out.Add(TokenType::Ternary, start);
                         break;
                     case '$':
-                        out.emplace_back(TokenType::VariableStart, line, col);
+                        out.Add(TokenType::VariableStart, start);
                         break;
                     case '=':
                         if (cr.position + 1 < cr.length && cr.peekCharNext() == '=')
                         {
                             cr.advanceChar();
-                            out.emplace_back(TokenType::CompareEQ, line, col);
+                            out.Add(TokenType::CompareEQ, start);
                         }
                         else
-                            out.emplace_back(TokenType::Equals, line, col);
+                            out.Add(TokenType::Equals, start);
                         break;
                     case '+':
                         if (cr.position + 1 < cr.length)
@@ -672,18 +1141,18 @@ namespace diannex
                             if (n == '+')
                             {
                                 cr.advanceChar();
-                                out.emplace_back(TokenType::Increment, line, col);
+                                out.Add(TokenType::Increment, start);
                             }
                             else if (n == '=')
                             {
                                 cr.advanceChar();
-                                out.emplace_back(TokenType::PlusEquals, line, col);
+                                out.Add(TokenType::PlusEquals, start);
                             }
                             else
-                                out.emplace_back(TokenType::Plus, line, col);
+                                out.Add(TokenType::Plus, start);
                         }
                         else
-                            out.emplace_back(TokenType::Plus, line, col);
+                            out.Add(TokenType::Plus, start);
                         break;
                     case '-':
                         if (cr.position + 1 < cr.length)
@@ -692,23 +1161,23 @@ namespace diannex
                             if (n == '-')
                             {
                                 cr.advanceChar();
-                                out.emplace_back(TokenType::Decrement, line, col);
+                                out.Add(TokenType::Decrement, start);
                             }
                             else if (n == '=')
                             {
                                 cr.advanceChar();
-                                out.emplace_back(TokenType::MinusEquals, line, col);
+                                out.Add(TokenType::MinusEquals, start);
                             }
                             else if ((n >= '0' && n <= '9') || n == '.')
                             {
-                                cr.readNumber(curr, in, out);
+                                cr.readNumber(curr, out);
                                 continue; // skip advanceChar() call
                             }
                             else
-                                out.emplace_back(TokenType::Minus, line, col);
+                                out.Add(TokenType::Minus, start);
                         }
                         else
-                            out.emplace_back(TokenType::Minus, line, col);
+                            out.Add(TokenType::Minus, start);
                         break;
                     case '*':
                         if (cr.position + 1 < cr.length)
@@ -717,45 +1186,45 @@ namespace diannex
                             if (n == '*')
                             {
                                 cr.advanceChar();
-                                out.emplace_back(TokenType::Power, line, col);
+                                out.Add(TokenType::Power, start);
                             }
                             else if (n == '=')
                             {
                                 cr.advanceChar();
-                                out.emplace_back(TokenType::MultiplyEquals, line, col);
+                                out.Add(TokenType::MultiplyEquals, start);
                             }
                             else
-                                out.emplace_back(TokenType::Multiply, line, col);
+                                out.Add(TokenType::Multiply, start);
                         }
                         else
-                            out.emplace_back(TokenType::Multiply, line, col);
+                            out.Add(TokenType::Multiply, start);
                         break;
                     case '/':
                         if (cr.position + 1 < cr.length && cr.peekCharNext() == '=')
                         {
                             cr.advanceChar();
-                            out.emplace_back(TokenType::DivideEquals, line, col);
+                            out.Add(TokenType::DivideEquals, start);
                         }
                         else
-                            out.emplace_back(TokenType::Divide, line, col);
+                            out.Add(TokenType::Divide, start);
                         break;
                     case '%':
                         if (cr.position + 1 < cr.length && cr.peekCharNext() == '=')
                         {
                             cr.advanceChar();
-                            out.emplace_back(TokenType::ModEquals, line, col);
+                            out.Add(TokenType::ModEquals, start);
                         }
                         else
-                            out.emplace_back(TokenType::Mod, line, col);
+                            out.Add(TokenType::Mod, start);
                         break;
                     case '!': // doesn't apply to string literals; that's a special string type
                         if (cr.position + 1 < cr.length && cr.peekCharNext() == '=')
                         {
                             cr.advanceChar();
-                            out.emplace_back(TokenType::CompareNEQ, line, col);
+                            out.Add(TokenType::CompareNEQ, start);
                         }
                         else
-                            out.emplace_back(TokenType::Not, line, col);
+                            out.Add(TokenType::Not, start);
                         break;
                     case '>':
                         if (cr.position + 1 < cr.length)
@@ -764,18 +1233,18 @@ namespace diannex
                             if (n == '=')
                             {
                                 cr.advanceChar();
-                                out.emplace_back(TokenType::CompareGTE, line, col);
+                                out.Add(TokenType::CompareGTE, start);
                             }
                             else if (n == '>')
                             {
                                 cr.advanceChar();
-                                out.emplace_back(TokenType::BitwiseRShift, line, col);
+                                out.Add(TokenType::BitwiseRShift, start);
                             }
                             else
-                                out.emplace_back(TokenType::CompareGT, line, col);
+                                out.Add(TokenType::CompareGT, start);
                         }
                         else
-                            out.emplace_back(TokenType::CompareGT, line, col);
+                            out.Add(TokenType::CompareGT, start);
                         break;
                     case '<':
                         if (cr.position + 1 < cr.length)
@@ -784,18 +1253,18 @@ namespace diannex
                             if (n == '=')
                             {
                                 cr.advanceChar();
-                                out.emplace_back(TokenType::CompareLTE, line, col);
+                                out.Add(TokenType::CompareLTE, start);
                             }
                             else if (n == '<')
                             {
                                 cr.advanceChar();
-                                out.emplace_back(TokenType::BitwiseLShift, line, col);
+                                out.Add(TokenType::BitwiseLShift, start);
                             }
                             else
-                                out.emplace_back(TokenType::CompareLT, line, col);
+                                out.Add(TokenType::CompareLT, start);
                         }
                         else
-                            out.emplace_back(TokenType::CompareLT, line, col);
+                            out.Add(TokenType::CompareLT, start);
                         break;
                     case '&':
                         if (cr.position + 1 < cr.length)
@@ -804,18 +1273,18 @@ namespace diannex
                             if (n == '&')
                             {
                                 cr.advanceChar();
-                                out.emplace_back(TokenType::LogicalAnd, line, col);
+                                out.Add(TokenType::LogicalAnd, start);
                             }
                             else if (n == '=')
                             {
                                 cr.advanceChar();
-                                out.emplace_back(TokenType::BitwiseAndEquals, line, col);
+                                out.Add(TokenType::BitwiseAndEquals, start);
                             }
                             else
-                                out.emplace_back(TokenType::BitwiseAnd, line, col);
+                                out.Add(TokenType::BitwiseAnd, start);
                         }
                         else
-                            out.emplace_back(TokenType::BitwiseAnd, line, col);
+                            out.Add(TokenType::BitwiseAnd, start);
                         break;
                     case '|':
                         if (cr.position + 1 < cr.length)
@@ -824,91 +1293,88 @@ namespace diannex
                             if (n == '|')
                             {
                                 cr.advanceChar();
-                                out.emplace_back(TokenType::LogicalOr, line, col);
+                                out.Add(TokenType::LogicalOr, start);
                             }
                             else if (n == '=')
                             {
                                 cr.advanceChar();
-                                out.emplace_back(TokenType::BitwiseOrEquals, line, col);
+                                out.Add(TokenType::BitwiseOrEquals, start);
                             }
                             else
-                                out.emplace_back(TokenType::BitwiseOr, line, col);
+                                out.Add(TokenType::BitwiseOr, start);
                         }
                         else
-                            out.emplace_back(TokenType::BitwiseOr, line, col);
+                            out.Add(TokenType::BitwiseOr, start);
                         break;
                     case '^':
                         if (cr.position + 1 < cr.length && cr.peekCharNext() == '=')
                         {
                             cr.advanceChar();
-                            out.emplace_back(TokenType::BitwiseXorEquals, line, col);
+                            out.Add(TokenType::BitwiseXorEquals, start);
                         }
                         else
-                            out.emplace_back(TokenType::BitwiseXor, line, col);
+                            out.Add(TokenType::BitwiseXor, start);
                         break;
                     case '~':
-                        out.emplace_back(TokenType::BitwiseNegate, line, col);
+                        out.Add(TokenType::BitwiseNegate, start);
                         break;
                     default: 
                         // Must be an identifier of some type, or it's invalid
                         if (auto identifier = cr.readIdentifier())
                         {
-                            auto keyword = keywords.find(*identifier);
-                            if (keyword != keywords.end())
+                            if (const KeywordInfo* keyword = findKeyword(*identifier))
                             {
-                                // This is a built-in keyword; copy the token and assign line/column
-                                Token token = keyword->second;
-                                token.line = line;
-                                token.column = col;
-                                out.push_back(token);
+                                // This is a built-in keyword
+                                if (keyword->type == TokenType::Number)
+                                    out.AddNumber(keyword->type, start, parseNumber(keyword->content));
+                                else if (keyword->content != nullptr)
+                                    out.Add(keyword->type, start, keyword->content);
+                                else
+                                    out.Add(keyword->type, start, keyword->keywordType);
                             }
                             else
                             {
-                                auto macro = ctx->project->options.macros.find(*identifier);
-                                if (macro != ctx->project->options.macros.end())
+                                auto& projectMacros = ctx->project->options.macros;
+                                const LexedMacro* use = nullptr;
+                                if (macro != nullptr)
+                                {
+                                    // Lexing a macro ahead of time; leave other macros to be expanded wherever this one is used
+                                    if (projectMacros.find(std::string(*identifier)) != projectMacros.end())
+                                        macro->nested.emplace_back((uint32_t)out.tokens.size(), nullptr);
+                                }
+                                else if (!projectMacros.empty())
                                 {
-                                    // This is one of the project-defined macros; lex the macro in this context
-                                    bool createSet = (macros == nullptr);
-                                    if (createSet)
-                                        macros = new std::unordered_set<std::string>();
-
-                                    auto status = macros->insert(*identifier);
-                                    if (status.second)
-                                    {
-                                        // This isn't present in the macro chain yet, so we're safe to parse
-                                        LexString(macro->second, ctx, out, line, col, macros); // todo? maybe have a way to tell that line/col are inside a macro
-                                    }
-                                    else
-                                    {
-                                        // This is already present, signifying illegal recursive macro definitions
-                                        out.emplace_back(TokenType::Error, line, col, "recursive_macro");
-                                    }
-
-                                    if (createSet)
-                                    {
-                                        delete macros;
-                                        macros = nullptr;
-                                    }
-                                    else
-                                        macros->erase(*identifier);
+                                    if (ctx->macroCache == nullptr && localMacros == nullptr && projectMacros.find(std::string(*identifier)) != projectMacros.end())
+                                        localMacros = std::make_unique<MacroCache>(ctx->project);
+                                    const MacroCache* macroCache = (ctx->macroCache != nullptr) ? ctx->macroCache : localMacros.get();
+                                    if (macroCache != nullptr)
+                                        use = macroCache->Find(*identifier);
+                                }
+
+                                if (use != nullptr)
+                                {
+                                    // This is one of the project-defined macros; copy in its tokens, positioned where it's used
+                                    expandMacro(*use, ctx, out, start, macroChain, expression);
                                 }
                                 else
                                 {
                                     // This is a regular identifier
-                                    out.emplace_back(TokenType::Identifier, line, col, *identifier);
+                                    out.Add(TokenType::Identifier, start, *identifier);
                                 }
                             }
                         }
                         else
                         {
-                            out.emplace_back(TokenType::Error, line, col);
+                            out.Add(TokenType::Error, start);
 
                             // Ignore all further error tokens on this line
-                            uint32_t line = cr.line;
-                            while (cr.position < cr.length && cr.line == line)
+                            if (cr.position < cr.length)
                             {
+                                size_t count = out.tokens.size();
                                 cr.advanceChar();
                                 cr.skipWhitespace(out);
+                                if (out.tokens.size() == count) // no newline passed
+                                    cr.skipLine(out);
                             }
                         }
                         continue; // Skip the advanceChar call
@@ -919,71 +1385,71 @@ namespace diannex
 
             if (cr.directiveFollowup)
             {
-                Token t = out.back(); //  Get directive token
-                out.pop_back();
+                Token t = out.tokens.back(); //  Get directive token
+                out.tokens.pop_back();
                 cr.directiveFollowup = false;
 
                 if (t.keywordType == KeywordType::Include)
                 {
                     if (cr.skipWhitespace(out))
                     {
-                        out.emplace_back(TokenType::Error, cr.line, cr.column, "unexpected_eof");
+                        out.Add(TokenType::Error, cr.offset(), "unexpected_eof");
                         break;
                     }
 
                     char curr = cr.peekChar();
-                    uint32_t line = cr.line;
-                    uint16_t col = cr.column;
+                    uint32_t start = cr.offset();
 
                     if (curr != '"')
                     {
                         // Token wasn't a string like we expected, push an error token and try to continue
-                        out.emplace_back(TokenType::Error, line, col);
+                        out.Add(TokenType::Error, start);
                         continue;
                     }
 
                     cr.advanceChar();
 
-                    std::stringstream ss(std::ios_base::app | std::ios_base::out);
-                    bool foundEnd = false;
-                    while (cr.position < cr.length)
+                    uint32_t base = cr.position;
+                    cr.skipTo('"');
+                    if (cr.position >= cr.length)
                     {
-                        curr = cr.readChar();
-                        if (curr == '"')
-                        {
-                            foundEnd = true;
-                            break;
-                        }
-                        ss << curr;
+                        out.Add(TokenType::ErrorUnenclosedString, start);
+                        continue;
                     }
+                    std::string path(in.substr(base, cr.position - base));
+                    cr.advanceChar();
 
-                    if (!foundEnd)
+                    if (macro != nullptr)
                     {
-                        out.emplace_back(TokenType::ErrorUnenclosedString, line, col);
+                        // Resolved wherever the macro is used
+                        macro->includes.push_back(path);
                         continue;
                     }
+                    if (expression)
+                        continue; // nothing to include from inside a string
 
-                    fs::path p = fs::absolute(ctx->currentFile).parent_path();
-                    p /= ss.str();
+                    Trace::Span span(ctx->trace, "include", path);
+                    static DiskFileProvider disk;
+                    FileProvider* files = (ctx->fileProvider != nullptr) ? ctx->fileProvider : &disk;
 #if DIANNEX_OLD_INCLUDE_ORDER
-                    ctx->queue.push(p.string());
+                    ctx->queue.push(files->ResolveInclude(ctx->currentFile, path));
 #else
-                    includes.push_back(p.string());
+                    includes.push_back(files->ResolveInclude(ctx->currentFile, path));
 #endif
                 }
                 else if (t.keywordType == KeywordType::IfDef || t.keywordType == KeywordType::IfNDef)
                 {
                     if (cr.skipWhitespace(out))
                     {
-                        out.emplace_back(TokenType::Error, cr.line, cr.column, "unexpected_eof");
+                        out.Add(TokenType::Error, cr.offset(), "unexpected_eof");
                         break;
                     }
 
                     bool invert = t.keywordType == KeywordType::IfNDef;
-                    int line = cr.line, column = cr.column;
+                    uint32_t start = cr.offset();
                     if (auto identifier = cr.readIdentifier())
                     {
-                        bool skip = ctx->project->options.macros.find(*identifier) == ctx->project->options.macros.end();
+                        bool skip = ctx->project->options.macros.find(std::string(*identifier)) == ctx->project->options.macros.end();
                         if (invert) 
                             skip = !skip;
 
@@ -994,7 +1460,7 @@ namespace diannex
                     }
                     else
                     {
-                        out.emplace_back(TokenType::Error, line, column);
+                        out.Add(TokenType::Error, start);
                     }
                 }
                 else if (t.keywordType == KeywordType::EndIf)
@@ -1002,7 +1468,7 @@ namespace diannex
                     if (cr.stack > 0)
                         cr.stack--;
                     else
-                        out.emplace_back(TokenType::Error, t.line, t.column, "trailing_endif");
+                        out.Add(TokenType::Error, t.offset, "trailing_endif");
                 }
             }
         }
@@ -0,0 +1,80 @@
+#include "MemoryStats.h"
+
+#include <cstdlib>
+#include <new>
+
+/*
+    Counting replacements for the global allocation functions, for --memory.
+    Only linked into the executables, so programs embedding libdiannex keep their own allocator.
+*/
+
+void* operator new(std::size_t size)
+{
+    if (size == 0)
+        size = 1;
+    void* ptr;
+    while ((ptr = std::malloc(size)) == nullptr)
+    {
+        std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr)
+            throw std::bad_alloc();
+        handler();
+    }
+    diannex::MemoryStats::CountAllocation(ptr, size);
+    return ptr;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return operator new(size);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    if (ptr == nullptr)
+        return;
+    diannex::MemoryStats::CountFree(ptr);
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+    operator delete(ptr);
+}
@@ -0,0 +1,319 @@
+#include "MemoryStats.h"
+
+#include "Context.h"
+#include "Parser.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#include <malloc.h>
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#include <sys/resource.h>
+#else
+#include <malloc.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace diannex
+{
+    // Global counters, only updated while a MemoryStats exists, so normal builds only pay for one relaxed load
+    static std::atomic<bool> counting(false);
+    static std::atomic<uint64_t> allocations(0);
+    static std::atomic<uint64_t> frees(0);
+    static std::atomic<uint64_t> allocatedBytes(0);
+    static std::atomic<int64_t> liveBytes(0);
+
+    // Size of an allocated block, or 0 if the allocator can't tell
+    static size_t blockSize(void* ptr)
+    {
+#ifdef _WIN32
+        return _msize(ptr);
+#elif defined(__APPLE__)
+        return malloc_size(ptr);
+#elif defined(__GLIBC__) || defined(__linux__)
+        return malloc_usable_size(ptr);
+#else
+        return 0;
+#endif
+    }
+
+    bool MemoryStats::TracksLiveBytes()
+    {
+#if defined(_WIN32) || defined(__APPLE__) || defined(__GLIBC__) || defined(__linux__)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void MemoryStats::CountAllocation(void* ptr, size_t size)
+    {
+        if (!counting.load(std::memory_order_relaxed))
+            return;
+        size_t block = blockSize(ptr);
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        allocatedBytes.fetch_add(block != 0 ? block : size, std::memory_order_relaxed);
+        liveBytes.fetch_add(block, std::memory_order_relaxed);
+    }
+
+    void MemoryStats::CountFree(void* ptr)
+    {
+        if (!counting.load(std::memory_order_relaxed))
+            return;
+        frees.fetch_add(1, std::memory_order_relaxed);
+        liveBytes.fetch_sub(blockSize(ptr), std::memory_order_relaxed);
+    }
+
+    static MemoryStats::Counters currentCounters()
+    {
+        MemoryStats::Counters res;
+        res.allocations = allocations.load(std::memory_order_relaxed);
+        res.frees = frees.load(std::memory_order_relaxed);
+        res.bytes = allocatedBytes.load(std::memory_order_relaxed);
+        res.live = liveBytes.load(std::memory_order_relaxed);
+        return res;
+    }
+
+    // Current and peak resident set size of the process, in bytes (0 where unknown)
+    static void residentMemory(uint64_t& current, uint64_t& peak)
+    {
+        current = 0;
+        peak = 0;
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters;
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        {
+            current = counters.WorkingSetSize;
+            peak = counters.PeakWorkingSetSize;
+        }
+#else
+        rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) == 0)
+        {
+#ifdef __APPLE__
+            peak = usage.ru_maxrss; // bytes
+#else
+            peak = (uint64_t)usage.ru_maxrss * 1024; // kilobytes
+#endif
+        }
+#ifdef __linux__
+        std::ifstream statm("/proc/self/statm");
+        uint64_t size, resident;
+        if (statm >> size >> resident)
+            current = resident * sysconf(_SC_PAGESIZE);
+#endif
+#endif
+        // The two are sampled separately, and may be counted slightly differently
+        if (peak < current)
+            peak = current;
+    }
+
+    MemoryStats::Counters& MemoryStats::Counters::operator+=(const Counters& other)
+    {
+        allocations += other.allocations;
+        frees += other.frees;
+        bytes += other.bytes;
+        live += other.live;
+        return *this;
+    }
+
+    MemoryStats::Counters& MemoryStats::Counters::operator-=(const Counters& other)
+    {
+        allocations -= other.allocations;
+        frees -= other.frees;
+        bytes -= other.bytes;
+        live -= other.live;
+        return *this;
+    }
+
+    MemoryStats::Sampler::Sampler()
+        : start(currentCounters())
+    {
+    }
+
+    MemoryStats::Counters MemoryStats::Sampler::Stop()
+    {
+        Counters res = currentCounters();
+        res -= start;
+        return res;
+    }
+
+    MemoryStats::MemoryStats()
+    {
+        counting.store(true, std::memory_order_relaxed);
+    }
+
+    MemoryStats::~MemoryStats()
+    {
+        counting.store(false, std::memory_order_relaxed);
+    }
+
+    void MemoryStats::AddPhase(Timings::Phase phase, const Counters& counters)
+    {
+        PhaseStats& stats = phases[(int)phase];
+        stats.recorded = true;
+        stats.counters += counters;
+        residentMemory(stats.rss, stats.peakRss);
+    }
+
+    const MemoryStats::Counters& MemoryStats::GetPhase(Timings::Phase phase)
+    {
+        return phases[(int)phase].counters;
+    }
+
+    void MemoryStats::AddContainer(const std::string& name, uint64_t items, uint64_t bytes)
+    {
+        containers.push_back({ name, items, bytes });
+    }
+
+    /*
+        Size estimates. These follow the usual layouts of the standard library, and ignore allocator overhead.
+    */
+
+    static uint64_t stringHeap(const std::string& str)
+    {
+        // Short strings live inside the object itself
+        const char* data = str.data();
+        if (data >= (const char*)&str && data < (const char*)(&str + 1))
+            return 0;
+        return str.capacity() + 1;
+    }
+
+    template<typename T>
+    static uint64_t vectorHeap(const std::vector<T>& vec)
+    {
+        return vec.capacity() * sizeof(T);
+    }
+
+    template<typename Map>
+    static uint64_t hashHeap(const Map& map)
+    {
+        // One node per element (with its next pointer and cached hash), plus the bucket array
+        return map.size() * (sizeof(typename Map::value_type) + 2 * sizeof(void*)) + map.bucket_count() * sizeof(void*);
+    }
+
+    static uint64_t countNodes(const Node* node)
+    {
+        if (node == nullptr)
+            return 0;
+        uint64_t res = 1;
+        for (const Node* child : node->nodes)
+            res += countNodes(child);
+        return res;
+    }
+
+    void MemoryStats::MeasureContext(CompileContext* ctx)
+    {
+        uint64_t items = 0, bytes = vectorHeap(ctx->tokenList);
+        for (auto& pair : ctx->tokenList)
+        {
+            items += pair.second.tokens.size();
+            bytes += stringHeap(pair.first) + pair.second.HeapSize();
+        }
+        AddContainer("tokenList", items, bytes);
+
+        items = 0;
+        bytes = vectorHeap(ctx->parseList);
+        for (auto& pair : ctx->parseList)
+        {
+            bytes += stringHeap(pair.first);
+            if (pair.second != nullptr)
+            {
+                items += countNodes(pair.second->baseNode);
+                bytes += sizeof(ParseResult) + vectorHeap(pair.second->errors) + pair.second->arena.HeapSize();
+            }
+        }
+        AddContainer("parseList (AST nodes)", items, bytes);
+
+        bytes = vectorHeap(ctx->bytecode);
+        for (const Instruction& instr : ctx->bytecode)
+        {
+            if (instr.opcode == Instruction::Opcode::PATCH_CALL && instr.vec != nullptr)
+                bytes += sizeof(*instr.vec) + vectorHeap(*instr.vec);
+        }
+        AddContainer("bytecode", ctx->bytecode.size(), bytes);
+
+        bytes = vectorHeap(ctx->internalStrings) + hashHeap(ctx->internalStringsMap) + hashHeap(ctx->internalSymbolsMap);
+        for (const std::string& str : ctx->internalStrings)
+            bytes += 2 * stringHeap(str); // once in the list, once as a map key
+        AddContainer("internalStrings", ctx->internalStrings.size(), bytes);
+
+        bytes = vectorHeap(ctx->translationInfo);
+        for (const TranslationInfo& info : ctx->translationInfo)
+            bytes += stringHeap(info.key) + stringHeap(info.text);
+        AddContainer("translationInfo", ctx->translationInfo.size(), bytes);
+
+        bytes = hashHeap(ctx->sceneBytecode) + hashHeap(ctx->functionBytecode) + hashHeap(ctx->definitionBytecode) +
+                vectorHeap(ctx->definedSymbols);
+        for (auto& pair : ctx->sceneBytecode)
+            bytes += vectorHeap(pair.second);
+        for (auto& pair : ctx->functionBytecode)
+            bytes += vectorHeap(pair.second);
+        for (auto& pair : ctx->definitionBytecode)
+        {
+            if (std::holds_alternative<std::string>(pair.second.first))
+                bytes += stringHeap(std::get<std::string>(pair.second.first));
+        }
+        AddContainer("symbols", ctx->sceneBytecode.size() + ctx->functionBytecode.size() + ctx->definitionBytecode.size(), bytes);
+        AddContainer("symbol names", Symbols::Count(), Symbols::HeapSize());
+    }
+
+    static double megabytes(double bytes)
+    {
+        return bytes / (1024.0 * 1024.0);
+    }
+
+    void MemoryStats::Print(std::ostream& s)
+    {
+        bool live = TracksLiveBytes();
+
+        s << std::fixed << std::setprecision(2);
+        s << std::endl << "Memory by phase (MB):" << std::endl;
+        s << "  " << std::left << std::setw(14) << "phase" << std::right << std::setw(10) << "rss" << std::setw(10) << "peak"
+          << std::setw(12) << "allocs" << std::setw(12) << "allocated" << std::setw(10) << "net" << std::endl;
+        Counters total;
+        for (int i = 0; i < (int)Timings::Phase::Count; i++)
+        {
+            const PhaseStats& stats = phases[i];
+            if (!stats.recorded)
+                continue;
+            s << "  " << std::left << std::setw(14) << Timings::PhaseName((Timings::Phase)i) << std::right;
+            if (i == (int)Timings::Phase::Compression)
+                s << std::setw(10) << "-" << std::setw(10) << "-"; // measured in the middle of the binary phase
+            else
+                s << std::setw(10) << megabytes(stats.rss) << std::setw(10) << megabytes(stats.peakRss);
+            s << std::setw(12) << stats.counters.allocations << std::setw(12) << megabytes(stats.counters.bytes);
+            if (live)
+                s << std::setw(10) << megabytes(stats.counters.live);
+            s << std::endl;
+            total += stats.counters;
+        }
+        s << "  " << std::left << std::setw(34) << "total" << std::right
+          << std::setw(12) << total.allocations << std::setw(12) << megabytes(total.bytes);
+        if (live)
+            s << std::setw(10) << megabytes(total.live);
+        s << std::endl;
+
+        if (!containers.empty())
+        {
+            s << std::endl << "Estimated container sizes:" << std::endl;
+            s << "  " << std::left << std::setw(28) << "container" << std::right << std::setw(12) << "items" << std::setw(10) << "MB" << std::endl;
+            for (const Container& container : containers)
+            {
+                s << "  " << std::left << std::setw(28) << container.name << std::right
+                  << std::setw(12) << container.items << std::setw(10) << megabytes(container.bytes) << std::endl;
+            }
+        }
+
+        s.unsetf(std::ios_base::floatfield);
+        s << std::setprecision(6);
+    }
+}
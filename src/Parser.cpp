@@ -1,125 +1,72 @@
 #include "Parser.h"
 #include "ParseResult.h"
 
-#include <sstream>
 
 namespace diannex
 {
     ParseResult::~ParseResult()
     {
-        if (doDelete)
-            delete baseNode;
     }
 
     /*
         Base parser
     */
 
-    ParseResult* Parser::ParseTokens(CompileContext* ctx, std::vector<Token>* tokens)
+    ParseResult* Parser::ParseTokens(CompileContext* ctx, TokenList* tokens)
     {
-        Parser parser = Parser(ctx, tokens);
+        ParseResult* res = new ParseResult();
+        Parser parser = Parser(ctx, tokens, &res->arena);
         parser.skipNewlines();
-        return new ParseResult { Node::ParseGroupBlock(&parser, false), parser.errors };
+        res->baseNode = Node::ParseGroupBlock(&parser, false);
+        res->errors = std::move(parser.errors);
+        return res;
     }
 
-    ParseResult Parser::ParseTokensExpression(CompileContext* ctx, std::vector<Token>* tokens, uint32_t defaultLine, uint16_t defaultColumn)
+    Node* Parser::ParseTokensExpression(CompileContext* ctx, TokenList* tokens, int begin, int end, const LineIndex* lines, uint32_t defaultOffset,
+                                        Arena* arena, std::vector<ParseError>& errors)
     {
-        Parser parser = Parser(ctx, tokens);
-        parser.defaultLine = defaultLine;
-        parser.defaultColumn = defaultColumn;
+        Parser parser = Parser(ctx, tokens, arena, begin, end);
+        parser.lines = lines;
+        parser.defaultLine = lines->Line(defaultOffset);
+        parser.defaultColumn = lines->Column(defaultOffset);
         parser.skipNewlines();
-        return { Node::ParseExpression(&parser), parser.errors };
+        Node* expr = Node::ParseExpression(&parser);
+        errors.insert(errors.end(), parser.errors.begin(), parser.errors.end());
+        return expr;
     }
 
-    const std::string Parser::ProcessStringInterpolation(Parser* parser, Token& token, const std::string& input, std::vector<class Node*>* nodeList)
+    std::string_view Parser::ProcessStringInterpolation(Parser* parser, Token& token, std::string_view input, ArenaVector<Node*>* nodeList)
     {
-        if (!parser->context->project->options.interpolationEnabled)
-            return input;
-
-        // Build the new string result as well as parse expressions
-        std::stringstream ss(std::ios_base::app | std::ios_base::out);
-        int pos = 0, len = input.length();
-        int interpCount = 0;
-        int line = token.line, col = token.column + ((token.type == TokenType::String) ? 1 : 2);
-        while (pos < len)
+        // Copied first, as parsing the expressions can add to the text of the token lists
+        std::string_view res = parser->arena->Copy(input);
+
+        // The lexer has already replaced each expression with its index, and lexed it to the side
+        uint32_t count;
+        const TokenList::Interpolation* interpolations = parser->tokens->GetInterpolations(token, count);
+        for (uint32_t i = 0; i < count; i++)
         {
-            char curr = input.at(pos);
-            if (curr == '$' && pos + 1 < len && input.at(pos + 1) == '{')
-            {
-                bool parse = false;
-                if (pos != 0)
-                {
-                    if (input.at(pos - 1) != '\\')
-                        parse = true;
-                    else
-                        ss << curr;
-                }
-                else
-                    parse = true;
+            const TokenList::Interpolation& expr = interpolations[i];
+            size_t errorCount = parser->errors.size();
+            Node* node = Parser::ParseTokensExpression(parser->context, parser->tokens->interpolated.get(), expr.begin, expr.end, parser->lines, expr.offset,
+                                                       parser->arena, parser->errors);
+            if (parser->errors.size() == errorCount)
+                nodeList->push_back(node);
+        }
 
-                if (parse)
-                {
-                    // Extract the substring
-                    pos += 2;
-                    col += 2;
-                    int count = 0;
-                    int tempLine = line, tempCol = col;
-                    int startPos = pos;
-                    while (pos < len && input.at(pos) != '}')
-                    {
-                        pos++;
-                        count++;
-                        if (input.at(pos) == '\n')
-                        {
-                            tempLine++;
-                            tempCol = 0;
-                        }
-                        else
-                            tempCol++;
-                    }
-                    std::string exprStr = input.substr(startPos, count);
-
-                    // Parse expression and add to nodes
-                    std::vector<Token> tokens;
-                    Lexer::LexString(exprStr, parser->context, tokens, line, col);
-                    ParseResult parsed = Parser::ParseTokensExpression(parser->context, &tokens, line, col);
-                    if (parsed.errors.size() != 0)
-                        parser->errors.insert(parser->errors.end(), parsed.errors.begin(), parsed.errors.end());
-                    else
-                    {
-                        nodeList->push_back(parsed.baseNode);
-                        parsed.doDelete = false;
-                    }
+        return res;
+    }
 
-                    // Also add the proper string representation
-                    ss << "${" << interpCount++ << "}";
-                    line = tempLine;
-                    col = tempCol + 1;
-                }
-            }
-            else
-            {
-                if (curr == '\n')
-                {
-                    line++;
-                    col = 0;
-                }
-                else
-                    col++;
-                ss << curr;
-            }
-            pos++;
-        }
-        
-        return ss.str();
+    Parser::Parser(CompileContext* ctx, TokenList* tokens, Arena* arena)
+        : Parser(ctx, tokens, arena, 0, tokens->tokens.size())
+    {
     }
 
-    Parser::Parser(CompileContext* ctx, std::vector<Token>* tokens)
-        : context(ctx), tokens(tokens)
+    Parser::Parser(CompileContext* ctx, TokenList* tokens, Arena* arena, int begin, int end)
+        : context(ctx), lines(&tokens->lines), arena(arena), tokens(tokens)
     {
-        tokenCount = tokens->size();
-        position = 0;
-        storedPosition = 0;
+        tokenCount = end;
+        position = begin;
+        storedPosition = begin;
         errors = std::vector<ParseError>();
     }
 
@@ -180,37 +127,43 @@ namespace diannex
         }
     }
 
+    // Reading past the end of this parser's range fails like reading past the end of the list
+    inline const Token& Parser::tokenAt(int index)
+    {
+        return tokens->tokens.at((index < tokenCount) ? index : tokens->tokens.size());
+    }
+
     inline bool Parser::isNextToken(TokenType type)
     {
-        return tokens->at(position).type == type;
+        return tokenAt(position).type == type;
     }
 
-    inline Token Parser::previousToken()
+    inline const Token& Parser::previousToken()
     {
-        return tokens->at(position - 1);
+        return tokenAt(position - 1);
     }
 
-    inline Token Parser::peekToken()
+    inline const Token& Parser::peekToken()
     {
-        return tokens->at(position);
+        return tokenAt(position);
     }
 
     Token Parser::ensureToken(TokenType type)
     {
         if (position == tokenCount)
         {
-            errors.push_back({ ParseError::ErrorType::ExpectedTokenButEOF, defaultLine, defaultColumn, tokenToString(Token(type, 0, 0)) });
-            return Token(TokenType::Error, 0, 0, "unexpected_eof");
+            errors.push_back({ ParseError::ErrorType::ExpectedTokenButEOF, defaultLine, defaultColumn, tokenToString(Token(type)) });
+            return tokens->Make(TokenType::Error, Token::NoOffset, "unexpected_eof");
         }
 
-        Token t = tokens->at(position);
+        const Token& t = tokenAt(position);
         advance();
         if (t.type == type)
             return t;
         else
         {
-            errors.push_back({ ParseError::ErrorType::ExpectedTokenButGot, t.line, t.column, tokenToString(Token(type, 0, 0)), tokenToString(t) });
-            return Token(TokenType::Error, 0, 0);
+            errors.push_back({ ParseError::ErrorType::ExpectedTokenButGot, tokenLine(t), tokenColumn(t), tokenToString(Token(type)), tokenToString(t) });
+            return Token(TokenType::Error);
         }
     }
 
@@ -218,18 +171,18 @@ namespace diannex
     {
         if (position == tokenCount)
         {
-            errors.push_back({ ParseError::ErrorType::ExpectedTokenButEOF, defaultLine, defaultColumn, tokenToString(Token(type, 0, 0)) });
-            return Token(TokenType::Error, 0, 0, "unexpected_eof");
+            errors.push_back({ ParseError::ErrorType::ExpectedTokenButEOF, defaultLine, defaultColumn, tokenToString(Token(type)) });
+            return tokens->Make(TokenType::Error, Token::NoOffset, "unexpected_eof");
         }
 
-        Token t = tokens->at(position);
+        const Token& t = tokenAt(position);
         advance();
         if (t.type == type || t.type == type2)
             return t;
         else
         {
-            errors.push_back({ ParseError::ErrorType::ExpectedTokenButGot, t.line, t.column, tokenToString(Token(type, 0, 0)), tokenToString(t) });
-            return Token(TokenType::Error, 0, 0);
+            errors.push_back({ ParseError::ErrorType::ExpectedTokenButGot, tokenLine(t), tokenColumn(t), tokenToString(Token(type)), tokenToString(t) });
+            return Token(TokenType::Error);
         }
     }
 
@@ -237,97 +190,120 @@ namespace diannex
     {
         if (position == tokenCount)
         {
-            errors.push_back({ ParseError::ErrorType::ExpectedTokenButEOF, defaultLine, defaultColumn, tokenToString(Token(type, 0, 0, keywordType)) });
-            return Token(TokenType::Error, 0, 0, "unexpected_eof");
+            errors.push_back({ ParseError::ErrorType::ExpectedTokenButEOF, defaultLine, defaultColumn, tokenToString(Token(type, Token::NoOffset, keywordType)) });
+            return tokens->Make(TokenType::Error, Token::NoOffset, "unexpected_eof");
         }
 
-        Token t = tokens->at(position);
+        const Token& t = tokenAt(position);
         advance();
         if (t.type == type && t.keywordType == keywordType)
             return t;
         else
         {
-            errors.push_back({ ParseError::ErrorType::ExpectedTokenButGot, t.line, t.column,
-                                tokenToString(Token(type, 0, 0, keywordType)), tokenToString(t) });
-            return Token(TokenType::Error, 0, 0);
+            errors.push_back({ ParseError::ErrorType::ExpectedTokenButGot, tokenLine(t), tokenColumn(t),
+                                tokenToString(Token(type, Token::NoOffset, keywordType)), tokenToString(t) });
+            return Token(TokenType::Error);
         }
     }
 
-    bool Parser::checkErrorToken(Token& t)
+    bool Parser::checkErrorToken(const Token& t)
     {
         if (t.type == TokenType::Error)
         {
+            std::string_view kind = content(t);
             const char* info = nullptr;
-            if (t.content.compare("recursive_macro") == 0)
+            if (kind == "recursive_macro")
                 info = "Recursive macro definition.";
-            else if (t.content.compare("unexpected_eof") == 0)
+            else if (kind == "unexpected_eof")
                 info = "Unexpected EOF.";
-            else if (t.content.compare("trailing_endif") == 0)
+            else if (kind == "trailing_endif")
                 info = "Trailing #endif.";
             if (info != nullptr)
             {
-                errors.push_back({ ParseError::ErrorType::ErrorToken, t.line, t.column, info });
+                errors.push_back({ ParseError::ErrorType::ErrorToken, tokenLine(t), tokenColumn(t), info });
                 return true;
             }
         }
         return false;
     }
 
+    std::string_view Parser::content(const Token& t)
+    {
+        return tokens->Content(t);
+    }
+
+    std::optional<StringData> Parser::stringData(const Token& t)
+    {
+        const StringData* data = tokens->GetStringData(t);
+        return (data != nullptr) ? std::optional<StringData>(*data) : std::nullopt;
+    }
+
+    NumberData Parser::number(const Token& t)
+    {
+        return tokens->GetNumberData(t);
+    }
+
     /*
         General-purpose nodes
     */
 
-    Node::Node(NodeType type)
-        : type(type)
+    Node::Node(Arena& arena, NodeType type)
+        : type(type), nodes(arena)
+    {
+    }
+
+    NodeContent::NodeContent(Arena& arena, Token token, std::string_view content, NodeType type)
+        : Node(arena, type), content(arena.Copy(content)), token(token)
     {
-        this->nodes = std::vector<Node*>();
     }
 
-    Node::~Node()
+    NodeContent::NodeContent(Arena& arena, std::string_view content, NodeType type)
+        : Node(arena, type), content(arena.Copy(content)), token(TokenType::Error)
     {
-        for (Node* s : nodes)
-            delete s;
     }
 
-    NodeContent::NodeContent(Token token, NodeType type) : Node(type), content(token.content), token(token)
+    NodeText::NodeText(Arena& arena, NodeType type, std::string_view content, std::optional<StringData> stringData, bool excludeTranslation)
+        : NodeContent(arena, content, type), stringData(stringData), excludeTranslation(excludeTranslation)
     {
     }
 
-    NodeContent::NodeContent(std::string content, NodeType type) : Node(type), content(content), token(Token(TokenType::Error, 0, 0, content))
+    NodeText::NodeText(Arena& arena, std::string_view content, std::optional<StringData> stringData, bool excludeTranslation)
+        : NodeContent(arena, content, NodeType::TextRun), stringData(stringData), excludeTranslation(excludeTranslation)
     {
     }
 
-    NodeText::NodeText(NodeType type, std::string content, std::shared_ptr<StringData> stringData, bool excludeTranslation)
-        : NodeContent(content, type), stringData(stringData), excludeTranslation(excludeTranslation)
+    NodeToken::NodeToken(Arena& arena, NodeType type, Token token)
+        : Node(arena, type), token(token)
     {
     }
 
-    NodeText::NodeText(std::string content, std::shared_ptr<StringData> stringData, bool excludeTranslation)
-        : NodeContent(content, NodeType::TextRun), stringData(stringData), excludeTranslation(excludeTranslation)
+    NodeToken::NodeToken(Arena& arena, NodeType type, Token token, std::string_view content, std::optional<StringData> stringData)
+        : Node(arena, type), token(token), content(arena.Copy(content)), stringData(stringData)
     {
     }
 
-    NodeToken::NodeToken(NodeType type, Token token)
-        : Node(type), token(token)
+    NodeToken::NodeToken(Arena& arena, NodeType type, Token token, NumberData number)
+        : Node(arena, type), token(token), number(number)
     {
     }
 
-    NodeTokenModifier::NodeTokenModifier(NodeType type, Token token, KeywordType modifier)
-        : Node(type), token(token), modifier(modifier)
+    NodeTokenModifier::NodeTokenModifier(Arena& arena, NodeType type, Token token, KeywordType modifier)
+        : Node(arena, type), token(token), modifier(modifier)
     {
     }
 
-    NodeScene::NodeScene(Token token) : NodeContent(token, NodeType::Scene)
+    NodeScene::NodeScene(Arena& arena, Token token, std::string_view name)
+        : NodeContent(arena, token, name, NodeType::Scene), flags(arena)
     {
     }
 
-    NodeFunc::NodeFunc(Token token, KeywordType modifier)
-        : Node(NodeType::Function), name(token.content), modifier(modifier), token(token)
+    NodeFunc::NodeFunc(Arena& arena, Token token, std::string_view name, KeywordType modifier)
+        : Node(arena, NodeType::Function), name(arena.Copy(name)), token(token), modifier(modifier), args(arena), flags(arena)
     {
     }
 
-    NodeFunc::NodeFunc(std::string name, KeywordType modifier)
-        : Node(NodeType::Function), name(name), modifier(modifier), token(TokenType::Error, 0, 0, name)
+    NodeFunc::NodeFunc(Arena& arena, std::string_view name, KeywordType modifier)
+        : Node(arena, NodeType::Function), name(arena.Copy(name)), token(TokenType::Error), modifier(modifier), args(arena), flags(arena)
     {
     }
 
@@ -342,10 +318,10 @@ namespace diannex
         if (isNamespace)
         {
             parser->ensureToken(TokenType::OpenCurly);
-            res = new NodeContent("", NodeType::Block);
+            res = parser->make<NodeContent>("", NodeType::Block);
         } 
         else
-            res = new Node(NodeType::Block);
+            res = parser->make<Node>(NodeType::Block);
 
         parser->skipNewlines();
 
@@ -363,11 +339,13 @@ namespace diannex
         return res;
     }
 
-    Node* Node::ParseNamespaceBlock(Parser* parser, std::string name)
+    Node* Node::ParseNamespaceBlock(Parser* parser, Token name)
     {
+        // Copied first, as making tokens while parsing the block can move the list's text
+        std::string_view content = parser->arena->Copy(parser->content(name));
         NodeContent* res = (NodeContent*)Node::ParseGroupBlock(parser, true);
         res->type = NodeType::Namespace;
-        res->content = name;
+        res->content = content;
         return res;
     }
 
@@ -387,11 +365,11 @@ namespace diannex
                     if (t.keywordType != KeywordType::Func)
                     {
                         if (modifier != KeywordType::None)
-                            parser->errors.push_back({ ParseError::ErrorType::UnexpectedModifierFor, t.line, t.column, tokenToString(t) });
+                            parser->errors.push_back({ ParseError::ErrorType::UnexpectedModifierFor, parser->tokenLine(t), parser->tokenColumn(t), tokenToString(t) });
                         switch (t.keywordType)
                         {
                         case KeywordType::Namespace:
-                            return Node::ParseNamespaceBlock(parser, name.content);
+                            return Node::ParseNamespaceBlock(parser, name);
                         case KeywordType::Scene:
                             return Node::ParseSceneBlock(parser, name);
                         case KeywordType::Def:
@@ -408,8 +386,8 @@ namespace diannex
                 else
                 {
                     parser->checkErrorToken(name);
-                    parser->errors.push_back({ ParseError::ErrorType::ExpectedTokenButGot, t.line, t.column,
-                                                tokenToString(Token(TokenType::Identifier, 0, 0)), tokenToString(name) });
+                    parser->errors.push_back({ ParseError::ErrorType::ExpectedTokenButGot, parser->tokenLine(t), parser->tokenColumn(t),
+                                                tokenToString(Token(TokenType::Identifier)), tokenToString(name) });
                     parser->synchronize();
                 }
             }
@@ -424,14 +402,14 @@ namespace diannex
             if (modifier != KeywordType::None)
             {
                 parser->checkErrorToken(t);
-                parser->errors.push_back({ ParseError::ErrorType::UnexpectedModifierFor, t.line, t.column, tokenToString(t) });
+                parser->errors.push_back({ ParseError::ErrorType::UnexpectedModifierFor, parser->tokenLine(t), parser->tokenColumn(t), tokenToString(t) });
             }
             parser->advance();
-            return new NodeContent(t, NodeType::MarkedComment);
+            return parser->make<NodeContent>(t, parser->content(t), NodeType::MarkedComment);
 
         default:
             if (!parser->checkErrorToken(t))
-                parser->errors.push_back({ ParseError::ErrorType::UnexpectedToken, t.line, t.column, tokenToString(t) });
+                parser->errors.push_back({ ParseError::ErrorType::UnexpectedToken, parser->tokenLine(t), parser->tokenColumn(t), tokenToString(t) });
             parser->synchronize();
             break;
         }
@@ -448,7 +426,7 @@ namespace diannex
     {
         if (parser->isNextToken(TokenType::Colon))
         {
-            std::unordered_set<std::string> flagNames;
+            std::unordered_set<std::string_view> flagNames; // views into the arena
             do
             {
                 parser->advance();
@@ -457,12 +435,9 @@ namespace diannex
                 Token name = parser->ensureToken(TokenType::Identifier);
                 parser->skipNewlines();
 
-                if (flagNames.find(name.content) != flagNames.end())
-                    parser->errors.push_back({ ParseError::ErrorType::DuplicateFlagName, name.line, name.column });
-                else
-                    flagNames.insert(name.content);
-
-                NodeContent* flag = new NodeContent(name, Node::NodeType::Flag);
+                NodeContent* flag = parser->make<NodeContent>(name, parser->content(name), Node::NodeType::Flag);
+                if (!flagNames.insert(flag->content).second)
+                    parser->errors.push_back({ ParseError::ErrorType::DuplicateFlagName, parser->tokenLine(name), parser->tokenColumn(name) });
 
                 parser->ensureToken(TokenType::OpenParen);
                 parser->skipNewlines();
@@ -490,7 +465,7 @@ namespace diannex
 
     Node* Node::ParseFunctionBlock(Parser* parser, Token name, KeywordType modifier)
     {
-        NodeFunc* res = new NodeFunc(name, modifier);
+        NodeFunc* res = parser->make<NodeFunc>(name, parser->content(name), modifier);
 
         // Parse arguments
         parser->ensureToken(TokenType::OpenParen);
@@ -498,7 +473,8 @@ namespace diannex
         parser->skipNewlines();
         while (parser->isMore() && !parser->isNextToken(TokenType::CloseParen))
         {
-            res->args.push_back(parser->ensureToken(TokenType::Identifier));
+            Token arg = parser->ensureToken(TokenType::Identifier);
+            res->args.push_back(parser->arena->Copy(parser->content(arg)));
             parser->skipNewlines();
             if (parser->isNextToken(TokenType::Comma))
             {
@@ -533,7 +509,7 @@ namespace diannex
 
     Node* Node::ParseSceneBlock(Parser* parser)
     {
-        Node* res = new Node(NodeType::SceneBlock);
+        Node* res = parser->make<Node>(NodeType::SceneBlock);
 
         parser->ensureToken(TokenType::OpenCurly);
 
@@ -554,7 +530,7 @@ namespace diannex
 
     Node* Node::ParseSceneBlock(Parser* parser, Token name)
     {
-        NodeScene* res = new NodeScene(name);
+        NodeScene* res = parser->make<NodeScene>(name, parser->content(name));
 
         parseFlagDefinitions(parser, res);
 
@@ -590,8 +566,8 @@ namespace diannex
             case TokenType::Increment:
             {
                 if (modifier != KeywordType::None)
-                    parser->errors.push_back({ ParseError::ErrorType::UnexpectedModifierFor, t.line, t.column, tokenToString(t) });
-                Node* res = new Node(NodeType::Increment);
+                    parser->errors.push_back({ ParseError::ErrorType::UnexpectedModifierFor, parser->tokenLine(t), parser->tokenColumn(t), tokenToString(t) });
+                Node* res = parser->make<Node>(NodeType::Increment);
                 parser->advance();
                 res->nodes.push_back(variable);
                 return res;
@@ -599,8 +575,8 @@ namespace diannex
             case TokenType::Decrement:
             {
                 if (modifier != KeywordType::None)
-                    parser->errors.push_back({ ParseError::ErrorType::UnexpectedModifierFor, t.line, t.column, tokenToString(t) });
-                Node* res = new Node(NodeType::Decrement);
+                    parser->errors.push_back({ ParseError::ErrorType::UnexpectedModifierFor, parser->tokenLine(t), parser->tokenColumn(t), tokenToString(t) });
+                Node* res = parser->make<Node>(NodeType::Decrement);
                 parser->advance();
                 res->nodes.push_back(variable);
                 return res;
@@ -614,12 +590,12 @@ namespace diannex
             case TokenType::BitwiseOrEquals:
             case TokenType::BitwiseXorEquals:
                 if (modifier != KeywordType::None)
-                    parser->errors.push_back({ ParseError::ErrorType::UnexpectedModifierFor, t.line, t.column, tokenToString(t) });
+                    parser->errors.push_back({ ParseError::ErrorType::UnexpectedModifierFor, parser->tokenLine(t), parser->tokenColumn(t), tokenToString(t) });
                 [[fallthrough]];
             case TokenType::Semicolon:
             case TokenType::Equals:
             {
-                NodeTokenModifier* res = new NodeTokenModifier(NodeType::Assign, t, modifier);
+                NodeTokenModifier* res = parser->make<NodeTokenModifier>(NodeType::Assign, t, modifier);
                 res->nodes.push_back(variable);
 
                 parser->advance();
@@ -630,7 +606,7 @@ namespace diannex
             }
             default:
                 if (!parser->checkErrorToken(t))
-                    parser->errors.push_back({ ParseError::ErrorType::UnexpectedToken, t.line, t.column, tokenToString(t) });
+                    parser->errors.push_back({ ParseError::ErrorType::UnexpectedToken, parser->tokenLine(t), parser->tokenColumn(t), tokenToString(t) });
                 parser->synchronize();
                 break;
             }
@@ -639,7 +615,7 @@ namespace diannex
         {
             // Parse everything else
             if (modifier != KeywordType::None)
-                parser->errors.push_back({ ParseError::ErrorType::UnexpectedModifierFor, t.line, t.column, tokenToString(t) });
+                parser->errors.push_back({ ParseError::ErrorType::UnexpectedModifierFor, parser->tokenLine(t), parser->tokenColumn(t), tokenToString(t) });
             switch (t.type)
             {
             case TokenType::Identifier:
@@ -650,7 +626,7 @@ namespace diannex
                 {
                     parser->advance();
                     parser->skipNewlines();
-                    Node* res = new NodeToken(NodeType::ShorthandChar, t);
+                    Node* res = parser->make<NodeToken>(NodeType::ShorthandChar, t, parser->content(t));
                     res->nodes.push_back(Node::ParseSceneStatement(parser, KeywordType::None));
                     return res;
                 }
@@ -669,17 +645,17 @@ namespace diannex
                 {
                     parser->advance();
                     parser->skipNewlines();
-                    NodeToken* res = new NodeToken(NodeType::ShorthandChar, t);
+                    NodeToken* res = parser->make<NodeToken>(NodeType::ShorthandChar, t, "", parser->stringData(t));
                     res->nodes.push_back(Node::ParseSceneStatement(parser, KeywordType::None));
-                    res->token.content = Parser::ProcessStringInterpolation(parser, t, t.content, &res->nodes);
+                    res->content = Parser::ProcessStringInterpolation(parser, t, parser->content(t), &res->nodes);
                     return res;
                 }
                 else
                 {
                     if (t.type == TokenType::MarkedString)
-                        parser->errors.push_back({ ParseError::ErrorType::UnexpectedMarkedString, t.line, t.column });
-                    NodeText* res = new NodeText(t.content, t.stringData, t.type == TokenType::ExcludeString);
-                    res->content = Parser::ProcessStringInterpolation(parser, t, t.content, &res->nodes);
+                        parser->errors.push_back({ ParseError::ErrorType::UnexpectedMarkedString, parser->tokenLine(t), parser->tokenColumn(t) });
+                    NodeText* res = parser->make<NodeText>("", parser->stringData(t), t.type == TokenType::ExcludeString);
+                    res->content = Parser::ProcessStringInterpolation(parser, t, parser->content(t), &res->nodes);
                     return res;
                 }
                 break;
@@ -691,20 +667,20 @@ namespace diannex
                     parser->advance();
                     parser->skipNewlines();
 
-                    Node* res = new Node(NodeType::Choice);
+                    Node* res = parser->make<Node>(NodeType::Choice);
 
                     // Check for statement/text run
                     Token next = parser->peekToken();
                     switch (next.type)
                     {
                     case TokenType::MarkedString:
-                        parser->errors.push_back({ ParseError::ErrorType::UnexpectedMarkedString, next.line, next.column });
+                        parser->errors.push_back({ ParseError::ErrorType::UnexpectedMarkedString, parser->tokenLine(next), parser->tokenColumn(next) });
                         [[fallthrough]];
                     case TokenType::String:
                     case TokenType::ExcludeString:
                     {
-                        NodeText* text = new NodeText(next.content, next.stringData, next.type == TokenType::ExcludeString);
-                        text->content = Parser::ProcessStringInterpolation(parser, next, next.content, &text->nodes);
+                        NodeText* text = parser->make<NodeText>("", parser->stringData(next), next.type == TokenType::ExcludeString);
+                        text->content = Parser::ProcessStringInterpolation(parser, next, parser->content(next), &text->nodes);
                         res->nodes.push_back(text);
                         parser->advance();
                         parser->skipNewlines();
@@ -717,7 +693,7 @@ namespace diannex
                         parser->skipNewlines();
                         break;
                     default:
-                        res->nodes.push_back(new Node(NodeType::None));
+                        res->nodes.push_back(parser->make<Node>(NodeType::None));
                         break;
                     }
 
@@ -732,14 +708,14 @@ namespace diannex
                         case TokenType::MarkedString:
                         case TokenType::ExcludeString:
                         {
-                            NodeText* text = new NodeText(NodeType::ChoiceText, val.content, val.stringData, val.type == TokenType::ExcludeString);
-                            text->content = Parser::ProcessStringInterpolation(parser, val, val.content, &text->nodes);
+                            NodeText* text = parser->make<NodeText>(NodeType::ChoiceText, "", parser->stringData(val), val.type == TokenType::ExcludeString);
+                            text->content = Parser::ProcessStringInterpolation(parser, val, parser->content(val), &text->nodes);
                             res->nodes.push_back(text);
                             parser->advance();
                             break;
                         }
                         default:
-                            res->nodes.push_back(new Node(NodeType::None));
+                            res->nodes.push_back(parser->make<Node>(NodeType::None));
                             break;
                         }
 
@@ -749,14 +725,14 @@ namespace diannex
                         {
                         case TokenType::Number:
                         case TokenType::Percentage:
-                            res->nodes.push_back(new NodeToken(NodeType::ExprConstant, val));
+                            res->nodes.push_back(parser->make<NodeToken>(NodeType::ExprConstant, val, parser->number(val)));
                             parser->advance();
                             break;
                         case TokenType::OpenParen:
                             res->nodes.push_back(Node::ParseExpression(parser));
                             break;
                         default:
-                            res->nodes.push_back(new NodeToken(NodeType::ExprConstant, Token(TokenType::Number, 0, 0, "1")));
+                            res->nodes.push_back(parser->make<NodeToken>(NodeType::ExprConstant, Token(TokenType::Number), NumberData(1, true)));
                             break;
                         }
 
@@ -770,14 +746,14 @@ namespace diannex
                             res->nodes.push_back(Node::ParseExpression(parser));
                         }
                         else
-                            res->nodes.push_back(new Node(NodeType::None));
+                            res->nodes.push_back(parser->make<Node>(NodeType::None));
 
                         // Parse the statement
                         res->nodes.push_back(Node::ParseSceneStatement(parser, KeywordType::None));
                         parser->skipNewlines();
                     }
                     if (res->nodes.size() == 0)
-                        parser->errors.push_back({ ParseError::ErrorType::ChoiceWithoutStatement, t.line, t.column });
+                        parser->errors.push_back({ ParseError::ErrorType::ChoiceWithoutStatement, parser->tokenLine(t), parser->tokenColumn(t) });
                     parser->ensureToken(TokenType::CloseCurly);
 
                     return res;
@@ -787,7 +763,7 @@ namespace diannex
                     parser->advance();
                     parser->skipNewlines();
 
-                    Node* res = new Node(NodeType::Choose);
+                    Node* res = parser->make<Node>(NodeType::Choose);
 
                     parser->ensureToken(TokenType::OpenCurly);
                     parser->skipNewlines();
@@ -798,14 +774,14 @@ namespace diannex
                         {
                         case TokenType::Number:
                         case TokenType::Percentage:
-                            res->nodes.push_back(new NodeToken(NodeType::ExprConstant, val));
+                            res->nodes.push_back(parser->make<NodeToken>(NodeType::ExprConstant, val, parser->number(val)));
                             parser->advance();
                             break;
                         case TokenType::OpenParen:
                             res->nodes.push_back(Node::ParseExpression(parser));
                             break;
                         default:
-                            res->nodes.push_back(new NodeToken(NodeType::ExprConstant, Token(TokenType::Number, 0, 0, "1")));
+                            res->nodes.push_back(parser->make<NodeToken>(NodeType::ExprConstant, Token(TokenType::Number), NumberData(1, true)));
                             break;
                         }
 
@@ -819,14 +795,14 @@ namespace diannex
                             res->nodes.push_back(Node::ParseExpression(parser));
                         }
                         else
-                            res->nodes.push_back(new Node(NodeType::None));
+                            res->nodes.push_back(parser->make<Node>(NodeType::None));
 
                         // Parse the statement
                         res->nodes.push_back(Node::ParseSceneStatement(parser, KeywordType::None));
                         parser->skipNewlines();
                     }
                     if (res->nodes.size() == 0)
-                        parser->errors.push_back({ ParseError::ErrorType::ChooseWithoutStatement, t.line, t.column });
+                        parser->errors.push_back({ ParseError::ErrorType::ChooseWithoutStatement, parser->tokenLine(t), parser->tokenColumn(t) });
                     parser->ensureToken(TokenType::CloseCurly);
 
                     return res;
@@ -841,7 +817,7 @@ namespace diannex
                     parser->skipNewlines();
                     Node* trueBranch = Node::ParseSceneStatement(parser, KeywordType::None);
 
-                    Node* res = new Node(NodeType::If);
+                    Node* res = parser->make<Node>(NodeType::If);
                     res->nodes.push_back(condition);
                     res->nodes.push_back(trueBranch);
 
@@ -868,7 +844,7 @@ namespace diannex
                     parser->skipNewlines();
                     Node* body = Node::ParseSceneStatement(parser, KeywordType::None);
 
-                    Node* res = new Node(NodeType::While);
+                    Node* res = parser->make<Node>(NodeType::While);
                     res->nodes.push_back(condition);
                     res->nodes.push_back(body);
 
@@ -895,7 +871,7 @@ namespace diannex
                     Node* condition;
                     if (parser->isNextToken(TokenType::Semicolon))
                     {
-                        condition = new Node(NodeType::None);
+                        condition = parser->make<Node>(NodeType::None);
                         parser->advance();
                     }
                     else
@@ -916,7 +892,7 @@ namespace diannex
                     parser->skipNewlines();
                     Node* body = Node::ParseSceneStatement(parser, KeywordType::None);
 
-                    Node* res = new Node(NodeType::For);
+                    Node* res = parser->make<Node>(NodeType::For);
                     res->nodes.push_back(init);
                     res->nodes.push_back(condition);
                     res->nodes.push_back(loop);
@@ -936,15 +912,15 @@ namespace diannex
                     parser->skipNewlines();
                     Token keyword = parser->ensureToken(TokenType::MainKeyword);
                     if (keyword.type != TokenType::Error && keyword.keywordType != KeywordType::While)
-                        parser->errors.push_back({ ParseError::ErrorType::ExpectedTokenButGot, t.line, t.column,
-                                                    tokenToString(Token(TokenType::MainKeyword, 0, 0, KeywordType::While)), tokenToString(keyword) });
+                        parser->errors.push_back({ ParseError::ErrorType::ExpectedTokenButGot, parser->tokenLine(t), parser->tokenColumn(t),
+                                                    tokenToString(Token(TokenType::MainKeyword, Token::NoOffset, KeywordType::While)), tokenToString(keyword) });
                     else
                         parser->checkErrorToken(keyword);
 
                     parser->skipNewlines();
                     Node* condition = Node::ParseExpression(parser);
 
-                    Node* res = new Node(NodeType::Do);
+                    Node* res = parser->make<Node>(NodeType::Do);
                     res->nodes.push_back(body);
                     res->nodes.push_back(condition);
 
@@ -960,7 +936,7 @@ namespace diannex
                     parser->skipNewlines();
                     Node* body = Node::ParseSceneStatement(parser, KeywordType::None);
 
-                    Node* res = new Node(NodeType::Repeat);
+                    Node* res = parser->make<Node>(NodeType::Repeat);
                     res->nodes.push_back(condition);
                     res->nodes.push_back(body);
 
@@ -972,7 +948,7 @@ namespace diannex
                     parser->skipNewlines();
                     Node* value = Node::ParseExpression(parser);
 
-                    NodeToken* res = new NodeToken(NodeType::Switch, t);
+                    NodeToken* res = parser->make<NodeToken>(NodeType::Switch, t);
                     res->nodes.push_back(value);
 
                     parser->ensureToken(TokenType::OpenCurly); 
@@ -1010,9 +986,9 @@ namespace diannex
                                             Token rangeEnd = parser->ensureToken(TokenType::Number);
                                             parser->skipNewlines();
                                             parser->ensureToken(TokenType::Colon);
-                                            Node* range = new Node(NodeType::ExprRange);
-                                            range->nodes.push_back(new NodeToken(NodeType::ExprConstant, curr));
-                                            range->nodes.push_back(new NodeToken(NodeType::ExprConstant, rangeEnd));
+                                            Node* range = parser->make<Node>(NodeType::ExprRange);
+                                            range->nodes.push_back(parser->make<NodeToken>(NodeType::ExprConstant, curr, parser->number(curr)));
+                                            range->nodes.push_back(parser->make<NodeToken>(NodeType::ExprConstant, rangeEnd, parser->number(rangeEnd)));
                                             res->nodes.push_back(range);
                                         }
                                         else
@@ -1033,7 +1009,7 @@ namespace diannex
                                         if (curr.type == TokenType::MainKeyword && curr.keywordType == KeywordType::Default)
                                         {
                                             // Default
-                                            res->nodes.push_back(new NodeToken(NodeType::SwitchDefault, curr));
+                                            res->nodes.push_back(parser->make<NodeToken>(NodeType::SwitchDefault, curr));
                                             parser->advance();
                                         }
                                         else
@@ -1080,10 +1056,10 @@ namespace diannex
                 case KeywordType::Case:
                 {
                     if (!inSwitch)
-                        parser->errors.push_back({ ParseError::ErrorType::UnexpectedSwitchCase, t.line, t.column });
+                        parser->errors.push_back({ ParseError::ErrorType::UnexpectedSwitchCase, parser->tokenLine(t), parser->tokenColumn(t) });
                     parser->advance();
                     parser->skipNewlines();
-                    Node* res = new Node(NodeType::SwitchCase);
+                    Node* res = parser->make<Node>(NodeType::SwitchCase);
                     res->nodes.push_back(Node::ParseExpression(parser));
                     parser->ensureToken(TokenType::Colon);
                     return res;
@@ -1091,26 +1067,26 @@ namespace diannex
                 case KeywordType::Default:
                 {
                     if (!inSwitch)
-                        parser->errors.push_back({ ParseError::ErrorType::UnexpectedSwitchDefault, t.line, t.column });
+                        parser->errors.push_back({ ParseError::ErrorType::UnexpectedSwitchDefault, parser->tokenLine(t), parser->tokenColumn(t) });
                     parser->advance();
                     parser->skipNewlines();
                     parser->ensureToken(TokenType::Colon);
-                    return new Node(NodeType::SwitchDefault);
+                    return parser->make<Node>(NodeType::SwitchDefault);
                 }
                 case KeywordType::Continue:
                 {
                     parser->advance();
-                    return new NodeToken(NodeType::Continue, t);
+                    return parser->make<NodeToken>(NodeType::Continue, t);
                 }
                 case KeywordType::Break:
                 {
                     parser->advance();
-                    return new NodeToken(NodeType::Break, t);
+                    return parser->make<NodeToken>(NodeType::Break, t);
                 }
                 case KeywordType::Return:
                 {
                     parser->advance();
-                    Node* res = new Node(NodeType::Return);
+                    Node* res = parser->make<Node>(NodeType::Return);
 
                     // Parse expression to return (if present)
                     parser->skipNewlines();
@@ -1151,10 +1127,10 @@ namespace diannex
                         parser->skipNewlines();
                     }
 
-                    NodeToken* res = new NodeToken(NodeType::Sequence, t);
+                    NodeToken* res = parser->make<NodeToken>(NodeType::Sequence, t);
                     res->nodes.push_back(value);
 
-                    Node* sub = new Node(NodeType::Subsequence);
+                    Node* sub = parser->make<Node>(NodeType::Subsequence);
                     res->nodes.push_back(sub);
 
                     parser->ensureToken(TokenType::OpenCurly);
@@ -1181,9 +1157,9 @@ namespace diannex
                                     Token rangeEnd = parser->ensureToken(TokenType::Number);
                                     parser->skipNewlines();
                                     parser->ensureToken(TokenType::Colon);
-                                    Node* range = new Node(NodeType::ExprRange);
-                                    range->nodes.push_back(new NodeToken(NodeType::ExprConstant, curr));
-                                    range->nodes.push_back(new NodeToken(NodeType::ExprConstant, rangeEnd));
+                                    Node* range = parser->make<Node>(NodeType::ExprRange);
+                                    range->nodes.push_back(parser->make<NodeToken>(NodeType::ExprConstant, curr, parser->number(curr)));
+                                    range->nodes.push_back(parser->make<NodeToken>(NodeType::ExprConstant, rangeEnd, parser->number(rangeEnd)));
                                     sub->nodes.push_back(range);
                                 }
                                 else
@@ -1221,7 +1197,7 @@ namespace diannex
                                 parser->skipNewlines();
                                 parser->ensureToken(TokenType::OpenCurly);
                                 parser->skipNewlines();
-                                sub = new Node(NodeType::Subsequence);
+                                sub = parser->make<Node>(NodeType::Subsequence);
                                 res->nodes.push_back(sub);
                             }
                             else
@@ -1240,14 +1216,14 @@ namespace diannex
                 }
                 default:
                     if (!parser->checkErrorToken(t))
-                        parser->errors.push_back({ ParseError::ErrorType::UnexpectedToken, t.line, t.column, tokenToString(t) });
+                        parser->errors.push_back({ ParseError::ErrorType::UnexpectedToken, parser->tokenLine(t), parser->tokenColumn(t), tokenToString(t) });
                     parser->synchronize();
                     break;
                 }
                 break;
             case TokenType::Increment:
             {
-                Node* res = new Node(NodeType::Increment);
+                Node* res = parser->make<Node>(NodeType::Increment);
                 parser->advance();
                 parser->skipNewlines();
                 Node* val = Node::ParseVariable(parser);
@@ -1256,7 +1232,7 @@ namespace diannex
             }
             case TokenType::Decrement:
             {
-                Node* res = new Node(NodeType::Decrement);
+                Node* res = parser->make<Node>(NodeType::Decrement);
                 parser->advance();
                 parser->skipNewlines();
                 Node* val = Node::ParseVariable(parser);
@@ -1269,15 +1245,15 @@ namespace diannex
                 return Node::ParseSceneStatement(parser, t.keywordType);
             case TokenType::MarkedComment:
                 parser->advance();
-                return new NodeContent(t, NodeType::MarkedComment);
+                return parser->make<NodeContent>(t, parser->content(t), NodeType::MarkedComment);
             case TokenType::OpenCurly:
                 return Node::ParseSceneBlock(parser);
             case TokenType::Semicolon:
                 parser->advance();
-                return new Node(NodeType::None);
+                return parser->make<Node>(NodeType::None);
             default:
                 if (!parser->checkErrorToken(t))
-                    parser->errors.push_back({ ParseError::ErrorType::UnexpectedToken, t.line, t.column, tokenToString(t) });
+                    parser->errors.push_back({ ParseError::ErrorType::UnexpectedToken, parser->tokenLine(t), parser->tokenColumn(t), tokenToString(t) });
                 parser->synchronize();
                 break;
             }
@@ -1291,7 +1267,7 @@ namespace diannex
         Token name = parser->ensureToken(TokenType::Identifier);
         if (name.type != TokenType::Error)
         {
-            NodeContent* res = new NodeContent(name, NodeType::Variable);
+            NodeContent* res = parser->make<NodeContent>(name, parser->content(name), NodeType::Variable);
 
             // Array index parse
             parser->skipNewlines();
@@ -1314,7 +1290,7 @@ namespace diannex
         Token name = parser->ensureToken(TokenType::Identifier);
         if (name.type != TokenType::Error)
         {
-            NodeContent* res = new NodeContent(name, NodeType::SceneFunction);
+            NodeContent* res = parser->make<NodeContent>(name, parser->content(name), NodeType::SceneFunction);
 
             if (parentheses)
             {
@@ -1356,7 +1332,7 @@ namespace diannex
                 }
             }
 
-            Token t = parser->isMore() ? parser->peekToken() : Token(TokenType::Error, 0, 0);
+            Token t = parser->isMore() ? parser->peekToken() : Token(TokenType::Error);
             if (parentheses)
             {
                 // Parse normal functions with opening/closing parentheses
@@ -1374,7 +1350,7 @@ namespace diannex
                             if (t.type != TokenType::Comma)
                             {
                                 parser->checkErrorToken(t);
-                                parser->errors.push_back({ ParseError::ErrorType::ExpectedTokenButGot, t.line, t.column, tokenToString(Token(TokenType::Comma, 0, 0)), tokenToString(t) });
+                                parser->errors.push_back({ ParseError::ErrorType::ExpectedTokenButGot, parser->tokenLine(t), parser->tokenColumn(t), tokenToString(Token(TokenType::Comma)), tokenToString(t) });
                                 break;
                             }
                         }
@@ -1399,7 +1375,7 @@ namespace diannex
                             if (t.type != TokenType::Comma)
                             {
                                 parser->checkErrorToken(t);
-                                parser->errors.push_back({ ParseError::ErrorType::ExpectedTokenButGot, t.line, t.column, tokenToString(Token(TokenType::Comma, 0, 0)), tokenToString(t) });
+                                parser->errors.push_back({ ParseError::ErrorType::ExpectedTokenButGot, parser->tokenLine(t), parser->tokenColumn(t), tokenToString(Token(TokenType::Comma)), tokenToString(t) });
                                 break;
                             }
                         }
@@ -1421,7 +1397,7 @@ namespace diannex
         parser->skipNewlines();
         if (parser->isMore() && parser->isNextToken(TokenType::OpenBrack))
         {
-            Node* arrayRes = new Node(NodeType::ExprAccessArray);
+            Node* arrayRes = parser->make<Node>(NodeType::ExprAccessArray);
             arrayRes->nodes.push_back(res);
 
             do 
@@ -1451,7 +1427,7 @@ namespace diannex
             {
                 parser->advance();
 
-                Node* res = new NodeToken(NodeType::ExprTernary, t);
+                Node* res = parser->make<NodeToken>(NodeType::ExprTernary, t);
                 res->nodes.push_back(left);
                 res->nodes.push_back(Node::ParseExpression(parser));
                 parser->skipNewlines();
@@ -1475,7 +1451,7 @@ namespace diannex
             {
                 parser->advance();
 
-                Node* res = new NodeToken(NodeType::ExprBinary, t);
+                Node* res = parser->make<NodeToken>(NodeType::ExprBinary, t);
                 res->nodes.push_back(left);
                 res->nodes.push_back(Node::ParseExpression(parser));
                 parser->skipNewlines();
@@ -1503,7 +1479,7 @@ namespace diannex
             {
                 parser->advance();
 
-                Node* res = new NodeToken(NodeType::ExprBinary, t);
+                Node* res = parser->make<NodeToken>(NodeType::ExprBinary, t);
                 res->nodes.push_back(left);
                 res->nodes.push_back(Node::ParseExpression(parser));
                 parser->skipNewlines();
@@ -1536,7 +1512,7 @@ namespace diannex
             {
                 parser->advance();
 
-                Node* res = new NodeToken(NodeType::ExprBinary, t);
+                Node* res = parser->make<NodeToken>(NodeType::ExprBinary, t);
                 res->nodes.push_back(left);
                 res->nodes.push_back(Node::ParseBitwise(parser));
 
@@ -1559,7 +1535,7 @@ namespace diannex
             {
                 parser->advance();
 
-                Node* res = new NodeToken(NodeType::ExprBinary, t);
+                Node* res = parser->make<NodeToken>(NodeType::ExprBinary, t);
                 res->nodes.push_back(left);
                 res->nodes.push_back(Node::ParseBitShift(parser));
 
@@ -1574,7 +1550,7 @@ namespace diannex
                     {
                         parser->advance();
 
-                        Node* next = new NodeToken(NodeType::ExprBinary, t);
+                        Node* next = parser->make<NodeToken>(NodeType::ExprBinary, t);
                         next->nodes.push_back(res);
                         next->nodes.push_back(Node::ParseBitShift(parser));
                         res = next;
@@ -1603,7 +1579,7 @@ namespace diannex
             {
                 parser->advance();
 
-                Node* res = new NodeToken(NodeType::ExprBinary, t);
+                Node* res = parser->make<NodeToken>(NodeType::ExprBinary, t);
                 res->nodes.push_back(left);
                 res->nodes.push_back(Node::ParseAddSub(parser));
 
@@ -1617,7 +1593,7 @@ namespace diannex
                     {
                         parser->advance();
 
-                        Node* next = new NodeToken(NodeType::ExprBinary, t);
+                        Node* next = parser->make<NodeToken>(NodeType::ExprBinary, t);
                         next->nodes.push_back(res);
                         next->nodes.push_back(Node::ParseAddSub(parser));
                         res = next;
@@ -1646,7 +1622,7 @@ namespace diannex
             {
                 parser->advance();
 
-                Node* res = new NodeToken(NodeType::ExprBinary, t);
+                Node* res = parser->make<NodeToken>(NodeType::ExprBinary, t);
                 res->nodes.push_back(left);
                 res->nodes.push_back(Node::ParseMulDiv(parser));
 
@@ -1660,7 +1636,7 @@ namespace diannex
                     {
                         parser->advance();
 
-                        Node* next = new NodeToken(NodeType::ExprBinary, t);
+                        Node* next = parser->make<NodeToken>(NodeType::ExprBinary, t);
                         next->nodes.push_back(res);
                         next->nodes.push_back(Node::ParseMulDiv(parser));
                         res = next;
@@ -1691,7 +1667,7 @@ namespace diannex
             {
                 parser->advance();
 
-                Node* res = new NodeToken(NodeType::ExprBinary, t);
+                Node* res = parser->make<NodeToken>(NodeType::ExprBinary, t);
                 res->nodes.push_back(left);
                 res->nodes.push_back(Node::ParseExprLast(parser));
 
@@ -1707,7 +1683,7 @@ namespace diannex
                     {
                         parser->advance();
 
-                        Node* next = new NodeToken(NodeType::ExprBinary, t);
+                        Node* next = parser->make<NodeToken>(NodeType::ExprBinary, t);
                         next->nodes.push_back(res);
                         next->nodes.push_back(Node::ParseExprLast(parser));
                         res = next;
@@ -1735,16 +1711,18 @@ namespace diannex
             {
             case TokenType::Number:
             case TokenType::Percentage:
+                parser->advance();
+                return parser->make<NodeToken>(NodeType::ExprConstant, t, parser->number(t));
             case TokenType::Undefined:
                 parser->advance();
-                return new NodeToken(NodeType::ExprConstant, t);
+                return parser->make<NodeToken>(NodeType::ExprConstant, t, parser->content(t));
             case TokenType::String:
             case TokenType::MarkedString:
             case TokenType::ExcludeString:
             {
                 parser->advance();
-                NodeToken* str = new NodeToken(NodeType::ExprConstant, t);
-                str->token.content = Parser::ProcessStringInterpolation(parser, t, t.content, &str->nodes);
+                NodeToken* str = parser->make<NodeToken>(NodeType::ExprConstant, t, "", parser->stringData(t));
+                str->content = Parser::ProcessStringInterpolation(parser, t, parser->content(t), &str->nodes);
                 return str;
             }
             case TokenType::VariableStart:
@@ -1759,14 +1737,14 @@ namespace diannex
                     if (t.type == TokenType::Increment)
                     {
                         parser->advance();
-                        Node* res = new Node(NodeType::ExprPostIncrement);
+                        Node* res = parser->make<Node>(NodeType::ExprPostIncrement);
                         res->nodes.push_back(val);
                         return res;
                     }
                     else if (t.type == TokenType::Decrement)
                     {
                         parser->advance();
-                        Node* res = new Node(NodeType::ExprPostDecrement);
+                        Node* res = parser->make<Node>(NodeType::ExprPostDecrement);
                         res->nodes.push_back(val);
                         return res;
                     }
@@ -1779,7 +1757,7 @@ namespace diannex
                 parser->advance();
                 parser->skipNewlines();
                 Node* expr = Node::ParseExprLast(parser);
-                Node* res = new Node(NodeType::ExprNot);
+                Node* res = parser->make<Node>(NodeType::ExprNot);
                 res->nodes.push_back(expr);
                 return res;
             }
@@ -1795,14 +1773,11 @@ namespace diannex
                         exprToken->token.type == TokenType::Percentage)
                     {
                         // This is something like -(1) or - 1, so optimize it
-                        if (exprToken->token.content.front() == '-')
-                            exprToken->token.content = exprToken->token.content.substr(1); // negating something that's already negative...
-                        else
-                            exprToken->token.content = "-" + exprToken->token.content;
+                        exprToken->number.value = -exprToken->number.value;
                         return exprToken;
                     }
                 }
-                Node* res = new Node(NodeType::ExprNegate);
+                Node* res = parser->make<Node>(NodeType::ExprNegate);
                 res->nodes.push_back(expr);
                 return res;
             }
@@ -1811,7 +1786,7 @@ namespace diannex
                 parser->advance();
                 parser->skipNewlines();
                 Node* expr = Node::ParseExprLast(parser);
-                Node* res = new Node(NodeType::ExprBitwiseNegate);
+                Node* res = parser->make<Node>(NodeType::ExprBitwiseNegate);
                 res->nodes.push_back(expr);
                 return res;
             }
@@ -1828,7 +1803,7 @@ namespace diannex
             {
                 parser->advance();
                 parser->skipNewlines();
-                Node* res = new Node(NodeType::ExprArray);
+                Node* res = parser->make<Node>(NodeType::ExprArray);
                 t = parser->peekToken();
                 while (parser->isMore() && t.type != TokenType::CloseBrack)
                 {
@@ -1844,7 +1819,7 @@ namespace diannex
                             if (t.type != TokenType::Comma)
                             {
                                 parser->checkErrorToken(t);
-                                parser->errors.push_back({ ParseError::ErrorType::ExpectedTokenButGot, t.line, t.column, tokenToString(Token(TokenType::Comma, 0, 0)), tokenToString(t) });
+                                parser->errors.push_back({ ParseError::ErrorType::ExpectedTokenButGot, parser->tokenLine(t), parser->tokenColumn(t), tokenToString(Token(TokenType::Comma)), tokenToString(t) });
                                 break;
                             }
                         }
@@ -1855,7 +1830,7 @@ namespace diannex
             }
             case TokenType::Increment:
             {
-                Node* res = new Node(NodeType::ExprPreIncrement);
+                Node* res = parser->make<Node>(NodeType::ExprPreIncrement);
                 parser->advance();
                 parser->skipNewlines();
                 Node* val = Node::ParseVariable(parser);
@@ -1864,7 +1839,7 @@ namespace diannex
             }
             case TokenType::Decrement:
             {
-                Node* res = new Node(NodeType::ExprPreDecrement);
+                Node* res = parser->make<Node>(NodeType::ExprPreDecrement);
                 parser->advance();
                 parser->skipNewlines();
                 Node* val = Node::ParseVariable(parser);
@@ -1880,7 +1855,7 @@ namespace diannex
             }
 
             if (!parser->checkErrorToken(t))
-                parser->errors.push_back({ ParseError::ErrorType::UnexpectedToken, t.line, t.column, tokenToString(t) });
+                parser->errors.push_back({ ParseError::ErrorType::UnexpectedToken, parser->tokenLine(t), parser->tokenColumn(t), tokenToString(t) });
             return nullptr;
         }
 
@@ -1894,7 +1869,7 @@ namespace diannex
 
     Node* Node::ParseDefinitionBlock(Parser* parser, Token name)
     {
-        NodeContent* res = new NodeContent(name, NodeType::Definitions);
+        NodeContent* res = parser->make<NodeContent>(name, parser->content(name), NodeType::Definitions);
 
         parser->ensureToken(TokenType::OpenCurly);
 
@@ -1925,18 +1900,18 @@ namespace diannex
                 Token val = parser->ensureToken(TokenType::String, TokenType::ExcludeString);
                 if (val.type != TokenType::Error)
                 {
-                    NodeDefinition* def = new NodeDefinition(t.content, val.content, val.stringData, val.type != TokenType::String);
-                    def->value = Parser::ProcessStringInterpolation(parser, val, val.content, &def->nodes);
+                    NodeDefinition* def = parser->make<NodeDefinition>(parser->content(t), "", parser->stringData(val), val.type != TokenType::String);
+                    def->value = Parser::ProcessStringInterpolation(parser, val, parser->content(val), &def->nodes);
                     return def;
                 }
             }
             break;
         case TokenType::MarkedComment:
             parser->advance();
-            return new NodeContent(t.content, NodeType::MarkedComment);
+            return parser->make<NodeContent>(parser->content(t), NodeType::MarkedComment);
         default:
             if (!parser->checkErrorToken(t))
-                parser->errors.push_back({ ParseError::ErrorType::UnexpectedToken, t.line, t.column, tokenToString(t) });
+                parser->errors.push_back({ ParseError::ErrorType::UnexpectedToken, parser->tokenLine(t), parser->tokenColumn(t), tokenToString(t) });
             parser->synchronize();
             break;
         }
@@ -1944,8 +1919,8 @@ namespace diannex
         return nullptr;
     }
 
-    NodeDefinition::NodeDefinition(std::string key, std::string value, std::shared_ptr<StringData> stringData, bool excludeValueTranslation)
-        : Node(NodeType::Definition), key(key), value(value), stringData(stringData), excludeValueTranslation(excludeValueTranslation)
+    NodeDefinition::NodeDefinition(Arena& arena, std::string_view key, std::string_view value, std::optional<StringData> stringData, bool excludeValueTranslation)
+        : Node(arena, NodeType::Definition), key(arena.Copy(key)), value(arena.Copy(value)), stringData(stringData), excludeValueTranslation(excludeValueTranslation)
     {
     }
 }
\ No newline at end of file
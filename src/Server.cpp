@@ -0,0 +1,137 @@
+#include "Server.h"
+
+#include <iostream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#define DIANNEX_UNIX_SOCKETS 1
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace diannex
+{
+    void Server::ServeStdio(Handler handler)
+    {
+        bool stop = false;
+        std::string line;
+        while (!stop && std::getline(std::cin, line))
+        {
+            if (line.empty() || line == "\r")
+                continue;
+            std::string response = handler(line, stop);
+            std::cout << response << std::endl;
+        }
+    }
+
+#if DIANNEX_UNIX_SOCKETS
+    static bool sendAll(int fd, const std::string& data)
+    {
+        size_t sent = 0;
+        while (sent < data.size())
+        {
+            ssize_t res = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (res <= 0)
+                return false;
+            sent += res;
+        }
+        return true;
+    }
+
+    // Removes a socket file at the path, refusing to touch anything that isn't a socket
+    static bool removeSocketFile(const std::string& path)
+    {
+        struct stat info;
+        if (lstat(path.c_str(), &info) == -1)
+            return errno == ENOENT;
+        if (!S_ISSOCK(info.st_mode))
+            return false;
+        return unlink(path.c_str()) == 0;
+    }
+
+    bool Server::ServeSocket(const std::string& path, Handler handler)
+    {
+        sockaddr_un addr {};
+        addr.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(addr.sun_path))
+            return false;
+        strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+        // A socket file left behind by a previous server would make bind fail
+        if (!removeSocketFile(path))
+        {
+            std::cerr << "'" << path << "' exists and is not a socket." << std::endl;
+            return false;
+        }
+
+        int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener == -1)
+            return false;
+
+        if (bind(listener, (sockaddr*)&addr, sizeof(addr)) == -1 || listen(listener, 8) == -1)
+        {
+            close(listener);
+            return false;
+        }
+
+        bool ok = true;
+        bool stop = false;
+        while (!stop)
+        {
+            int client = accept(listener, nullptr, nullptr);
+            if (client == -1)
+            {
+                if (errno == EINTR || errno == ECONNABORTED)
+                    continue;
+                ok = false;
+                break;
+            }
+
+            // Each connection can send any number of requests, one per line
+            std::string pending;
+            char buf[4096];
+            bool open = true;
+            while (open && !stop)
+            {
+                ssize_t len = recv(client, buf, sizeof(buf), 0);
+                if (len <= 0)
+                    break;
+                pending.append(buf, len);
+
+                size_t end;
+                while (!stop && (end = pending.find('\n')) != std::string::npos)
+                {
+                    std::string line = pending.substr(0, end);
+                    pending.erase(0, end + 1);
+                    if (!line.empty() && line.back() == '\r')
+                        line.pop_back();
+                    if (line.empty())
+                        continue;
+                    if (!sendAll(client, handler(line, stop) + "\n"))
+                    {
+                        open = false;
+                        break;
+                    }
+                }
+            }
+            close(client);
+        }
+
+        close(listener);
+        removeSocketFile(path);
+        return ok;
+    }
+#else
+    bool Server::ServeSocket(const std::string&, Handler)
+    {
+        return false;
+    }
+#endif
+}
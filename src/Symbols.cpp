@@ -0,0 +1,259 @@
+#include "Symbols.h"
+
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace diannex
+{
+    namespace
+    {
+        struct Entry
+        {
+            const char* data;
+            uint32_t length;
+            size_t hash;
+        };
+
+        // Entries are stored in fixed blocks that never move, so names can be read without taking the lock
+        constexpr uint32_t BlockSize = 4096;
+        constexpr uint32_t MaxBlocks = 4096;
+        constexpr size_t ChunkSize = 64 * 1024;
+
+        struct Table
+        {
+            std::shared_mutex mutex;
+            std::unordered_map<std::string_view, Symbol> names; // views into the arena
+            std::unordered_map<uint64_t, Symbol> children; // (parent, name) pairs already joined
+            Entry* blocks[MaxBlocks] = {};
+            uint32_t count = 0;
+            bool full = false; // a name has been given Symbols::Overflow
+
+            std::vector<char*> chunks;
+            size_t chunkUsed = ChunkSize;
+            size_t chunkBytes = 0;
+
+            Table()
+            {
+                reserveOverflow();
+            }
+
+            ~Table()
+            {
+                release();
+            }
+
+            void release()
+            {
+                for (uint32_t i = 0; i * BlockSize < count; i++)
+                {
+                    delete[] blocks[i];
+                    blocks[i] = nullptr;
+                }
+                for (char* chunk : chunks)
+                    delete[] chunk;
+                names.clear();
+                children.clear();
+                count = 0;
+                full = false;
+                chunks.clear();
+                chunkUsed = ChunkSize;
+                chunkBytes = 0;
+            }
+
+            // Symbols::Overflow always exists, with a name no source can produce
+            void reserveOverflow()
+            {
+                add("<too many symbols>");
+            }
+
+            // Copies a name into the arena; long names get a chunk of their own
+            const char* store(std::string_view name)
+            {
+                if (name.size() > ChunkSize / 4)
+                {
+                    char* chunk = new char[name.size()];
+                    chunks.push_back(chunk);
+                    chunkBytes += name.size();
+                    std::memcpy(chunk, name.data(), name.size());
+                    return chunk;
+                }
+                if (chunkUsed + name.size() > ChunkSize)
+                {
+                    chunks.push_back(new char[ChunkSize]);
+                    chunkUsed = 0;
+                    chunkBytes += ChunkSize;
+                }
+                char* res = chunks.back() + chunkUsed;
+                std::memcpy(res, name.data(), name.size());
+                chunkUsed += name.size();
+                return res;
+            }
+
+            // Adds a name, with the lock held exclusively
+            Symbol add(std::string_view name)
+            {
+                auto it = names.find(name);
+                if (it != names.end())
+                    return it->second;
+
+                if (count == BlockSize * MaxBlocks)
+                {
+                    full = true;
+                    return Symbols::Overflow;
+                }
+                if (count % BlockSize == 0)
+                    blocks[count / BlockSize] = new Entry[BlockSize];
+
+                const char* data = store(name);
+                Symbol res = count++;
+                blocks[res / BlockSize][res % BlockSize] = { data, (uint32_t)name.size(), std::hash<std::string_view>()(name) };
+                names.insert(std::make_pair(std::string_view(data, name.size()), res));
+                return res;
+            }
+
+            const Entry& entry(Symbol symbol)
+            {
+                return blocks[symbol / BlockSize][symbol % BlockSize];
+            }
+        };
+
+        uint64_t childKey(Symbol parent, Symbol name)
+        {
+            return ((uint64_t)parent << 32) | name;
+        }
+    }
+
+    struct SymbolTableData : Table
+    {
+    };
+
+    static thread_local SymbolTableData* current = nullptr;
+
+    static Table& table()
+    {
+        return *current;
+    }
+
+    SymbolTable::SymbolTable() : data(std::make_unique<SymbolTableData>())
+    {
+    }
+
+    SymbolTable::~SymbolTable() = default;
+    SymbolTable::SymbolTable(SymbolTable&&) noexcept = default;
+    SymbolTable& SymbolTable::operator=(SymbolTable&&) noexcept = default;
+
+    void SymbolTable::Clear()
+    {
+        std::unique_lock<std::shared_mutex> lock(data->mutex);
+        data->release();
+        data->reserveOverflow();
+    }
+
+    bool SymbolTable::Full() const
+    {
+        std::shared_lock<std::shared_mutex> lock(data->mutex);
+        return data->full;
+    }
+
+    SymbolScope::SymbolScope(SymbolTable* table) : previous(current)
+    {
+        current = table->data.get();
+    }
+
+    SymbolScope::~SymbolScope()
+    {
+        current = previous;
+    }
+
+    Symbol Symbols::Intern(std::string_view name)
+    {
+        Table& t = table();
+        {
+            std::shared_lock<std::shared_mutex> lock(t.mutex);
+            auto it = t.names.find(name);
+            if (it != t.names.end())
+                return it->second;
+        }
+        std::unique_lock<std::shared_mutex> lock(t.mutex);
+        return t.add(name);
+    }
+
+    // Joins the names when the pair hasn't been seen; a dotted name may have been interned some other way
+    static Symbol joinChild(Symbol parent, Symbol name, bool add)
+    {
+        if (parent == Symbols::None)
+            return name;
+
+        Table& t = table();
+        uint64_t key = childKey(parent, name);
+        {
+            std::shared_lock<std::shared_mutex> lock(t.mutex);
+            auto it = t.children.find(key);
+            if (it != t.children.end())
+                return it->second;
+        }
+
+        std::string_view parentName = Symbols::Name(parent), childName = Symbols::Name(name);
+        std::string joined;
+        joined.reserve(parentName.size() + 1 + childName.size());
+        joined.append(parentName);
+        joined.push_back('.');
+        joined.append(childName);
+
+        std::unique_lock<std::shared_mutex> lock(t.mutex);
+        Symbol res;
+        if (add)
+            res = t.add(joined);
+        else
+        {
+            auto it = t.names.find(joined);
+            if (it == t.names.end())
+                return Symbols::None;
+            res = it->second;
+        }
+        t.children.insert(std::make_pair(key, res));
+        return res;
+    }
+
+    Symbol Symbols::Child(Symbol parent, Symbol name)
+    {
+        return joinChild(parent, name, true);
+    }
+
+    Symbol Symbols::FindChild(Symbol parent, Symbol name)
+    {
+        return joinChild(parent, name, false);
+    }
+
+    std::string_view Symbols::Name(Symbol symbol)
+    {
+        const Entry& e = table().entry(symbol);
+        return std::string_view(e.data, e.length);
+    }
+
+    size_t Symbols::Hash(Symbol symbol)
+    {
+        return table().entry(symbol).hash;
+    }
+
+    size_t Symbols::Count()
+    {
+        Table& t = table();
+        std::shared_lock<std::shared_mutex> lock(t.mutex);
+        return t.count;
+    }
+
+    size_t Symbols::HeapSize()
+    {
+        Table& t = table();
+        std::shared_lock<std::shared_mutex> lock(t.mutex);
+        size_t blocks = (t.count + BlockSize - 1) / BlockSize;
+        return t.chunkBytes + t.chunks.capacity() * sizeof(char*) + blocks * BlockSize * sizeof(Entry) +
+               (t.names.bucket_count() + t.names.size() * 2) * sizeof(void*) + t.names.size() * sizeof(std::pair<std::string_view, Symbol>) +
+               (t.children.bucket_count() + t.children.size() * 2) * sizeof(void*) + t.children.size() * sizeof(std::pair<uint64_t, Symbol>);
+    }
+}
@@ -0,0 +1,88 @@
+#include "ThreadPool.h"
+
+namespace diannex
+{
+    ThreadPool::ThreadPool(unsigned int threadCount)
+    {
+        if (threadCount == 0)
+            threadCount = 1;
+        workers.reserve(threadCount);
+        for (unsigned int i = 0; i < threadCount; i++)
+            workers.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        taskAvailable.notify_all();
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+
+    void ThreadPool::Submit(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push(std::move(task));
+            pending++;
+        }
+        taskAvailable.notify_one();
+    }
+
+    void ThreadPool::Wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        tasksFinished.wait(lock, [this]() { return pending == 0; });
+        if (error)
+        {
+            std::exception_ptr res = error;
+            error = nullptr;
+            lock.unlock();
+            std::rethrow_exception(res);
+        }
+    }
+
+    unsigned int ThreadPool::GetThreadCount()
+    {
+        return workers.size();
+    }
+
+    void ThreadPool::WorkerLoop()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                taskAvailable.wait(lock, [this]() { return stopping || !tasks.empty(); });
+                if (tasks.empty())
+                    return; // Only reached when stopping
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+
+            // Exceptions can't leave a worker thread, so they're handed to whoever waits on the pool
+            std::exception_ptr thrown;
+            try
+            {
+                task();
+            }
+            catch (...)
+            {
+                thrown = std::current_exception();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (thrown && !error)
+                    error = thrown;
+                pending--;
+                if (pending == 0)
+                    tasksFinished.notify_all();
+            }
+        }
+    }
+}
@@ -0,0 +1,193 @@
+#include "Timings.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+#include <libs/json.hpp>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+namespace diannex
+{
+    // CPU time used so far, in milliseconds
+    static double cpuTime(bool threadOnly)
+    {
+#ifdef _WIN32
+        FILETIME creation, exit, kernel, user;
+        BOOL res = threadOnly ? GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)
+                              : GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+        if (!res)
+            return 0;
+        uint64_t k = ((uint64_t)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime;
+        uint64_t u = ((uint64_t)user.dwHighDateTime << 32) | user.dwLowDateTime;
+        return (k + u) / 10000.0; // 100ns units
+#else
+        timespec ts;
+        if (clock_gettime(threadOnly ? CLOCK_THREAD_CPUTIME_ID : CLOCK_PROCESS_CPUTIME_ID, &ts) != 0)
+            return 0;
+        return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+#endif
+    }
+
+    Timings::Time& Timings::Time::operator+=(const Time& other)
+    {
+        wall += other.wall;
+        cpu += other.cpu;
+        return *this;
+    }
+
+    Timings::Time& Timings::Time::operator-=(const Time& other)
+    {
+        wall -= other.wall;
+        cpu -= other.cpu;
+        return *this;
+    }
+
+    Timings::Timer::Timer(bool threadOnly)
+        : threadOnly(threadOnly), wallStart(std::chrono::steady_clock::now()), cpuStart(cpuTime(threadOnly))
+    {
+    }
+
+    Timings::Time Timings::Timer::Stop()
+    {
+        Time res;
+        res.wall = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wallStart).count();
+        res.cpu = cpuTime(threadOnly) - cpuStart;
+        return res;
+    }
+
+    void Timings::AddPhase(Phase phase, const Time& time)
+    {
+        phases[(int)phase] += time;
+    }
+
+    void Timings::AddFile(const std::string& file, Phase phase, const Time& time)
+    {
+        std::lock_guard<std::mutex> lock(filesMutex);
+        FileTimes& times = files[file];
+        times.phases[(int)phase] += time;
+        times.total += time;
+    }
+
+    const Timings::Time& Timings::GetPhase(Phase phase)
+    {
+        return phases[(int)phase];
+    }
+
+    const char* Timings::PhaseName(Phase phase)
+    {
+        switch (phase)
+        {
+        case Phase::Lex:
+            return "lex";
+        case Phase::Parse:
+            return "parse";
+        case Phase::Bytecode:
+            return "bytecode";
+        case Phase::StringIds:
+            return "string_ids";
+        case Phase::Binary:
+            return "binary";
+        case Phase::Compression:
+            return "compression";
+        case Phase::Translation:
+            return "translation";
+        default:
+            return "unknown";
+        }
+    }
+
+    std::vector<std::pair<std::string, const Timings::FileTimes*>> Timings::sortedFiles()
+    {
+        // Slowest first, by total wall time; ties broken by name so the order is stable
+        std::vector<std::pair<std::string, const FileTimes*>> res;
+        res.reserve(files.size());
+        for (auto& pair : files)
+            res.push_back(std::make_pair(pair.first, &pair.second));
+        std::sort(res.begin(), res.end(), [](const auto& a, const auto& b)
+        {
+            if (a.second->total.wall != b.second->total.wall)
+                return a.second->total.wall > b.second->total.wall;
+            return a.first < b.first;
+        });
+        return res;
+    }
+
+    void Timings::Print(std::ostream& s, unsigned int topFiles)
+    {
+        std::lock_guard<std::mutex> lock(filesMutex);
+
+        s << std::fixed << std::setprecision(2);
+        s << std::endl << "Phase timings (ms):" << std::endl;
+        s << "  " << std::left << std::setw(14) << "phase" << std::right << std::setw(12) << "wall" << std::setw(12) << "cpu" << std::endl;
+        Time total;
+        for (int i = 0; i < (int)Phase::Count; i++)
+        {
+            s << "  " << std::left << std::setw(14) << PhaseName((Phase)i) << std::right
+              << std::setw(12) << phases[i].wall << std::setw(12) << phases[i].cpu << std::endl;
+            total += phases[i];
+        }
+        s << "  " << std::left << std::setw(14) << "total" << std::right << std::setw(12) << total.wall << std::setw(12) << total.cpu << std::endl;
+
+        auto sorted = sortedFiles();
+        if (topFiles > sorted.size())
+            topFiles = sorted.size();
+        if (topFiles != 0)
+        {
+            s << std::endl << "Slowest " << topFiles << " of " << sorted.size() << " files (wall ms):" << std::endl;
+            s << "  " << std::setw(10) << "total" << std::setw(10) << "lex" << std::setw(10) << "parse" << std::setw(10) << "bytecode" << "  file" << std::endl;
+            for (unsigned int i = 0; i < topFiles; i++)
+            {
+                const FileTimes* times = sorted[i].second;
+                s << "  " << std::setw(10) << times->total.wall
+                  << std::setw(10) << times->phases[(int)Phase::Lex].wall
+                  << std::setw(10) << times->phases[(int)Phase::Parse].wall
+                  << std::setw(10) << times->phases[(int)Phase::Bytecode].wall
+                  << "  " << sorted[i].first << std::endl;
+            }
+        }
+
+        s.unsetf(std::ios_base::floatfield);
+        s << std::setprecision(6);
+    }
+
+    static nlohmann::json timeJson(const Timings::Time& time)
+    {
+        return { { "wall_ms", time.wall }, { "cpu_ms", time.cpu } };
+    }
+
+    bool Timings::WriteJson(const std::string& path)
+    {
+        std::lock_guard<std::mutex> lock(filesMutex);
+
+        nlohmann::json res;
+        Time total;
+        for (int i = 0; i < (int)Phase::Count; i++)
+        {
+            res["phases"][PhaseName((Phase)i)] = timeJson(phases[i]);
+            total += phases[i];
+        }
+        res["total"] = timeJson(total);
+
+        res["files"] = nlohmann::json::array();
+        for (auto& pair : sortedFiles())
+        {
+            nlohmann::json file = { { "file", pair.first }, { "total", timeJson(pair.second->total) } };
+            for (Phase phase : { Phase::Lex, Phase::Parse, Phase::Bytecode })
+                file[PhaseName(phase)] = timeJson(pair.second->phases[(int)phase]);
+            res["files"].push_back(file);
+        }
+
+        std::ofstream s(path, std::ios::out | std::ios::trunc);
+        if (!s.is_open())
+            return false;
+        s << res.dump(4) << std::endl;
+        return true;
+    }
+}
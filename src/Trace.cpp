@@ -0,0 +1,106 @@
+#include "Trace.h"
+
+#include <fstream>
+
+#include <libs/json.hpp>
+
+namespace diannex
+{
+    Trace::Span::Span(Trace* trace, const char* category, const std::string& name)
+        : trace(trace), category(category), start(0), open(trace != nullptr)
+    {
+        if (trace != nullptr)
+        {
+            this->name = name;
+            start = trace->Now();
+        }
+    }
+
+    Trace::Span::~Span()
+    {
+        End();
+    }
+
+    void Trace::Span::Next(const std::string& name)
+    {
+        if (trace == nullptr)
+            return;
+        double now = trace->Now();
+        if (open)
+            trace->AddSpan(category, this->name, start, now);
+        this->name = name;
+        start = now;
+        open = true;
+    }
+
+    void Trace::Span::End()
+    {
+        if (!open)
+            return;
+        trace->AddSpan(category, name, start, trace->Now());
+        open = false;
+    }
+
+    Trace::Trace()
+        : origin(std::chrono::steady_clock::now())
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        threadIndex();
+    }
+
+    double Trace::Now()
+    {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - origin).count();
+    }
+
+    uint32_t Trace::threadIndex()
+    {
+        auto res = threads.emplace(std::this_thread::get_id(), (uint32_t)threads.size());
+        return res.first->second;
+    }
+
+    void Trace::AddSpan(const char* category, const std::string& name, double start, double end)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        events.push_back({ category, name, start, end - start, threadIndex() });
+    }
+
+    bool Trace::Write(const std::string& path)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        std::ofstream s(path, std::ios::out | std::ios::trunc);
+        if (!s.is_open())
+            return false;
+
+        // Events are written one at a time, as there can be a great deal of them
+        s << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << std::endl;
+        std::vector<std::string> names(threads.size());
+        for (auto& pair : threads)
+            names[pair.second] = (pair.second == 0) ? "main" : "worker " + std::to_string(pair.second);
+        for (uint32_t i = 0; i < names.size(); i++)
+        {
+            nlohmann::json event = {
+                { "name", "thread_name" }, { "ph", "M" }, { "pid", 1 }, { "tid", i },
+                { "args", { { "name", names[i] } } }
+            };
+            s << event.dump() << "," << std::endl;
+            event = {
+                { "name", "thread_sort_index" }, { "ph", "M" }, { "pid", 1 }, { "tid", i },
+                { "args", { { "sort_index", i } } }
+            };
+            s << event.dump() << (events.empty() && i == names.size() - 1 ? "" : ",") << std::endl;
+        }
+        for (size_t i = 0; i < events.size(); i++)
+        {
+            const Event& e = events[i];
+            nlohmann::json event = {
+                { "name", e.name }, { "cat", e.category }, { "ph", "X" },
+                { "ts", e.start }, { "dur", e.duration }, { "pid", 1 }, { "tid", e.thread }
+            };
+            s << event.dump() << (i == events.size() - 1 ? "" : ",") << std::endl;
+        }
+        s << "]}" << std::endl;
+        return true;
+    }
+}
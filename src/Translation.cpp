@@ -6,6 +6,7 @@
 #include <cctype>
 #include <iomanip>
 #include <iostream>
+#include <stdexcept>
 #include <libs/rang.hpp>
 
 namespace diannex
@@ -18,7 +19,7 @@ namespace diannex
         return str;
     }
 
-    void Translation::GeneratePublicFile(std::ofstream& s, CompileContext* ctx)
+    void Translation::GeneratePublicFile(std::ostream& s, CompileContext* ctx)
     {
         for (auto it = ctx->translationInfo.begin(); it != ctx->translationInfo.end(); ++it)
         {
@@ -27,7 +28,7 @@ namespace diannex
         }
     }
 
-    void Translation::GeneratePrivateFile(std::ofstream& s, CompileContext* ctx)
+    void Translation::GeneratePrivateFile(std::ostream& s, CompileContext* ctx)
     {
         std::string prevKey = "";
         bool first = true;
@@ -167,8 +168,7 @@ namespace diannex
                     const size_t idStart = text.find_last_of('&');
                     if (idStart < text.find_last_of('"') || idStart == std::string::npos)
                     {
-                        std::cout << rang::fgB::red << "Missing string ID in private translation file!" << rang::fg::reset << std::endl;
-                        exit(1);
+                        throw std::runtime_error("Missing string ID in private translation file!");
                     }
 
                     // Parse ID
@@ -179,8 +179,7 @@ namespace diannex
                     }
                     catch (std::exception&)
                     {
-                        std::cout << rang::fgB::red << "Invalid string ID format!" << rang::fg::reset << std::endl;
-                        exit(1);
+                        throw std::runtime_error("Invalid string ID format!");
                     }
 
                     // Add to map
@@ -225,8 +224,7 @@ namespace diannex
                 }
                 catch (std::exception&)
                 {
-                    std::cout << rang::fgB::red << "Invalid string ID format!" << rang::fg::reset << std::endl;
-                    exit(1);
+                    throw std::runtime_error("Invalid string ID format!");
                 }
 
                 auto older = inputStringsById.find(id);
@@ -32,6 +32,7 @@ namespace diannex
                                  {"macros", nlohmann::json::array()},
                                  {"add_string_ids", false},
                                  {"use_string_ids", false},
+                                 {"cache_dir", ""},
                          }}
         };
 
@@ -49,6 +50,8 @@ namespace diannex
         }
     }
 
+    static void read_project(nlohmann::json& project, const std::string& defaultName, ProjectFormat& proj);
+
     void load_project(std::string path, ProjectFormat& proj)
     {
         nlohmann::json project;
@@ -66,9 +69,29 @@ namespace diannex
             exit(1);
         }
 
+        read_project(project, fs::path(path).filename().stem().string(), proj);
+    }
+
+    bool parse_project(const std::string& text, const std::string& defaultName, ProjectFormat& proj, std::string& error)
+    {
+        try
+        {
+            nlohmann::json project = nlohmann::json::parse(text);
+            read_project(project, defaultName, proj);
+        }
+        catch (const std::exception& e)
+        {
+            error = e.what();
+            return false;
+        }
+        return true;
+    }
+
+    static void read_project(nlohmann::json& project, const std::string& defaultName, ProjectFormat& proj)
+    {
         proj.name = project.contains("name") ?
                     project["name"].get<std::string>() :
-                    fs::path(path).filename().stem().string();
+                    defaultName;
 
         if (project.contains("authors"))
         {
@@ -155,6 +178,10 @@ namespace diannex
                                     project["options"]["use_string_ids"].get<bool>() :
                                     false;
 
+        proj.options.cacheDir = project["options"].contains("cache_dir") ?
+                                project["options"]["cache_dir"].get<std::string>() :
+                                "";
+
         if (project["options"].contains("macros"))
         {
             for (auto& macro : project["options"]["macros"])
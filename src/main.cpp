@@ -3,9 +3,14 @@
 #include <chrono>
 #include <filesystem>
 #include <exception>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <sstream>
 
 #include <libs/cxxopts.hpp>
 #include <libs/rang.hpp>
+#include <libs/json.hpp>
 
 #include "Lexer.h"
 #include "Parser.h"
@@ -16,6 +21,14 @@
 #include "Binary.h"
 #include "Translation.h"
 #include "ParseResult.h"
+#include "ThreadPool.h"
+#include "Cache.h"
+#include "Compiler.h"
+#include "FileWatcher.h"
+#include "Server.h"
+#include "Timings.h"
+#include "MemoryStats.h"
+#include "Trace.h"
 
 using namespace diannex;
 namespace fs = std::filesystem;
@@ -40,11 +53,409 @@ void help(cxxopts::Options& options)
     std::cout << options.help() << "  --files                       File(s) to compile" << std::endl;
 }
 
+int convert_private_to_public(const std::string& inPrivate, const std::string& outPath)
+{
+    const std::filesystem::path& input = fs::absolute(inPrivate);
+    const std::filesystem::path& outResult = fs::absolute(outPath);
+
+    // Ensure directories exist
+    if (!fs::exists(input))
+        fs::create_directories(input.parent_path());
+    if (!fs::exists(outResult))
+        fs::create_directories(outResult.parent_path());
+
+    // Open files, check that they were opened properly
+    std::ifstream in;
+    std::ofstream out;
+    in.open(input, std::ios_base::binary | std::ios_base::in);
+    out.open(outResult, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
+    if (!in.is_open())
+    {
+        std::cout << std::endl << rang::fgB::red << "Failed to open input private translation file for reading!" << rang::fg::reset << std::endl;
+        return 1;
+    }
+    if (!out.is_open())
+    {
+        in.close();
+        std::cout << std::endl << rang::fgB::red << "Failed to open output public translation file for writing!" << rang::fg::reset << std::endl;
+        return 1;
+    }
+
+    // Actual operation
+    Translation::ConvertPrivateToPublic(in, out);
+
+    // Close files we opened earlier
+    in.close();
+    out.close();
+
+    return 0;
+}
+
+int convert_public_to_private(const std::string& inPublic, const std::string& inMatch, const std::string& outPath)
+{
+    const std::filesystem::path& input = fs::absolute(inPublic);
+    const std::filesystem::path& inputMatch = fs::absolute(inMatch);
+    const std::filesystem::path& outResult = fs::absolute(outPath);
+
+    // Ensure directories exist
+    if (!fs::exists(input))
+        fs::create_directories(input.parent_path());
+    if (!fs::exists(inputMatch))
+        fs::create_directories(inputMatch.parent_path());
+    if (!fs::exists(outResult))
+        fs::create_directories(outResult.parent_path());
+
+    // Open files, check that they were opened properly
+    std::ifstream in;
+    std::ifstream inMatchFile;
+    std::ofstream out;
+    in.open(input, std::ios_base::binary | std::ios_base::in);
+    inMatchFile.open(inputMatch, std::ios_base::binary | std::ios_base::in);
+    out.open(outResult, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
+    if (!in.is_open())
+    {
+        std::cout << std::endl << rang::fgB::red << "Failed to open input public translation file for reading!" << rang::fg::reset << std::endl;
+        return 1;
+    }
+    if (!inMatchFile.is_open())
+    {
+        in.close();
+        std::cout << std::endl << rang::fgB::red << "Failed to open input matching translation file for reading!" << rang::fg::reset << std::endl;
+        return 1;
+    }
+    if (!out.is_open())
+    {
+        in.close();
+        inMatchFile.close();
+        std::cout << std::endl << rang::fgB::red << "Failed to open output private translation file for writing!" << rang::fg::reset << std::endl;
+        return 1;
+    }
+
+    // Actual operation
+    Translation::ConvertPublicToPrivate(in, inMatchFile, out);
+
+    // Close files we opened earlier
+    in.close();
+    inMatchFile.close();
+    out.close();
+
+    return 0;
+}
+
+int upgrade_translation(const std::string& inPath, bool isInputPrivate, const std::string& inNewerPath, const std::string& outPath)
+{
+    const std::filesystem::path& input = fs::absolute(inPath);
+    const std::filesystem::path& inputNewer = fs::absolute(inNewerPath);
+    const std::filesystem::path& outResult = fs::absolute(outPath);
+
+    // Ensure directories exist
+    if (!fs::exists(input))
+        fs::create_directories(input.parent_path());
+    if (!fs::exists(inputNewer))
+        fs::create_directories(inputNewer.parent_path());
+    if (!fs::exists(outResult))
+        fs::create_directories(outResult.parent_path());
+
+    // Open files, check that they were opened properly
+    std::ifstream in;
+    std::ifstream inNewer;
+    std::ofstream out;
+    in.open(input, std::ios_base::binary | std::ios_base::in);
+    inNewer.open(inputNewer, std::ios_base::binary | std::ios_base::in);
+    out.open(outResult, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
+    if (!in.is_open())
+    {
+        std::cout << std::endl << rang::fgB::red << "Failed to open input translation file for reading!" << rang::fg::reset << std::endl;
+        return 1;
+    }
+    if (!inNewer.is_open())
+    {
+        in.close();
+        std::cout << std::endl << rang::fgB::red << "Failed to open newer input translation file for reading!" << rang::fg::reset << std::endl;
+        return 1;
+    }
+    if (!out.is_open())
+    {
+        in.close();
+        inNewer.close();
+        std::cout << std::endl << rang::fgB::red << "Failed to open output translation file for writing!" << rang::fg::reset << std::endl;
+        return 1;
+    }
+
+    // Actual operation
+    Translation::UpgradeFileToNewer(in, isInputPrivate, inNewer, out);
+
+    // Close files we opened earlier
+    in.close();
+    inNewer.close();
+    out.close();
+
+    return 0;
+}
+
+int translation_to_binary(const std::string& inPath, bool isInputPrivate, const std::string& outPath)
+{
+    const std::filesystem::path& input = fs::absolute(inPath);
+    const std::filesystem::path& outResult = fs::absolute(outPath);
+
+    // Ensure directories exist
+    if (!fs::exists(input))
+        fs::create_directories(input.parent_path());
+    if (!fs::exists(outResult))
+        fs::create_directories(outResult.parent_path());
+
+    {
+        // Open files, check that they were opened properly
+        std::ifstream in;
+        BinaryFileWriter out(outResult.string());
+        in.open(input, std::ios_base::binary | std::ios_base::in);
+        if (!in.is_open())
+        {
+            std::cout << std::endl << rang::fgB::red << "Failed to open input translation file for reading!" << rang::fg::reset << std::endl;
+            return 1;
+        }
+        if (!out.CanWrite())
+        {
+            in.close();
+            std::cout << std::endl << rang::fgB::red << "Failed to open output binary file for writing!" << rang::fg::reset << std::endl;
+            return 1;
+        }
+
+        // Actual operation
+        Translation::ConvertToBinary(in, isInputPrivate, out);
+
+        // Close file we opened earlier (BinaryFileWriter closes upon exiting scope)
+        in.close();
+    }
+
+    return 0;
+}
+
+// Compiles, then writes the outputs to disk
+int compile_project(ProjectFormat& project, const fs::path& baseDirectory, ThreadPool& pool, CompileSession& session)
+{
+    int res = Compiler::Compile(project, baseDirectory, pool, session);
+    if (res != 0)
+        return res;
+    return Compiler::WriteOutputs(session) ? 0 : 1;
+}
+
+// Compiles, then reports timings, memory use and a trace if requested by --timings, --timings_json, --memory or --trace_out
+int compile_with_reports(ProjectFormat& project, const fs::path& baseDirectory, ThreadPool& pool, CompileSession& session, const cxxopts::ParseResult& result)
+{
+    session.streaming = result.count("streaming");
+
+    bool timingsJson = result.count("timings_json");
+    bool measureTime = result.count("timings") || timingsJson;
+    bool measureMemory = result.count("memory");
+    bool trace = result.count("trace_out");
+    if (!measureTime && !measureMemory && !trace)
+        return compile_project(project, baseDirectory, pool, session);
+
+    Timings timings;
+    std::unique_ptr<MemoryStats> memory;
+    std::unique_ptr<Trace> traceEvents;
+    if (measureTime)
+        session.timings = &timings;
+    if (trace)
+    {
+        traceEvents = std::make_unique<Trace>();
+        session.trace = traceEvents.get();
+    }
+    if (measureMemory)
+    {
+        memory = std::make_unique<MemoryStats>();
+        session.memory = memory.get();
+    }
+    int res = compile_project(project, baseDirectory, pool, session);
+    session.timings = nullptr;
+    session.memory = nullptr;
+    session.trace = nullptr;
+
+    if (measureTime)
+    {
+        timings.Print(std::cout, result.count("timings") ? result["timings"].as<unsigned int>() : 10);
+        if (timingsJson && !timings.WriteJson(result["timings_json"].as<std::string>()))
+            std::cout << rang::fgB::red << "Failed to write timings to '" << result["timings_json"].as<std::string>() << "'." << rang::fg::reset << std::endl;
+    }
+    if (measureMemory)
+        memory->Print(std::cout);
+    if (trace && !traceEvents->Write(result["trace_out"].as<std::string>()))
+        std::cout << rang::fgB::red << "Failed to write trace to '" << result["trace_out"].as<std::string>() << "'." << rang::fg::reset << std::endl;
+    return res;
+}
+
+// Project state kept by --server between requests, so repeated compiles of the same project (and variant) stay warm
+struct ServerProject
+{
+    ProjectFormat project;
+    fs::path baseDirectory;
+    fs::file_time_type projectTime;
+    WarmFiles warmFiles;
+    SymbolTable symbols;
+    std::unordered_map<std::string, fs::file_time_type> fileTimes;
+};
+
+static fs::file_time_type write_time(const fs::path& path)
+{
+    std::error_code ec;
+    fs::file_time_type res = fs::last_write_time(path, ec);
+    return ec ? fs::file_time_type::min() : res;
+}
+
+nlohmann::json server_compile(const nlohmann::json& params, ThreadPool& pool, std::unordered_map<std::string, ServerProject>& projects)
+{
+    const std::string path = fs::absolute(params.at("project").get<std::string>()).string();
+    if (!fs::exists(path))
+        return { { "success", false }, { "outputs", nlohmann::json::array() }, { "diagnostics", { { { "file", path }, { "line", 0 }, { "column", 0 }, { "message", "Project file does not exist." } } } } };
+
+    // Each distinct set of overrides is its own variant, with its own warm files
+    ServerProject& sp = projects[path + '\n' + params.dump()];
+    fs::file_time_type projectTime = write_time(path);
+    if (sp.baseDirectory.empty() || sp.projectTime != projectTime)
+    {
+        // load_project exits on invalid JSON, which a server can't afford
+        std::ifstream ifs(path, std::ios::in);
+        if (nlohmann::json::parse(ifs, nullptr, false).is_discarded())
+            return { { "success", false }, { "outputs", nlohmann::json::array() }, { "diagnostics", { { { "file", path }, { "line", 0 }, { "column", 0 }, { "message", "Failed to parse project file." } } } } };
+
+        // Anything compiled with the old project settings can't be reused
+        Compiler::InvalidateAll(sp.warmFiles);
+        sp.fileTimes.clear();
+
+        sp.project = ProjectFormat();
+        load_project(path, sp.project);
+        if (params.contains("binary"))
+            sp.project.options.binaryOutputDir = params["binary"].get<std::string>();
+        if (params.contains("name"))
+            sp.project.options.binaryName = params["name"].get<std::string>();
+        if (params.contains("macros"))
+        {
+            for (auto& macro : params["macros"])
+            {
+                auto macro_str = macro.get<std::string>();
+                auto pos = macro_str.find('=');
+                if (pos == std::string::npos)
+                    sp.project.options.macros[macro_str] = "";
+                else
+                    sp.project.options.macros[macro_str.substr(0, pos)] = macro_str.substr(pos + 1);
+            }
+        }
+        sp.baseDirectory = fs::path(path).parent_path();
+        sp.projectTime = projectTime;
+    }
+
+    // Files changed since the last compile need to be recompiled. Times are taken before compiling,
+    // so a file changed while it's being compiled is picked up next time.
+    std::unordered_map<std::string, fs::file_time_type> times;
+    for (auto& pair : sp.fileTimes)
+    {
+        fs::file_time_type time = write_time(pair.first);
+        times[pair.first] = time;
+        if (time == pair.second)
+            continue;
+        Compiler::Invalidate(sp.warmFiles, pair.first);
+    }
+
+    CompileSession session;
+    session.warmFiles = &sp.warmFiles;
+    session.symbols = &sp.symbols;
+    int res = compile_project(sp.project, sp.baseDirectory, pool, session);
+
+    sp.fileTimes.clear();
+    for (auto& file : session.sourceFiles)
+    {
+        auto time = times.find(file);
+        sp.fileTimes[file] = (time != times.end()) ? time->second : write_time(file);
+    }
+
+    nlohmann::json diagnostics = nlohmann::json::array();
+    for (auto& d : session.diagnostics)
+        diagnostics.push_back({ { "file", d.file }, { "line", d.line }, { "column", d.column }, { "message", d.message } });
+    nlohmann::json outputs = nlohmann::json::array();
+    for (auto& output : session.outputs)
+        outputs.push_back(fs::path(output.path).lexically_normal().string());
+    return { { "success", res == 0 }, { "outputs", outputs }, { "diagnostics", diagnostics } };
+}
+
+nlohmann::json server_translation(const std::string& method, const nlohmann::json& params)
+{
+    bool isInputPrivate = params.contains("in_private");
+    if (isInputPrivate == params.contains("in_public"))
+        throw std::invalid_argument("Exactly one of in_private or in_public must be specified.");
+    const std::string input = params[isInputPrivate ? "in_private" : "in_public"].get<std::string>();
+    const std::string out = params.at("out").get<std::string>();
+
+    int res;
+    if (method == "convert")
+    {
+        if (isInputPrivate)
+            res = convert_private_to_public(input, out);
+        else
+            res = convert_public_to_private(input, params.at("in_match").get<std::string>(), out);
+    }
+    else if (method == "upgrade")
+        res = upgrade_translation(input, isInputPrivate, params.at("in_newer").get<std::string>(), out);
+    else
+        res = translation_to_binary(input, isInputPrivate, out);
+
+    return { { "success", res == 0 }, { "outputs", res == 0 ? nlohmann::json::array({ fs::absolute(out).string() }) : nlohmann::json::array() }, { "diagnostics", nlohmann::json::array() } };
+}
+
+// Handles a single JSON-RPC request for --server
+std::string handle_request(const std::string& line, bool& stop, ThreadPool& pool, std::unordered_map<std::string, ServerProject>& projects)
+{
+    nlohmann::json response = { { "jsonrpc", "2.0" }, { "id", nullptr } };
+
+    nlohmann::json request = nlohmann::json::parse(line, nullptr, false);
+    if (request.is_discarded() || !request.is_object())
+    {
+        response["error"] = { { "code", -32700 }, { "message", "Parse error" } };
+        return response.dump();
+    }
+    if (request.contains("id"))
+        response["id"] = request["id"];
+
+    const std::string method = request.contains("method") && request["method"].is_string() ? request["method"].get<std::string>() : "";
+    const nlohmann::json params = request.contains("params") ? request["params"] : nlohmann::json::object();
+
+    // Anything printed while handling the request is sent back in the response instead
+    std::stringstream log;
+    std::streambuf* stdoutBuf = std::cout.rdbuf(log.rdbuf());
+    try
+    {
+        if (method == "compile")
+            response["result"] = server_compile(params, pool, projects);
+        else if (method == "convert" || method == "upgrade" || method == "to_binary")
+            response["result"] = server_translation(method, params);
+        else if (method == "shutdown")
+        {
+            response["result"] = nullptr;
+            stop = true;
+        }
+        else
+            response["error"] = { { "code", -32601 }, { "message", "Method not found" } };
+    }
+    catch (const std::runtime_error& e)
+    {
+        // The request was valid, but carrying it out failed (e.g. a malformed translation file)
+        response["error"] = { { "code", -32000 }, { "message", e.what() }, { "data", { { "log", log.str() } } } };
+    }
+    catch (const std::exception& e)
+    {
+        response["error"] = { { "code", -32602 }, { "message", std::string("Invalid params: ") + e.what() } };
+    }
+    std::cout.rdbuf(stdoutBuf);
+
+    if (response.contains("result") && response["result"].is_object())
+        response["result"]["log"] = log.str();
+    return response.dump();
+}
+
 int main(int argc, char** argv)
 {
     ProjectFormat project;
     bool loaded = false;
-    bool fatalError = false;
 
     cxxopts::Options options("diannex", "Universal tool for the diannex dialogue system");
 
@@ -53,6 +464,8 @@ int main(int argc, char** argv)
             ("p,project", "Load project file", cxxopts::value<std::string>())
             ("g,generate", "Generate new project file", cxxopts::value<std::string>()->implicit_value(fs::current_path().filename().string()))
             ("c,cli", "Don't use a project file and read commands from cli")
+            ("server", "Run as a compile server, taking JSON-RPC requests from stdin (one per line)")
+            ("socket", "Take --server requests from a Unix socket at this path instead", cxxopts::value<std::string>())
             ("h,help", "Shows this message");
 
     options
@@ -76,6 +489,14 @@ int main(int argc, char** argv)
             ("D,privname", "Name of output private translation file", cxxopts::value<std::string>(), "(default: \"out\")")
             ("d,privdir", "Directory to output private translation files", cxxopts::value<std::string>(), "(default: \"./translations\")")
             ("C,compress", "Whether or not to use compression")
+            ("j,jobs", "Number of threads to compile with", cxxopts::value<unsigned int>(), "(default: number of hardware threads)")
+            ("cache", "Directory to cache compiled files in", cxxopts::value<std::string>(), "(default: none)")
+            ("w,watch", "Keep running, recompiling whenever source files change")
+            ("streaming", "Parse and generate each file as soon as it's lexed, freeing its tokens and syntax tree early to lower peak memory")
+            ("timings", "Report time spent in each phase and on the slowest N files", cxxopts::value<unsigned int>()->implicit_value("10"), "N")
+            ("timings_json", "Also write the timing report to a JSON file", cxxopts::value<std::string>())
+            ("memory", "Report memory use per phase and estimated container sizes")
+            ("trace_out", "Write a Chrome trace of each phase and file, for chrome://tracing or Perfetto", cxxopts::value<std::string>())
             ("files", "File(s) to compile", cxxopts::value<std::vector<std::string>>()->default_value(""));
 
 
@@ -85,7 +506,7 @@ int main(int argc, char** argv)
     auto result = parse_options(argc, argv, options);
 
     // Prevent incorrect usage
-    std::vector<std::string> mainCommands { "project", "generate", "convert", "upgrade", "to_binary", "cli" };
+    std::vector<std::string> mainCommands { "project", "generate", "convert", "upgrade", "to_binary", "cli", "server" };
     bool foundMainCommand = false;
     for (auto& command : mainCommands)
     {
@@ -122,39 +543,8 @@ int main(int argc, char** argv)
         if (result.count("in_private"))
         {
             std::cout << "Converting..." << std::endl;
-
-            const std::filesystem::path& input = fs::absolute(result["in_private"].as<std::string>());
-            const std::filesystem::path& outResult = fs::absolute(result["out"].as<std::string>());
-
-            // Ensure directories exist
-            if (!fs::exists(input))
-                fs::create_directories(input.parent_path());
-            if (!fs::exists(outResult))
-                fs::create_directories(outResult.parent_path());
-
-            // Open files, check that they were opened properly
-            std::ifstream in;
-            std::ofstream out;
-            in.open(input, std::ios_base::binary | std::ios_base::in);
-            out.open(outResult, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
-            if (!in.is_open())
-            {
-                std::cout << std::endl << rang::fgB::red << "Failed to open input private translation file for reading!" << rang::fg::reset << std::endl;
-                return 1;
-            }
-            if (!out.is_open())
-            {
-                in.close();
-                std::cout << std::endl << rang::fgB::red << "Failed to open output public translation file for writing!" << rang::fg::reset << std::endl;
+            if (convert_private_to_public(result["in_private"].as<std::string>(), result["out"].as<std::string>()) != 0)
                 return 1;
-            }
-
-            // Actual operation
-            Translation::ConvertPrivateToPublic(in, out);
-
-            // Close files we opened earlier
-            in.close();
-            out.close();
         }
         else if (result.count("in_public"))
         {
@@ -166,52 +556,8 @@ int main(int argc, char** argv)
             }
 
             std::cout << "Converting..." << std::endl;
-
-            const std::filesystem::path& input = fs::absolute(result["in_public"].as<std::string>());
-            const std::filesystem::path& inputMatch = fs::absolute(result["in_match"].as<std::string>());
-            const std::filesystem::path& outResult = fs::absolute(result["out"].as<std::string>());
-
-            // Ensure directories exist
-            if (!fs::exists(input))
-                fs::create_directories(input.parent_path());
-            if (!fs::exists(inputMatch))
-                fs::create_directories(inputMatch.parent_path());
-            if (!fs::exists(outResult))
-                fs::create_directories(outResult.parent_path());
-
-            // Open files, check that they were opened properly
-            std::ifstream in;
-            std::ifstream inMatch;
-            std::ofstream out;
-            in.open(input, std::ios_base::binary | std::ios_base::in);
-            inMatch.open(inputMatch, std::ios_base::binary | std::ios_base::in);
-            out.open(outResult, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
-            if (!in.is_open())
-            {
-                std::cout << std::endl << rang::fgB::red << "Failed to open input public translation file for reading!" << rang::fg::reset << std::endl;
+            if (convert_public_to_private(result["in_public"].as<std::string>(), result["in_match"].as<std::string>(), result["out"].as<std::string>()) != 0)
                 return 1;
-            }
-            if (!inMatch.is_open())
-            {
-                in.close();
-                std::cout << std::endl << rang::fgB::red << "Failed to open input matching translation file for reading!" << rang::fg::reset << std::endl;
-                return 1;
-            }
-            if (!out.is_open())
-            {
-                in.close();
-                inMatch.close();
-                std::cout << std::endl << rang::fgB::red << "Failed to open output private translation file for writing!" << rang::fg::reset << std::endl;
-                return 1;
-            }
-
-            // Actual operation
-            Translation::ConvertPublicToPrivate(in, inMatch, out);
-
-            // Close files we opened earlier
-            in.close();
-            inMatch.close();
-            out.close();
         }
         else
         {
@@ -259,52 +605,17 @@ int main(int argc, char** argv)
 
         std::cout << "Upgrading..." << std::endl;
 
-        const std::filesystem::path& input = fs::absolute(result[isInputPrivate ? "in_private" : "in_public"].as<std::string>());
-        const std::filesystem::path& inputNewer = fs::absolute(result["in_newer"].as<std::string>());
-        const std::filesystem::path& outResult = fs::absolute(result["out"].as<std::string>());
-
-        // Ensure directories exist
-        if (!fs::exists(input))
-            fs::create_directories(input.parent_path());
-        if (!fs::exists(inputNewer))
-            fs::create_directories(inputNewer.parent_path());
-        if (!fs::exists(outResult))
-            fs::create_directories(outResult.parent_path());
-
-        // Open files, check that they were opened properly
-        std::ifstream in;
-        std::ifstream inNewer;
-        std::ofstream out;
-        in.open(input, std::ios_base::binary | std::ios_base::in);
-        inNewer.open(inputNewer, std::ios_base::binary | std::ios_base::in);
-        out.open(outResult, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
-        if (!in.is_open())
-        {
-            std::cout << std::endl << rang::fgB::red << "Failed to open input translation file for reading!" << rang::fg::reset << std::endl;
-            return 1;
-        }
-        if (!inNewer.is_open())
+        try
         {
-            in.close();
-            std::cout << std::endl << rang::fgB::red << "Failed to open newer input translation file for reading!" << rang::fg::reset << std::endl;
-            return 1;
+            if (upgrade_translation(result[isInputPrivate ? "in_private" : "in_public"].as<std::string>(), isInputPrivate, result["in_newer"].as<std::string>(), result["out"].as<std::string>()) != 0)
+                return 1;
         }
-        if (!out.is_open())
+        catch (const std::runtime_error& e)
         {
-            in.close();
-            inNewer.close();
-            std::cout << std::endl << rang::fgB::red << "Failed to open output translation file for writing!" << rang::fg::reset << std::endl;
+            std::cout << rang::fgB::red << e.what() << rang::fg::reset << std::endl;
             return 1;
         }
 
-        // Actual operation
-        Translation::UpgradeFileToNewer(in, isInputPrivate, inNewer, out);
-
-        // Close files we opened earlier
-        in.close();
-        inNewer.close();
-        out.close();
-
         std::cout << "Completed!" << std::endl;
 
         return 0;
@@ -338,41 +649,39 @@ int main(int argc, char** argv)
 
         std::cout << "Converting to binary format..." << std::endl;
 
-        const std::filesystem::path& input = fs::absolute(result[isInputPrivate ? "in_private" : "in_public"].as<std::string>());
-        const std::filesystem::path& outResult = fs::absolute(result["out"].as<std::string>());
+        if (translation_to_binary(result[isInputPrivate ? "in_private" : "in_public"].as<std::string>(), isInputPrivate, result["out"].as<std::string>()) != 0)
+            return 1;
+
+        std::cout << "Completed!" << std::endl;
+
+        return 0;
+    }
 
-        // Ensure directories exist
-        if (!fs::exists(input))
-            fs::create_directories(input.parent_path());
-        if (!fs::exists(outResult))
-            fs::create_directories(outResult.parent_path());
+    unsigned int jobs = result["jobs"].count() ? result["jobs"].as<unsigned int>() : std::thread::hardware_concurrency();
 
+    // --server
+    if (result.count("server"))
+    {
+        ThreadPool pool(jobs);
+        std::unordered_map<std::string, ServerProject> projects;
+        Server::Handler handler = [&](const std::string& request, bool& stop)
         {
-            // Open files, check that they were opened properly
-            std::ifstream in;
-            BinaryFileWriter out(outResult.string());
-            in.open(input, std::ios_base::binary | std::ios_base::in);
-            if (!in.is_open())
-            {
-                std::cout << std::endl << rang::fgB::red << "Failed to open input translation file for reading!" << rang::fg::reset << std::endl;
-                return 1;
-            }
-            if (!out.CanWrite())
+            return handle_request(request, stop, pool, projects);
+        };
+
+        if (result.count("socket"))
+        {
+            if (!Server::ServeSocket(result["socket"].as<std::string>(), handler))
             {
-                in.close();
-                std::cout << std::endl << rang::fgB::red << "Failed to open output binary file for writing!" << rang::fg::reset << std::endl;
+                std::cout << rang::fgB::red << "Failed to listen on socket '" << result["socket"].as<std::string>() << "'." << rang::fg::reset << std::endl;
                 return 1;
             }
-
-            // Actual operation
-            Translation::ConvertToBinary(in, isInputPrivate, out);
-
-            // Close file we opened earlier (BinaryFileWriter closes upon exiting scope)
-            in.close();
         }
+        else
+            Server::ServeStdio(handler);
 
-        std::cout << "Completed!" << std::endl;
-
+        for (auto& pair : projects)
+            Compiler::InvalidateAll(pair.second.warmFiles);
         return 0;
     }
 
@@ -403,6 +712,8 @@ int main(int argc, char** argv)
             project.options.translationPrivateOutDir = result["privdir"].as<std::string>();
         if (result["compress"].count())
             project.options.compression = result["compress"].as<bool>();
+        if (result["cache"].count())
+            project.options.cacheDir = result["cache"].as<std::string>();
 
         loaded = true;
     }
@@ -424,6 +735,7 @@ int main(int argc, char** argv)
         project.options.translationPrivateName = result["privname"].count() == 1 ? result["privname"].as<std::string>() : "out";
         project.options.translationPrivateOutDir = result["privdir"].count() == 1 ? result["privdir"].as<std::string>() : "./translations";
         project.options.compression = result["compress"].count() == 1 ? result["compress"].as<bool>() : false;
+        project.options.cacheDir = result["cache"].count() == 1 ? result["cache"].as<std::string>() : "";
         loaded = true;
     }
 
@@ -433,327 +745,42 @@ int main(int argc, char** argv)
         return 0;
     }
 
-    std::cout << "Beginning compilation process..." << std::endl;
+    ThreadPool pool(jobs);
 
-    auto start = std::chrono::high_resolution_clock::now();
-
-    CompileContext context;
-    context.project = &project;
-    for (auto& file : project.options.files)
+    if (!result.count("watch"))
     {
-#if DIANNEX_OLD_INCLUDE_ORDER
-        context.queue.push(file);
-#else
-        context.queue.push_back(file);
-#endif
-    }
-
-    // Load all of the files in the queue and lex them into tokens
-    std::cout << "Lexing..." << std::endl;
-    while (!context.queue.empty())
-    {
-        std::string file = (baseDirectory / context.queue.front()).string();
-#if DIANNEX_OLD_INCLUDE_ORDER
-        context.queue.pop();
-#else
-        context.queue.pop_front();
-#endif
-        std::string buf;
-        try
-        {
-            if (!fs::exists(file))
-                throw std::runtime_error("File does not exist.");
-            if (context.files.find(file) != context.files.end())
-                continue; // Already tokenized this file
-            std::ifstream f(file, std::ios::in | std::ios::binary);
-            f.seekg(0, std::ios::end);
-            buf.reserve(f.tellg());
-            f.seekg(0, std::ios::beg);
-
-            buf.assign((std::istreambuf_iterator<char>(f)),
-                        std::istreambuf_iterator<char>());
-        }
-        catch (const std::exception& e)
-        {
-            std::cout << rang::fg::red << "Failed to read file '" << file << "': " << e.what() << rang::fg::reset << std::endl;
-            fatalError = true;
-            continue;
-        }
-        context.currentFile = file;
-        std::vector<Token> tokens;
-        Lexer::LexString(buf, &context, tokens);
-
-        context.tokenList.push_back(std::make_pair(file, tokens));
-        context.files.insert(file);
+        CompileSession session;
+        return compile_with_reports(project, baseDirectory, pool, session, result);
     }
 
-    if (fatalError)
+    // --watch
+    FileWatcher watcher;
+    if (!watcher.IsSupported())
     {
-        std::cout << std::endl << rang::fgB::red << "Not proceeding with compilation due to fatal errors." << rang::fg::reset << std::endl;
+        std::cout << rang::fgB::red << "Watching files is not supported on this platform." << rang::fg::reset << std::endl;
         return 1;
     }
 
-    // Parse each token stream
-    std::cout << "Parsing..." << std::endl;
-    for (auto& pair : context.tokenList)
+    WarmFiles warmFiles;
+    SymbolTable symbols;
+    while (true)
     {
-        context.currentFile = pair.first;
-        ParseResult* parsed = Parser::ParseTokens(&context, &pair.second);
-        if (parsed->errors.size() != 0)
-        {
-            if (!fatalError)
-            {
-                std::cout << rang::fgB::red << std::endl << "Encountered errors while parsing:" << rang::fg::reset << std::endl;
-                fatalError = true;
-            }
-
-            std::cout << rang::fg::red;
-
-            for (ParseError& e : parsed->errors)
-            {
-                if (e.line == 0 && e.column == 0)
-                    std::cout << "[" << pair.first << ":?:?] ";
-                else
-                    std::cout << "[" << pair.first << ":" << e.line << ":" << e.column << "] ";
-                switch (e.type)
-                {
-                case ParseError::ErrorType::ExpectedTokenButGot:
-                    std::cout << "Expected token " << e.info1 << " but got " << e.info2 << "." << std::endl;
-                    break;
-                case ParseError::ErrorType::ExpectedTokenButEOF:
-                    std::cout << "Expected token " << e.info1 << " but reached end of code." << std::endl;
-                    break;
-                case ParseError::ErrorType::UnexpectedToken:
-                    std::cout << "Unexpected token " << e.info1 << "." << std::endl;
-                    break;
-                case ParseError::ErrorType::UnexpectedModifierFor:
-                    std::cout << "Unexpected modifier for " << e.info1 << "." << std::endl;
-                    break;
-                case ParseError::ErrorType::UnexpectedMarkedString:
-                    std::cout << "Unexpected MarkedString token." << std::endl;
-                    break;
-                case ParseError::ErrorType::UnexpectedEOF:
-                    std::cout << "Unexpected end of code." << std::endl;
-                    break;
-                case ParseError::ErrorType::UnexpectedSwitchCase:
-                    std::cout << "Unexpected switch 'case' keyword." << std::endl;
-                    break;
-                case ParseError::ErrorType::UnexpectedSwitchDefault:
-                    std::cout << "Unexpected switch 'default' keyword." << std::endl;
-                    break;
-                case ParseError::ErrorType::ChooseWithoutStatement:
-                    std::cout << "Choose statement without any sub-statements." << std::endl;
-                    break;
-                case ParseError::ErrorType::ChoiceWithoutStatement:
-                    std::cout << "Choice statement without any sub-statements." << std::endl;
-                    break;
-                case ParseError::ErrorType::DuplicateFlagName:
-                    std::cout << "Duplicate flag names." << std::endl;
-                    break;
-                case ParseError::ErrorType::ErrorToken:
-                    std::cout << e.info1 << std::endl;
-                    break;
-                }
-            }
-
-            std::cout << rang::fg::reset;
-        }
-        else
-        {
-            context.parseList.push_back(std::make_pair(pair.first, parsed));
-        }
-    }
-
-    if (fatalError)
-    {
-        std::cout << std::endl << rang::fgB::red << "Not proceeding with compilation due to fatal errors." << rang::fg::reset << std::endl;
-        return 1;
+        CompileSession session;
+        session.warmFiles = &warmFiles;
+        session.symbols = &symbols;
+        compile_with_reports(project, baseDirectory, pool, session, result);
+        watcher.Watch(session.sourceFiles);
+
+        std::cout << std::endl << "Watching for changes..." << std::endl;
+        std::vector<std::string> changed = watcher.WaitForChanges();
+        if (changed.empty())
+            break;
+
+        // Changed files need to be recompiled; everything else stays warm
+        for (auto& file : changed)
+            Compiler::Invalidate(warmFiles, file);
+        std::cout << std::endl;
     }
 
-    // Generate bytecode
-    std::cout << "Generating bytecode..." << std::endl;
-    for (auto& pair : context.parseList)
-    {
-        context.currentFile = pair.first;
-
-        // Initialize string ID map for this file, if necessary
-        if (context.project->options.addStringIds)
-            context.stringIdPositions.insert(std::pair<std::string, std::vector<std::pair<uint32_t, int32_t>>>(context.currentFile, std::vector<std::pair<uint32_t, int32_t>>()));
-
-        BytecodeResult* bytecode = Bytecode::Generate(pair.second, &context);
-        if (bytecode->errors.size() != 0)
-        {
-            if (!fatalError)
-            {
-                std::cout << rang::fgB::red << std::endl << "Encountered errors while generating bytecode:" << rang::fg::reset << std::endl;
-                fatalError = true;
-            }
-
-            std::cout << rang::fg::red;
-
-            for (BytecodeError& e : bytecode->errors)
-            {
-                if (e.line == 0 && e.column == 0)
-                    std::cout << "[" << pair.first << ":?:?] ";
-                else
-                    std::cout << "[" << pair.first << ":" << e.line << ":" << e.column << "] ";
-                
-                switch (e.type)
-                {
-                case BytecodeError::ErrorType::SceneAlreadyExists:
-                    std::cout << "Duplicate scene name '" << e.info1 << "'." << std::endl;
-                    break;
-                case BytecodeError::ErrorType::FunctionAlreadyExists:
-                    std::cout << "Duplicate function name '" << e.info1 << "'." << std::endl;
-                    break;
-                case BytecodeError::ErrorType::DefinitionAlreadyExists:
-                    std::cout << "Duplicate definition name '" << e.info1 << "'." << std::endl;
-                    break;
-                case BytecodeError::ErrorType::LocalVariableAlreadyExists:
-                    std::cout << "Local variable '" << e.info1 << "' already defined." << std::endl;
-                    break;
-                case BytecodeError::ErrorType::ContinueOutsideOfLoop:
-                    std::cout << "Continue statement outside of a loop." << std::endl;
-                    break;
-                case BytecodeError::ErrorType::BreakOutsideOfLoop:
-                    std::cout << "Break statement outside of a loop or switch statement." << std::endl;
-                    break;
-                case BytecodeError::ErrorType::StatementsBeforeSwitchCase:
-                    std::cout << "Statements present before any cases in switch statement." << std::endl;
-                    break;
-                case BytecodeError::ErrorType::UnexpectedError:
-                    std::cout << "Unexpected error. May be invalid syntax." << std::endl;
-                    break;
-                }
-            }
-        }
-    }
-
-    if (fatalError)
-    {
-        std::cout << std::endl << rang::fgB::red << "Not proceeding with compilation due to fatal errors." << rang::fg::reset << std::endl;
-        return 1;
-    }
-
-    if (context.project->options.addStringIds)
-    {
-        // Output string IDs to necessary files
-        std::cout << "Writing string IDs..." << std::endl;
-        
-        std::vector<char> fileData;
-        for (auto it = context.stringIdPositions.begin(); it != context.stringIdPositions.end(); ++it)
-        {
-            const std::string& currentFile = it->first;
-
-            // Make backup of new file we're processing
-            fs::copy_file(currentFile, currentFile + ".backup", fs::copy_options::overwrite_existing);
-
-            // Read in the data from the file
-            fileData.clear();
-            std::ifstream f(currentFile, std::ios::in | std::ios::binary);
-            f.seekg(0, std::ios::end);
-            fileData.reserve(f.tellg());
-            f.seekg(0, std::ios::beg);
-            fileData.assign((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
-            f.close();
-
-            // Insert new IDs
-            int offset = 0;
-            std::stringstream ss(std::ios_base::app | std::ios_base::out);
-            for (const std::pair<int, int>& info : it->second)
-            {
-                ss.str(std::string());
-                ss.clear();
-                ss << '&' << std::setfill('0') << std::setw(8) << std::hex << info.second;
-                std::string ss_str = ss.str();
-                fileData.insert(fileData.begin() + info.first + offset, ss_str.begin(), ss_str.begin() + 9);
-                offset += 9;
-            }
-
-            // Save file
-            std::ofstream fileOut(currentFile, std::ios::out | std::ios::binary);
-            fileOut.write(&fileData[0], fileData.size());
-            fileOut.close();
-        }
-
-        return 0;
-    }
-
-    // Write binary
-    std::cout << "Writing binary..." << std::endl;
-    const fs::path mainOutput = fs::absolute(baseDirectory / project.options.binaryOutputDir);
-    const std::string binaryName = (project.options.binaryName.empty() ? project.name : project.options.binaryName);
-    const std::string fileName = binaryName + ".dxb";
-    if (!fs::exists(mainOutput))
-        fs::create_directories(mainOutput);
-    {
-        BinaryFileWriter bw((mainOutput / fileName).string());
-        if (!bw.CanWrite())
-        {
-            std::cout << std::endl << rang::fgB::red << "Failed to open output binary file for writing!" << rang::fg::reset << std::endl;
-            return 1;
-        }
-        if (!Binary::Write(&bw, &context))
-        {
-            std::cout << std::endl << rang::fgB::red << "Failed to compress with zlib!" << rang::fg::reset << std::endl;
-            return 1;
-        }
-    }
-
-    // Write translation files
-    if (context.project->options.translationPublic)
-    {
-        std::cout << "Writing public translation file..." << std::endl;
-
-        const std::string pubFileName = (project.options.translationPublicName.empty() ? binaryName : project.options.translationPublicName) + ".dxt";
-
-        std::ofstream s;
-        s.open((mainOutput / pubFileName).string(), std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
-        if (s.is_open())
-        {
-            Translation::GeneratePublicFile(s, &context);
-        }
-        else
-        {
-            std::cout << std::endl << rang::fgB::red << "Failed to open output translation file for writing!" << rang::fg::reset << std::endl;
-            return 1;
-        }
-        s.close();
-    }
-
-    if (context.project->options.translationPrivate) 
-    {
-        std::cout << "Writing private translation file..." << std::endl;
-
-        const fs::path privateOutput = fs::absolute(baseDirectory / project.options.translationPrivateOutDir);
-        if (!fs::exists(privateOutput))
-            fs::create_directories(privateOutput);
-        
-        const std::string privFileName = (project.options.translationPrivateName.empty() ? binaryName : project.options.translationPrivateName) + ".dxt";
-
-        std::ofstream s;
-        s.open((privateOutput / privFileName).string(), std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
-        if (s.is_open())
-        {
-            Translation::GeneratePrivateFile(s, &context);
-        }
-        else
-        {
-            std::cout << std::endl << rang::fgB::red << "Failed to open output translation file for writing!\nMake sure that all proper directories exist." << rang::fg::reset << std::endl;
-            return 1;
-        }
-        s.close();
-    }
-
-    auto stop = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start);
-
-    std::cout << rang::fgB::green;
-    if (project.options.compileFinishMessage.size() != 0)
-        std::cout << project.options.compileFinishMessage << std::endl;
-    else
-        std::cout << "Finished! ";
-    std::cout << "Took " << duration.count() << " milliseconds." << rang::fg::reset << std::endl;
-
     return 0;
 }
\ No newline at end of file
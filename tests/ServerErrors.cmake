@@ -0,0 +1,40 @@
+# Checks that --server answers requests that fail inside the compiler or a translation conversion
+# with an error, and keeps serving afterwards.
+# Run with -DDIANNEX=<diannex executable> -DWORK_DIR=<scratch directory>
+
+file(REMOVE_RECURSE ${WORK_DIR})
+file(MAKE_DIRECTORY ${WORK_DIR})
+
+# Parsing this throws on a worker thread
+file(WRITE ${WORK_DIR}/main.dx "namespace n { scene s { \"\${[\" } }\n")
+file(WRITE ${WORK_DIR}/p.json "{ \"name\": \"t\" }")
+
+# A private translation file without string IDs can't be upgraded
+file(WRITE ${WORK_DIR}/old.dxt "\"hello\"\n")
+file(WRITE ${WORK_DIR}/new.dxt "\"hi\"&00000000\n")
+
+file(WRITE ${WORK_DIR}/requests.txt
+    "{\"id\":1,\"method\":\"compile\",\"params\":{\"project\":\"p.json\"}}\n"
+    "{\"id\":2,\"method\":\"upgrade\",\"params\":{\"in_private\":\"old.dxt\",\"in_newer\":\"new.dxt\",\"out\":\"out.dxt\"}}\n"
+    "{\"id\":3,\"method\":\"shutdown\"}\n")
+
+execute_process(COMMAND ${DIANNEX} --server
+    WORKING_DIRECTORY ${WORK_DIR}
+    INPUT_FILE ${WORK_DIR}/requests.txt
+    OUTPUT_VARIABLE output
+    RESULT_VARIABLE result
+    TIMEOUT 60)
+
+if (NOT result EQUAL 0)
+    message(FATAL_ERROR "The server exited with '${result}'. Output:\n${output}")
+endif()
+
+foreach(expected
+        "\"id\":1,\"jsonrpc\":\"2.0\",\"result\":{\"diagnostics\":[{\"column\":0,\"file\":\"\",\"line\":0,\"message\":\"Internal compiler error"
+        "\"message\":\"Missing string ID in private translation file!\"},\"id\":2"
+        "{\"id\":3,\"jsonrpc\":\"2.0\",\"result\":null}")
+    string(FIND "${output}" "${expected}" found)
+    if (found EQUAL -1)
+        message(FATAL_ERROR "Missing from the server's responses: ${expected}\nOutput:\n${output}")
+    endif()
+endforeach()